@@ -30,6 +30,10 @@
     ((void)OSAtomicAdd32Barrier(-amount, value))
 #define xe_atomic_cas_32(oldValue, newValue, value) \
     OSAtomicCompareAndSwap32Barrier(oldValue, newValue, value)
+#define xe_atomic_cas_64(oldValue, newValue, value) \
+    OSAtomicCompareAndSwap64Barrier(oldValue, newValue, (volatile int64_t*)value)
+#define xe_atomic_cas_ptr(oldValue, newValue, value) \
+    OSAtomicCompareAndSwapPtrBarrier(oldValue, newValue, (void* volatile*)value)
 
 typedef OSQueueHead xe_atomic_stack_t;
 #define xe_atomic_stack_init(stack) \
@@ -51,6 +55,10 @@ typedef OSQueueHead xe_atomic_stack_t;
     ((void)InterlockedExchangeSubtract((volatile unsigned*)value, amount))
 #define xe_atomic_cas_32(oldValue, newValue, value) \
     (InterlockedCompareExchange((volatile LONG*)value, newValue, oldValue) == oldValue)
+#define xe_atomic_cas_64(oldValue, newValue, value) \
+    (InterlockedCompareExchange64((volatile LONGLONG*)value, newValue, oldValue) == oldValue)
+#define xe_atomic_cas_ptr(oldValue, newValue, value) \
+    (InterlockedCompareExchangePointer((PVOID volatile*)value, newValue, oldValue) == oldValue)
 
 typedef SLIST_HEADER xe_atomic_stack_t;
 #define xe_atomic_stack_init(stack) \
@@ -79,6 +87,10 @@ XEFORCEINLINE void* xe_atomic_stack_dequeue(xe_atomic_stack_t* stack,
     __sync_fetch_and_sub(value, amount)
 #define xe_atomic_cas_32(oldValue, newValue, value) \
     __sync_bool_compare_and_swap(value, oldValue, newValue)
+#define xe_atomic_cas_64(oldValue, newValue, value) \
+    __sync_bool_compare_and_swap((int64_t*)value, (int64_t)oldValue, (int64_t)newValue)
+#define xe_atomic_cas_ptr(oldValue, newValue, value) \
+    __sync_bool_compare_and_swap((void**)value, (void*)oldValue, (void*)newValue)
 
 #else
 
@@ -12,6 +12,7 @@
 
 #include <xenia/common.h>
 
+#include <xenia/core/event.h>
 #include <xenia/core/file.h>
 #include <xenia/core/memory.h>
 #include <xenia/core/mmap.h>
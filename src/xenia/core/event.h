@@ -0,0 +1,33 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CORE_EVENT_H_
+#define XENIA_CORE_EVENT_H_
+
+#include <xenia/common.h>
+
+
+// Auto-reset event for a single waiting thread.
+// Waiters spin for a while before sleeping in the kernel, and the spin length
+// adapts to how often spinning actually catches the signal. Setting an event
+// that has no sleeping waiter never enters the kernel.
+typedef struct xe_event xe_event_t;
+
+#define XE_EVENT_INFINITE   0xFFFFFFFF
+
+
+xe_event_t* xe_event_alloc(uint32_t spin_count);
+void xe_event_free(xe_event_t* event);
+
+void xe_event_set(xe_event_t* event);
+// Returns 0 if the event was signaled or 1 if the timeout expired.
+int xe_event_wait(xe_event_t* event, uint32_t timeout_ms);
+
+
+#endif  // XENIA_CORE_EVENT_H_
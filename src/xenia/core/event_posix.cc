@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/core/event.h>
+
+#include <xenia/atomic.h>
+
+#include <emmintrin.h>
+#include <time.h>
+#if XE_PLATFORM(UNIX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#else
+#include <pthread.h>
+#endif  // UNIX
+
+
+namespace {
+
+// Bounds for the adaptive spin.
+const uint32_t kMinSpinCount = 16;
+
+}  // namespace
+
+
+struct xe_event {
+  // 1 when signaled. Consumed (reset to 0) by the waiter.
+  volatile int32_t  state;
+  // Number of threads about to sleep or sleeping on state.
+  volatile int32_t  waiters;
+  uint32_t          max_spin_count;
+  uint32_t          spin_count;
+#if !XE_PLATFORM(UNIX)
+  pthread_mutex_t   mutex;
+  pthread_cond_t    cond;
+#endif  // !UNIX
+};
+
+
+xe_event_t* xe_event_alloc(uint32_t spin_count) {
+  xe_event_t* event = (xe_event_t*)xe_calloc(sizeof(xe_event_t));
+  event->max_spin_count = MAX(spin_count, kMinSpinCount);
+  event->spin_count = event->max_spin_count;
+#if !XE_PLATFORM(UNIX)
+  pthread_mutex_init(&event->mutex, NULL);
+  pthread_cond_init(&event->cond, NULL);
+#endif  // !UNIX
+  return event;
+}
+
+void xe_event_free(xe_event_t* event) {
+#if !XE_PLATFORM(UNIX)
+  pthread_cond_destroy(&event->cond);
+  pthread_mutex_destroy(&event->mutex);
+#endif  // !UNIX
+  xe_free(event);
+}
+
+namespace {
+
+bool xe_event_try_consume(xe_event_t* event) {
+  return event->state && xe_atomic_cas_32(1, 0, &event->state);
+}
+
+// Sleeps while state is 0. Returns false if the timeout expired.
+bool xe_event_sleep(xe_event_t* event, uint32_t timeout_ms) {
+#if XE_PLATFORM(UNIX)
+  struct timespec timeout;
+  struct timespec* timeout_ptr = NULL;
+  if (timeout_ms != XE_EVENT_INFINITE) {
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+    timeout_ptr = &timeout;
+  }
+  // Returns immediately with EAGAIN if the event was set after the last
+  // check, so the wakeup cannot be lost.
+  int result = syscall(SYS_futex, &event->state, FUTEX_WAIT_PRIVATE, 0,
+                       timeout_ptr, NULL, 0);
+  return !(result == -1 && errno == ETIMEDOUT);
+#else
+  int result = 0;
+  pthread_mutex_lock(&event->mutex);
+  if (!event->state) {
+    if (timeout_ms == XE_EVENT_INFINITE) {
+      result = pthread_cond_wait(&event->cond, &event->mutex);
+    } else {
+      struct timespec timeout;
+      clock_gettime(CLOCK_REALTIME, &timeout);
+      timeout.tv_sec += timeout_ms / 1000;
+      timeout.tv_nsec += (timeout_ms % 1000) * 1000000;
+      if (timeout.tv_nsec >= 1000000000) {
+        timeout.tv_sec++;
+        timeout.tv_nsec -= 1000000000;
+      }
+      result = pthread_cond_timedwait(&event->cond, &event->mutex, &timeout);
+    }
+  }
+  pthread_mutex_unlock(&event->mutex);
+  return result != ETIMEDOUT;
+#endif  // UNIX
+}
+
+}  // namespace
+
+void xe_event_set(xe_event_t* event) {
+  if (!xe_atomic_cas_32(0, 1, &event->state)) {
+    // Already signaled and not yet consumed.
+    return;
+  }
+  // The cas is a full barrier, so a waiter that has not been counted yet
+  // will see state = 1 before it sleeps.
+  if (event->waiters) {
+#if XE_PLATFORM(UNIX)
+    syscall(SYS_futex, &event->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&event->mutex);
+    pthread_cond_signal(&event->cond);
+    pthread_mutex_unlock(&event->mutex);
+#endif  // UNIX
+  }
+}
+
+int xe_event_wait(xe_event_t* event, uint32_t timeout_ms) {
+  // Spin first: the signal usually follows shortly after the waiter runs dry.
+  for (uint32_t n = 0; n < event->spin_count; n++) {
+    if (xe_event_try_consume(event)) {
+      // Spinning paid off; allow longer spins next time.
+      event->spin_count = MIN(event->spin_count * 2, event->max_spin_count);
+      return 0;
+    }
+    _mm_pause();
+  }
+  if (!timeout_ms) {
+    return 1;
+  }
+
+  // Spinning didn't help; back off so idle waits don't burn a core.
+  event->spin_count = MAX(event->spin_count / 2, kMinSpinCount);
+
+  xe_atomic_inc_32(&event->waiters);
+  int result = 0;
+  while (!xe_event_try_consume(event)) {
+    if (!xe_event_sleep(event, timeout_ms)) {
+      result = xe_event_try_consume(event) ? 0 : 1;
+      break;
+    }
+  }
+  xe_atomic_dec_32(&event->waiters);
+  return result;
+}
@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/core/event.h>
+
+#include <xenia/atomic.h>
+
+
+namespace {
+
+const uint32_t kMinSpinCount = 16;
+
+}  // namespace
+
+
+struct xe_event {
+  // 1 when signaled. Lets set/wait skip the kernel when nobody sleeps.
+  volatile LONG     state;
+  volatile LONG     waiters;
+  uint32_t          max_spin_count;
+  uint32_t          spin_count;
+  HANDLE            handle;
+};
+
+
+xe_event_t* xe_event_alloc(uint32_t spin_count) {
+  xe_event_t* event = (xe_event_t*)xe_calloc(sizeof(xe_event_t));
+  event->max_spin_count = MAX(spin_count, kMinSpinCount);
+  event->spin_count = event->max_spin_count;
+  event->handle = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (!event->handle) {
+    xe_free(event);
+    return NULL;
+  }
+  return event;
+}
+
+void xe_event_free(xe_event_t* event) {
+  CloseHandle(event->handle);
+  xe_free(event);
+}
+
+void xe_event_set(xe_event_t* event) {
+  if (!xe_atomic_cas_32(0, 1, &event->state)) {
+    return;
+  }
+  if (event->waiters) {
+    SetEvent(event->handle);
+  }
+}
+
+int xe_event_wait(xe_event_t* event, uint32_t timeout_ms) {
+  for (uint32_t n = 0; n < event->spin_count; n++) {
+    if (event->state && xe_atomic_cas_32(1, 0, &event->state)) {
+      event->spin_count = MIN(event->spin_count * 2, event->max_spin_count);
+      return 0;
+    }
+    YieldProcessor();
+  }
+  if (!timeout_ms) {
+    return 1;
+  }
+
+  event->spin_count = MAX(event->spin_count / 2, kMinSpinCount);
+
+  xe_atomic_inc_32(&event->waiters);
+  int result = 0;
+  while (!(event->state && xe_atomic_cas_32(1, 0, &event->state))) {
+    // A SetEvent from an earlier wakeup may still be pending, in which case
+    // this returns immediately and the state is checked again.
+    DWORD wait_result = WaitForSingleObject(
+        event->handle, timeout_ms == XE_EVENT_INFINITE ? INFINITE : timeout_ms);
+    if (wait_result == WAIT_TIMEOUT) {
+      result = xe_atomic_cas_32(1, 0, &event->state) ? 0 : 1;
+      break;
+    }
+  }
+  xe_atomic_dec_32(&event->waiters);
+  return result;
+}
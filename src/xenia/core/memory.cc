@@ -13,6 +13,7 @@
 
 #if !XE_PLATFORM(WIN32)
 #include <sys/mman.h>
+#include <unistd.h>
 #endif  // WIN32
 
 #define MSPACES                 1
@@ -53,10 +54,17 @@
  * commit the requested memory as needed. This bypasses the standard heap, but
  * XEXs should never be overwriting anything so that's fine. We can also query
  * for previous commits and assert that we really isn't committing twice.
+ *
+ * The reservation covers the full 4GB guest address space even though only
+ * the first 3GB are usable. Generated code adds 32-bit guest addresses to the
+ * base without any bounds checks, so nothing is accessible until it has been
+ * committed: the heap up front, placement allocations as they are made.
+ * Everything else faults instead (see X64JIT::LookupAccessFault).
  */
 
 #define XE_MEMORY_HEAP_LOW    0x20000000
 #define XE_MEMORY_HEAP_HIGH   0x40000000
+#define XE_MEMORY_RESERVATION 0x100000000ull
 
 
 struct xe_memory {
@@ -77,12 +85,16 @@ xe_memory_ref xe_memory_create(xe_memory_options_t options) {
   xe_memory_ref memory = (xe_memory_ref)xe_calloc(sizeof(xe_memory));
   xe_ref_init((xe_ref)memory);
 
+  uint32_t heap_offset;
+  uint32_t heap_size;
+  uint8_t* heap_ptr;
+
 #if XE_PLATFORM(WIN32)
   SYSTEM_INFO si;
   GetSystemInfo(&si);
   memory->system_page_size = si.dwPageSize;
 #else
-#error need to implement page size retrieval
+  memory->system_page_size = (size_t)sysconf(_SC_PAGESIZE);
 #endif  // WIN32
 
   memory->length = 0xC0000000;
@@ -90,12 +102,12 @@ xe_memory_ref xe_memory_create(xe_memory_options_t options) {
 #if XE_PLATFORM(WIN32)
   // Reserve the entire usable address space.
   // We're 64-bit, so this should be no problem.
-  memory->ptr = VirtualAlloc(0, memory->length,
+  memory->ptr = VirtualAlloc(0, XE_MEMORY_RESERVATION,
                              MEM_RESERVE,
                              PAGE_READWRITE);
   XEEXPECTNOTNULL(memory->ptr);
 #else
-  memory->ptr = mmap(0, memory->length, PROT_READ | PROT_WRITE,
+  memory->ptr = mmap(0, XE_MEMORY_RESERVATION, PROT_NONE,
                      MAP_PRIVATE | MAP_ANON, -1, 0);
   XEEXPECT(memory->ptr != MAP_FAILED);
   XEEXPECTNOTNULL(memory->ptr);
@@ -107,15 +119,15 @@ xe_memory_ref xe_memory_create(xe_memory_options_t options) {
 
   // Commit the memory where our heap will live.
   // We don't allocate at 0 to make bad writes easier to find.
-  uint32_t heap_offset = XE_MEMORY_HEAP_LOW;
-  uint32_t heap_size = XE_MEMORY_HEAP_HIGH - XE_MEMORY_HEAP_LOW;
-  uint8_t* heap_ptr = (uint8_t*)memory->ptr + heap_offset;
+  heap_offset = XE_MEMORY_HEAP_LOW;
+  heap_size = XE_MEMORY_HEAP_HIGH - XE_MEMORY_HEAP_LOW;
+  heap_ptr = (uint8_t*)memory->ptr + heap_offset;
 #if XE_PLATFORM(WIN32)
   void* heap_result = VirtualAlloc(heap_ptr, heap_size,
                                    MEM_COMMIT, PAGE_READWRITE);
   XEEXPECTNOTNULL(heap_result);
 #else
-#error ?
+  XEEXPECTZERO(mprotect(heap_ptr, heap_size, PROT_READ | PROT_WRITE));
 #endif  // WIN32
 
   // Allocate the mspace for our heap.
@@ -144,7 +156,7 @@ void xe_memory_dealloc(xe_memory_ref memory) {
   // This decommits all pages and releases everything.
   XEIGNORE(VirtualFree(memory->ptr, 0, MEM_RELEASE));
 #else
-  munmap(memory->ptr, memory->length);
+  munmap(memory->ptr, XE_MEMORY_RESERVATION);
 #endif  // WIN32
 }
 
@@ -232,7 +244,11 @@ uint32_t xe_memory_heap_alloc(
       return 0;
     }
 #else
-#error ?
+    if (mprotect(p, size, PROT_READ | PROT_WRITE)) {
+      // Failed.
+      XEASSERTALWAYS();
+      return 0;
+    }
 #endif  // WIN32
 
     return base_address;
@@ -258,7 +274,9 @@ int xe_memory_heap_free(
 #if XE_PLATFORM(WIN32)
     return VirtualFree(p, size, MEM_DECOMMIT) ? 0 : 1;
 #else
-#error decommit
+    // Mapping fresh inaccessible pages over the range drops the old ones.
+    return mmap(p, size, PROT_NONE, MAP_PRIVATE | MAP_ANON | MAP_FIXED,
+                -1, 0) == MAP_FAILED ? 1 : 0;
 #endif  // WIN32
   }
 }
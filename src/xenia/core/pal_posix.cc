@@ -21,7 +21,7 @@ xe_pal_posix_t* pal;
 
 void xe_pal_dealloc();
 int xe_pal_init(xe_pal_options_t options) {
-  pal = (xe_pal_posix_t)xe_calloc(sizeof(pal));
+  pal = (xe_pal_posix_t*)xe_calloc(sizeof(xe_pal_posix_t));
 
   //
 
@@ -44,7 +44,7 @@ int xe_pal_get_system_info(xe_system_info* out_info) {
   int nproc = sysconf(_SC_NPROCESSORS_ONLN);
   if (nproc >= 1) {
     // Only able to get logical count.
-    sysInfo->processors.logicalCount = nproc;
+    out_info->processors.logical_count = nproc;
   }
 #else
 #warning no calls to get processor counts
@@ -57,6 +57,6 @@ double xe_pal_now() {
   // http://www.kernel.org/doc/man-pages/online/pages/man2/clock_gettime.2.html
   // http://juliusdavies.ca/posix_clocks/clock_realtime_linux_faq.html
   struct timespec ts;
-  CPIGNORE(clock_gettime(CLOCK_MONOTONIC, &ts));
-  return (double)(ts.tv_sec + (ts.tv_nsec * 1000000000.0));
+  XEIGNORE(clock_gettime(CLOCK_MONOTONIC, &ts));
+  return (double)(ts.tv_sec + (ts.tv_nsec / 1000000000.0));
 }
@@ -19,6 +19,7 @@ typedef struct xe_thread {
   void* callback_param;
 
   void* handle;
+  bool joined;
 } xe_thread_t;
 
 
@@ -36,6 +37,12 @@ xe_thread_ref xe_thread_create(
 }
 
 void xe_thread_dealloc(xe_thread_ref thread) {
+#if !XE_PLATFORM(WIN32)
+  if (thread->handle && !thread->joined) {
+    // Let the thread release its resources when it exits.
+    pthread_detach(reinterpret_cast<pthread_t>(thread->handle));
+  }
+#endif  // !WIN32
   thread->handle = NULL;
   xe_free(thread->name);
 }
@@ -104,6 +111,23 @@ int xe_thread_start(xe_thread_ref thread) {
   return 0;
 }
 
+int xe_thread_join(xe_thread_ref thread) {
+  HANDLE thread_handle = reinterpret_cast<HANDLE>(thread->handle);
+  if (WaitForSingleObject(thread_handle, INFINITE) != WAIT_OBJECT_0) {
+    uint32_t last_error = GetLastError();
+    XELOGE("WaitForSingleObject failed with %d", last_error);
+    return last_error;
+  }
+
+  thread->joined = true;
+
+  return 0;
+}
+
+void xe_thread_yield() {
+  SwitchToThread();
+}
+
 #else
 
 static void* xe_thread_callback_pthreads(void* param) {
@@ -118,16 +142,13 @@ static void* xe_thread_callback_pthreads(void* param) {
 }
 
 int xe_thread_start(xe_thread_ref thread) {
-  pthread_attr_t attr;
-  pthread_attr_init(&attr);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  // Created joinable; xe_thread_dealloc detaches threads that weren't joined.
   pthread_t thread_handle;
   int result_code = pthread_create(
       &thread_handle,
-      &attr,
+      NULL,
       &xe_thread_callback_pthreads,
       thread);
-  pthread_attr_destroy(&attr);
   if (result_code) {
     return result_code;
   }
@@ -137,4 +158,20 @@ int xe_thread_start(xe_thread_ref thread) {
   return 0;
 }
 
+int xe_thread_join(xe_thread_ref thread) {
+  int result_code = pthread_join(
+      reinterpret_cast<pthread_t>(thread->handle), NULL);
+  if (result_code) {
+    return result_code;
+  }
+
+  thread->joined = true;
+
+  return 0;
+}
+
+void xe_thread_yield() {
+  sched_yield();
+}
+
 #endif  // WIN32
@@ -28,6 +28,12 @@ xe_thread_ref xe_thread_retain(xe_thread_ref thread);
 void xe_thread_release(xe_thread_ref thread);
 
 int xe_thread_start(xe_thread_ref thread);
+// Blocks until the thread's callback has returned. Threads that are never
+// joined clean up after themselves when they exit.
+int xe_thread_join(xe_thread_ref thread);
+
+// Gives up the rest of the calling thread's time slice.
+void xe_thread_yield();
 
 
 #endif  // XENIA_CORE_THREAD_H_
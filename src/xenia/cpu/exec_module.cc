@@ -36,6 +36,18 @@ ExecModule::~ExecModule() {
   xe_memory_release(memory_);
 }
 
+const char* ExecModule::name() {
+  return module_name_;
+}
+
+uint32_t ExecModule::code_addr_low() {
+  return code_addr_low_;
+}
+
+uint32_t ExecModule::code_addr_high() {
+  return code_addr_high_;
+}
+
 SymbolDatabase* ExecModule::sdb() {
   return sdb_.get();
 }
@@ -47,6 +59,7 @@ int ExecModule::PrepareRawBinary(uint32_t start_address, uint32_t end_address) {
 
   code_addr_low_ = start_address;
   code_addr_high_ = end_address;
+  sym_table_->AddCodeRange(code_addr_low_, code_addr_high_);
 
   return Prepare();
 }
@@ -56,7 +69,7 @@ int ExecModule::PrepareXexModule(xe_xex2_ref xex) {
       new sdb::XexSymbolDatabase(memory_, export_resolver_.get(),
                                  sym_table_, xex));
 
-  code_addr_low_ = 0;
+  code_addr_low_ = 0xFFFFFFFF;
   code_addr_high_ = 0;
   const xe_xex2_header_t* header = xe_xex2_get_header(xex);
   for (size_t n = 0, i = 0; n < header->section_count; n++) {
@@ -71,6 +84,7 @@ int ExecModule::PrepareXexModule(xe_xex2_ref xex) {
     }
     i += section->info.page_count;
   }
+  sym_table_->AddCodeRange(code_addr_low_, code_addr_high_);
 
   int result_code = Prepare();
   if (result_code) {
@@ -30,6 +30,9 @@ public:
       const char* module_name, const char* module_path);
   ~ExecModule();
 
+  const char* name();
+  uint32_t code_addr_low();
+  uint32_t code_addr_high();
   sdb::SymbolDatabase* sdb();
 
   int PrepareRawBinary(uint32_t start_address, uint32_t end_address);
@@ -34,7 +34,8 @@ void _cdecl XeTrap(
 
 void* _cdecl XeIndirectBranch(
     xe_ppc_state_t* state, uint64_t target, uint64_t br_ia) {
-  // TODO(benvanik): track this statistic - this path is very slow!
+  // NOTE: this path is slow! Sites generally go through an inline cache first
+  // (see XeIndirectBranchMiss) and only end up here when megamorphic.
   Processor* processor = (Processor*)state->processor;
   void* target_ptr = processor->GetFunctionPointer((uint32_t)target);
   // target_ptr will be null when the given target is not a function.
@@ -42,6 +43,33 @@ void* _cdecl XeIndirectBranch(
   return target_ptr;
 }
 
+void* _cdecl XeIndirectBranchMiss(
+    xe_ppc_state_t* state, uint64_t target, uint64_t br_ia,
+    IndirectBranchCache* cache) {
+  Processor* processor = (Processor*)state->processor;
+  void* target_ptr = processor->GetFunctionPointer((uint32_t)target);
+
+  // Racy, but these are only statistics.
+  cache->misses++;
+
+  // Fill the next free entry. Multiple threads may miss on the same site at
+  // once so the slot is claimed atomically, and the target is published last
+  // so that readers never see a target without its pointer.
+  // target_ptr will be null when the given target is not a function. That's
+  // left to the caller and never cached so that the next hit misses again.
+  int32_t n = (int32_t)cache->entry_count;
+  if (target_ptr && n < XE_INDIRECT_BRANCH_CACHE_SIZE &&
+      xe_atomic_cas_32(n, n + 1, (int32_t*)&cache->entry_count)) {
+    IndirectBranchCacheEntry* entry = &cache->entries[n];
+    entry->target_ptr = target_ptr;
+    xe_atomic_cas_64(~0ull, target, &entry->target);
+  } else if (n >= XE_INDIRECT_BRANCH_CACHE_SIZE) {
+    cache->megamorphic = 1;
+  }
+
+  return target_ptr;
+}
+
 void _cdecl XeInvalidInstruction(
     xe_ppc_state_t* state, uint64_t cia, uint64_t data) {
   ppc::InstrData i;
@@ -160,6 +188,7 @@ void _cdecl XeTraceInstruction(
 void xe::cpu::GetGlobalExports(GlobalExports* global_exports) {
   global_exports->XeTrap                = XeTrap;
   global_exports->XeIndirectBranch      = XeIndirectBranch;
+  global_exports->XeIndirectBranchMiss  = XeIndirectBranchMiss;
   global_exports->XeInvalidInstruction  = XeInvalidInstruction;
   global_exports->XeAccessViolation     = XeAccessViolation;
   global_exports->XeTraceKernelCall     = XeTraceKernelCall;
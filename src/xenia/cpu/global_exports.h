@@ -22,11 +22,35 @@ namespace xe {
 namespace cpu {
 
 
+// Inline cache emitted at an indirect branch site.
+// Entries are filled at most once (target is written last) so generated code
+// can read them without locking. Once all entries are used and the site still
+// misses it is marked megamorphic and falls back to the full lookup.
+// Unused entries have a target of ~0 so that they never match.
+#define XE_INDIRECT_BRANCH_CACHE_SIZE 4
+typedef struct {
+  uint64_t  target;
+  void*     target_ptr;
+} IndirectBranchCacheEntry;
+typedef struct {
+  uint32_t  cia;
+  uint32_t  megamorphic;
+  uint64_t  hits;
+  uint64_t  misses;
+  uint32_t  entry_count;
+  uint32_t  reserved;
+  IndirectBranchCacheEntry entries[XE_INDIRECT_BRANCH_CACHE_SIZE];
+} IndirectBranchCache;
+
+
 typedef struct {
   void (_cdecl *XeTrap)(
       xe_ppc_state_t* state, uint64_t cia);
   void* (_cdecl *XeIndirectBranch)(
       xe_ppc_state_t* state, uint64_t target, uint64_t br_ia);
+  void* (_cdecl *XeIndirectBranchMiss)(
+      xe_ppc_state_t* state, uint64_t target, uint64_t br_ia,
+      IndirectBranchCache* cache);
   void (_cdecl *XeInvalidInstruction)(
       xe_ppc_state_t* state, uint64_t cia, uint64_t data);
   void (_cdecl *XeAccessViolation)(
@@ -19,6 +19,7 @@ namespace ppc {
 
 
 void RegisterDisasmCategoryALU();
+void RegisterDisasmCategoryAltivec();
 void RegisterDisasmCategoryControl();
 void RegisterDisasmCategoryFPU();
 void RegisterDisasmCategoryMemory();
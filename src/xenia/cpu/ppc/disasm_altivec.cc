@@ -0,0 +1,727 @@
+/*
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/ppc/disasm.h>
+
+
+using namespace xe::cpu::ppc;
+
+
+namespace xe {
+namespace cpu {
+namespace ppc {
+
+
+// Most of the VMX/VMX128 instructions share a handful of operand layouts.
+
+int XeDisasmVectorMemory(InstrDisasm& d, const char* name, const char* info,
+                         uint32_t vd, uint32_t ra, uint32_t rb,
+                         InstrRegister::Access vd_access) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, vd_access);
+  if (ra) {
+    d.AddRegOperand(InstrRegister::kGPR, ra, InstrRegister::kRead);
+  } else {
+    d.AddUImmOperand(0, 1);
+  }
+  d.AddRegOperand(InstrRegister::kGPR, rb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVector2(InstrDisasm& d, const char* name, const char* info,
+                    uint32_t vd, uint32_t va, uint32_t vb) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVector1(InstrDisasm& d, const char* name, const char* info,
+                    uint32_t vd, uint32_t vb) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVector2Acc(InstrDisasm& d, const char* name, const char* info,
+                       uint32_t vd, uint32_t va, uint32_t vb) {
+  // VD is both a source and the destination.
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kReadWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVector3(InstrDisasm& d, const char* name, const char* info,
+                    uint32_t vd, uint32_t va, uint32_t vc, uint32_t vb) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vc, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVectorCompare(InstrDisasm& d, const char* name, const char* info,
+                          uint32_t vd, uint32_t va, uint32_t vb, uint32_t rc) {
+  d.Init(name, info, rc ? InstrDisasm::kRc : 0);
+  if (rc) {
+    d.AddCR(6, InstrRegister::kWrite);
+  }
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, va, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  return d.Finish();
+}
+
+int XeDisasmVectorSplat(InstrDisasm& d, const char* name, const char* info,
+                        uint32_t vd, uint32_t vb, uint32_t uimm) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, vb, InstrRegister::kRead);
+  d.AddUImmOperand(uimm, 1);
+  return d.Finish();
+}
+
+int XeDisasmVectorSplatImm(InstrDisasm& d, const char* name, const char* info,
+                           uint32_t vd, uint32_t simm) {
+  d.Init(name, info, 0);
+  d.AddRegOperand(InstrRegister::kVMX, vd, InstrRegister::kWrite);
+  d.AddSImmOperand(simm & 0x10 ? simm | 0xFFFFFFF0 : simm, 1);
+  return d.Finish();
+}
+
+
+// Vector load/store (VMX)
+
+XEDISASMR(lvebx,        0x7C00000E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvebx", "Load Vector Element Byte Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvehx,        0x7C00004E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvehx",
+                              "Load Vector Element Half Word Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvewx,        0x7C00008E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvewx", "Load Vector Element Word Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvewx128,     0x10000083, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvewx128",
+                              "Load Vector128 Element Word Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvsl,         0x7C00000C, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsl", "Load Vector for Shift Left",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvsl128,      0x10000003, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsl128", "Load Vector128 for Shift Left",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvsr,         0x7C00004C, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsr", "Load Vector for Shift Right",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvsr128,      0x10000043, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvsr128", "Load Vector128 for Shift Right",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvx,          0x7C0000CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvx", "Load Vector Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvx128,       0x100000C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvx128", "Load Vector128 Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvxl,         0x7C0002CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvxl", "Load Vector Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvxl128,      0x100002C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvxl128", "Load Vector128 Indexed LRU",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(stvebx,       0x7C00010E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvebx", "Store Vector Element Byte Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvehx,       0x7C00014E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvehx",
+                              "Store Vector Element Half Word Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvewx,       0x7C00018E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvewx", "Store Vector Element Word Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvewx128,    0x10000183, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvewx128",
+                              "Store Vector128 Element Word Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+XEDISASMR(stvx,         0x7C0001CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvx", "Store Vector Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvx128,      0x100001C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvx128", "Store Vector128 Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+XEDISASMR(stvxl,        0x7C0003CE, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvxl", "Store Vector Indexed LRU",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvxl128,     0x100003C3, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvxl128", "Store Vector128 Indexed LRU",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+
+// Vector load/store unaligned (Xbox 360 extension)
+
+XEDISASMR(lvlx,         0x7C00040E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlx", "Load Vector Left Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvlx128,      0x10000403, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlx128", "Load Vector128 Left Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvlxl128,     0x10000603, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvlxl128",
+                              "Load Vector128 Left Indexed LRU",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvrx,         0x7C00044E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrx", "Load Vector Right Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kWrite);
+}
+
+XEDISASMR(lvrx128,      0x10000443, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrx128", "Load Vector128 Right Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(lvrxl128,     0x10000643, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "lvrxl128",
+                              "Load Vector128 Right Indexed LRU",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kWrite);
+}
+
+XEDISASMR(stvlx,        0x7C00050E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlx", "Store Vector Left Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvlx128,     0x10000503, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlx128", "Store Vector128 Left Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+XEDISASMR(stvlxl128,    0x10000703, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvlxl128",
+                              "Store Vector128 Left Indexed LRU",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+XEDISASMR(stvrx,        0x7C00054E, X  )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrx", "Store Vector Right Indexed",
+                              i.X.RT, i.X.RA, i.X.RB, InstrRegister::kRead);
+}
+
+XEDISASMR(stvrx128,     0x10000543, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrx128", "Store Vector128 Right Indexed",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+XEDISASMR(stvrxl128,    0x10000743, VX128_1)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorMemory(d, "stvrxl128",
+                              "Store Vector128 Right Indexed LRU",
+                              XEVX128D(i.VX128_1), i.VX128_1.RA, i.VX128_1.RB,
+                              InstrRegister::kRead);
+}
+
+
+// Vector merge/permute/splat
+
+XEDISASMR(vmrghb,       0x1000000C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrghb", "Vector Merge High Byte",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmrghh,       0x1000004C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrghh", "Vector Merge High Half Word",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmrghw,       0x1000008C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrghw", "Vector Merge High Word",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmrghw128,    0x18000300, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrghw128", "Vector128 Merge High Word",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vmrglb,       0x1000010C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrglb", "Vector Merge Low Byte",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmrglh,       0x1000014C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrglh", "Vector Merge Low Half Word",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmrglw,       0x1000018C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrglw", "Vector Merge Low Word",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmrglw128,    0x18000340, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmrglw128", "Vector128 Merge Low Word",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vperm,        0x1000002B, VA )(InstrData& i, InstrDisasm& d) {
+  d.Init("vperm", "Vector Permute", 0);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VD, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VA, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VB, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VC, InstrRegister::kRead);
+  return d.Finish();
+}
+
+XEDISASMR(vperm128,     0x14000000, VX128_2)(InstrData& i, InstrDisasm& d) {
+  d.Init("vperm128", "Vector128 Permute", 0);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128D(i.VX128_2),
+                  InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128A(i.VX128_2),
+                  InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128B(i.VX128_2),
+                  InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, i.VX128_2.VC, InstrRegister::kRead);
+  return d.Finish();
+}
+
+XEDISASMR(vpermwi128,   0x18000210, VX128_P)(InstrData& i, InstrDisasm& d) {
+  d.Init("vpermwi128", "Vector128 Permutate Word Immediate", 0);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128D(i.VX128_P),
+                  InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128B(i.VX128_P),
+                  InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_P.PERMl | (i.VX128_P.PERMh << 5), 1);
+  return d.Finish();
+}
+
+XEDISASMR(vsldoi,       0x1000002C, VA )(InstrData& i, InstrDisasm& d) {
+  d.Init("vsldoi", "Vector Shift Left Double by Octet Immediate", 0);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VD, InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VA, InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, i.VA.VB, InstrRegister::kRead);
+  d.AddUImmOperand(i.VA.VC & 0xF, 1);
+  return d.Finish();
+}
+
+XEDISASMR(vsldoi128,    0x10000010, VX128_5)(InstrData& i, InstrDisasm& d) {
+  d.Init("vsldoi128", "Vector128 Shift Left Double by Octet Immediate", 0);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128D(i.VX128_5),
+                  InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128A(i.VX128_5),
+                  InstrRegister::kRead);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128B(i.VX128_5),
+                  InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_5.SH, 1);
+  return d.Finish();
+}
+
+XEDISASMR(vspltb,       0x1000020C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vspltb", "Vector Splat Byte",
+                             i.VX.VD, i.VX.VB, i.VX.VA & 0xF);
+}
+
+XEDISASMR(vsplth,       0x1000024C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vsplth", "Vector Splat Half Word",
+                             i.VX.VD, i.VX.VB, i.VX.VA & 0x7);
+}
+
+XEDISASMR(vspltw,       0x1000028C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vspltw", "Vector Splat Word",
+                             i.VX.VD, i.VX.VB, i.VX.VA & 0x3);
+}
+
+XEDISASMR(vspltw128,    0x18000730, VX128_3)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplat(d, "vspltw128", "Vector128 Splat Word",
+                             XEVX128D(i.VX128_3), XEVX128B(i.VX128_3),
+                             i.VX128_3.IMM & 0x3);
+}
+
+XEDISASMR(vspltisb,     0x1000030C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImm(d, "vspltisb",
+                                "Vector Splat Immediate Signed Byte",
+                                i.VX.VD, i.VX.VA);
+}
+
+XEDISASMR(vspltish,     0x1000034C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImm(d, "vspltish",
+                                "Vector Splat Immediate Signed Half Word",
+                                i.VX.VD, i.VX.VA);
+}
+
+XEDISASMR(vspltisw,     0x1000038C, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImm(d, "vspltisw",
+                                "Vector Splat Immediate Signed Word",
+                                i.VX.VD, i.VX.VA);
+}
+
+XEDISASMR(vspltisw128,  0x18000770, VX128_3)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorSplatImm(d, "vspltisw128",
+                                "Vector128 Splat Immediate Signed Word",
+                                XEVX128D(i.VX128_3), i.VX128_3.IMM);
+}
+
+
+// Vector floating-point
+
+XEDISASMR(vaddfp,       0x1000000A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vaddfp", "Vector Add Floating Point",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vaddfp128,    0x14000010, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vaddfp128", "Vector128 Add Floating Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vcmpbfp,      0x100003C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpbfp",
+                               "Vector Compare Bounds Floating Point",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEDISASMR(vcmpbfp128,   0x18000180, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpbfp128",
+                               "Vector128 Compare Bounds Floating Point",
+                               XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                               XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEDISASMR(vcmpeqfp,     0x100000C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpeqfp",
+                               "Vector Compare Equal-to Floating Point",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEDISASMR(vcmpeqfp128,  0x18000000, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpeqfp128",
+                               "Vector128 Compare Equal-to Floating Point",
+                               XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                               XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEDISASMR(vcmpgefp,     0x100001C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(
+      d, "vcmpgefp", "Vector Compare Greater-Than-or-Equal-to Floating Point",
+      i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgefp128,  0x18000080, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(
+      d, "vcmpgefp128",
+      "Vector128 Compare Greater-Than-or-Equal-to Floating Point",
+      XEVX128D(i.VX128_R), XEVX128A(i.VX128_R), XEVX128B(i.VX128_R),
+      i.VX128_R.Rc);
+}
+
+XEDISASMR(vcmpgtfp,     0x100002C6, VXR)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtfp",
+                               "Vector Compare Greater-Than Floating Point",
+                               i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEDISASMR(vcmpgtfp128,  0x18000100, VX128_R)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVectorCompare(d, "vcmpgtfp128",
+                               "Vector128 Compare Greater-Than Floating Point",
+                               XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                               XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEDISASMR(vmaddcfp128,  0x14000110, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2Acc(d, "vmaddcfp128",
+                            "Vector128 Multiply Add Floating Point",
+                            XEVX128D(i.VX128), XEVX128A(i.VX128),
+                            XEVX128B(i.VX128));
+}
+
+XEDISASMR(vmaddfp,      0x1000002E, VA )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector3(d, "vmaddfp", "Vector Multiply-Add Floating Point",
+                         i.VA.VD, i.VA.VA, i.VA.VC, i.VA.VB);
+}
+
+XEDISASMR(vmaddfp128,   0x140000D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2Acc(d, "vmaddfp128",
+                            "Vector128 Multiply Add Floating Point",
+                            XEVX128D(i.VX128), XEVX128A(i.VX128),
+                            XEVX128B(i.VX128));
+}
+
+XEDISASMR(vmaxfp,       0x1000040A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmaxfp", "Vector Maximum Floating Point",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vmaxfp128,    0x18000280, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmaxfp128", "Vector128 Maximum Floating Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vminfp,       0x1000044A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vminfp", "Vector Minimum Floating Point",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vminfp128,    0x180002C0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vminfp128", "Vector128 Minimum Floating Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vmsum3fp128,  0x14000190, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmsum3fp128",
+                         "Vector128 Multiply Sum 3-way Floating Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vmsum4fp128,  0x140001D0, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmsum4fp128",
+                         "Vector128 Multiply Sum 4-way Floating Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vmulfp128,    0x14000090, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vmulfp128", "Vector128 Multiply Floating-Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+XEDISASMR(vnmsubfp,     0x1000002F, VA )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector3(d, "vnmsubfp",
+                         "Vector Negative Multiply-Subtract Floating Point",
+                         i.VA.VD, i.VA.VA, i.VA.VC, i.VA.VB);
+}
+
+XEDISASMR(vnmsubfp128,  0x14000150, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2Acc(d, "vnmsubfp128",
+                            "Vector128 Negative Multiply-Subtract Floating Point",
+                            XEVX128D(i.VX128), XEVX128A(i.VX128),
+                            XEVX128B(i.VX128));
+}
+
+XEDISASMR(vrefp,        0x1000010A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector1(d, "vrefp",
+                         "Vector Reciprocal Estimate Floating Point",
+                         i.VX.VD, i.VX.VB);
+}
+
+XEDISASMR(vrefp128,     0x18000630, VX128_3)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector1(d, "vrefp128",
+                         "Vector128 Reciprocal Estimate Floating Point",
+                         XEVX128D(i.VX128_3), XEVX128B(i.VX128_3));
+}
+
+XEDISASMR(vrsqrtefp,    0x1000014A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector1(
+      d, "vrsqrtefp", "Vector Reciprocal Square Root Estimate Floating Point",
+      i.VX.VD, i.VX.VB);
+}
+
+XEDISASMR(vrsqrtefp128, 0x18000670, VX128_3)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector1(
+      d, "vrsqrtefp128",
+      "Vector128 Reciprocal Square Root Estimate Floating Point",
+      XEVX128D(i.VX128_3), XEVX128B(i.VX128_3));
+}
+
+XEDISASMR(vsubfp,       0x1000004A, VX )(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vsubfp", "Vector Subtract Floating Point",
+                         i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEDISASMR(vsubfp128,    0x14000050, VX128)(InstrData& i, InstrDisasm& d) {
+  return XeDisasmVector2(d, "vsubfp128", "Vector128 Subtract Floating Point",
+                         XEVX128D(i.VX128), XEVX128A(i.VX128),
+                         XEVX128B(i.VX128));
+}
+
+
+// Vector D3D pack/unpack (Xbox 360 extension)
+
+XEDISASMR(vpkd3d128,    0x18000610, VX128_4)(InstrData& i, InstrDisasm& d) {
+  d.Init("vpkd3d128", "Vector128 Pack D3Dtype, Rotate Left Immediate and Mask Insert", 0);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128D(i.VX128_4),
+                  InstrRegister::kReadWrite);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128B(i.VX128_4),
+                  InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_4.IMM >> 2, 1);
+  d.AddUImmOperand(i.VX128_4.IMM & 0x3, 1);
+  d.AddUImmOperand(i.VX128_4.z, 1);
+  return d.Finish();
+}
+
+XEDISASMR(vupkd3d128,   0x180007F0, VX128_3)(InstrData& i, InstrDisasm& d) {
+  d.Init("vupkd3d128", "Vector128 Unpack D3Dtype", 0);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128D(i.VX128_3),
+                  InstrRegister::kWrite);
+  d.AddRegOperand(InstrRegister::kVMX, XEVX128B(i.VX128_3),
+                  InstrRegister::kRead);
+  d.AddUImmOperand(i.VX128_3.IMM >> 2, 1);
+  return d.Finish();
+}
+
+
+void RegisterDisasmCategoryAltivec() {
+  XEREGISTERINSTR(lvebx,        0x7C00000E);
+  XEREGISTERINSTR(lvehx,        0x7C00004E);
+  XEREGISTERINSTR(lvewx,        0x7C00008E);
+  XEREGISTERINSTR(lvewx128,     0x10000083);
+  XEREGISTERINSTR(lvsl,         0x7C00000C);
+  XEREGISTERINSTR(lvsl128,      0x10000003);
+  XEREGISTERINSTR(lvsr,         0x7C00004C);
+  XEREGISTERINSTR(lvsr128,      0x10000043);
+  XEREGISTERINSTR(lvx,          0x7C0000CE);
+  XEREGISTERINSTR(lvx128,       0x100000C3);
+  XEREGISTERINSTR(lvxl,         0x7C0002CE);
+  XEREGISTERINSTR(lvxl128,      0x100002C3);
+  XEREGISTERINSTR(stvebx,       0x7C00010E);
+  XEREGISTERINSTR(stvehx,       0x7C00014E);
+  XEREGISTERINSTR(stvewx,       0x7C00018E);
+  XEREGISTERINSTR(stvewx128,    0x10000183);
+  XEREGISTERINSTR(stvx,         0x7C0001CE);
+  XEREGISTERINSTR(stvx128,      0x100001C3);
+  XEREGISTERINSTR(stvxl,        0x7C0003CE);
+  XEREGISTERINSTR(stvxl128,     0x100003C3);
+  XEREGISTERINSTR(lvlx,         0x7C00040E);
+  XEREGISTERINSTR(lvlx128,      0x10000403);
+  XEREGISTERINSTR(lvlxl128,     0x10000603);
+  XEREGISTERINSTR(lvrx,         0x7C00044E);
+  XEREGISTERINSTR(lvrx128,      0x10000443);
+  XEREGISTERINSTR(lvrxl128,     0x10000643);
+  XEREGISTERINSTR(stvlx,        0x7C00050E);
+  XEREGISTERINSTR(stvlx128,     0x10000503);
+  XEREGISTERINSTR(stvlxl128,    0x10000703);
+  XEREGISTERINSTR(stvrx,        0x7C00054E);
+  XEREGISTERINSTR(stvrx128,     0x10000543);
+  XEREGISTERINSTR(stvrxl128,    0x10000743);
+  XEREGISTERINSTR(vmrghb,       0x1000000C);
+  XEREGISTERINSTR(vmrghh,       0x1000004C);
+  XEREGISTERINSTR(vmrghw,       0x1000008C);
+  XEREGISTERINSTR(vmrghw128,    0x18000300);
+  XEREGISTERINSTR(vmrglb,       0x1000010C);
+  XEREGISTERINSTR(vmrglh,       0x1000014C);
+  XEREGISTERINSTR(vmrglw,       0x1000018C);
+  XEREGISTERINSTR(vmrglw128,    0x18000340);
+  XEREGISTERINSTR(vperm,        0x1000002B);
+  XEREGISTERINSTR(vperm128,     0x14000000);
+  XEREGISTERINSTR(vpermwi128,   0x18000210);
+  XEREGISTERINSTR(vsldoi,       0x1000002C);
+  XEREGISTERINSTR(vsldoi128,    0x10000010);
+  XEREGISTERINSTR(vspltb,       0x1000020C);
+  XEREGISTERINSTR(vsplth,       0x1000024C);
+  XEREGISTERINSTR(vspltw,       0x1000028C);
+  XEREGISTERINSTR(vspltw128,    0x18000730);
+  XEREGISTERINSTR(vspltisb,     0x1000030C);
+  XEREGISTERINSTR(vspltish,     0x1000034C);
+  XEREGISTERINSTR(vspltisw,     0x1000038C);
+  XEREGISTERINSTR(vspltisw128,  0x18000770);
+  XEREGISTERINSTR(vaddfp,       0x1000000A);
+  XEREGISTERINSTR(vaddfp128,    0x14000010);
+  XEREGISTERINSTR(vcmpbfp,      0x100003C6);
+  XEREGISTERINSTR(vcmpbfp128,   0x18000180);
+  XEREGISTERINSTR(vcmpeqfp,     0x100000C6);
+  XEREGISTERINSTR(vcmpeqfp128,  0x18000000);
+  XEREGISTERINSTR(vcmpgefp,     0x100001C6);
+  XEREGISTERINSTR(vcmpgefp128,  0x18000080);
+  XEREGISTERINSTR(vcmpgtfp,     0x100002C6);
+  XEREGISTERINSTR(vcmpgtfp128,  0x18000100);
+  XEREGISTERINSTR(vmaddcfp128,  0x14000110);
+  XEREGISTERINSTR(vmaddfp,      0x1000002E);
+  XEREGISTERINSTR(vmaddfp128,   0x140000D0);
+  XEREGISTERINSTR(vmaxfp,       0x1000040A);
+  XEREGISTERINSTR(vmaxfp128,    0x18000280);
+  XEREGISTERINSTR(vminfp,       0x1000044A);
+  XEREGISTERINSTR(vminfp128,    0x180002C0);
+  XEREGISTERINSTR(vmsum3fp128,  0x14000190);
+  XEREGISTERINSTR(vmsum4fp128,  0x140001D0);
+  XEREGISTERINSTR(vmulfp128,    0x14000090);
+  XEREGISTERINSTR(vnmsubfp,     0x1000002F);
+  XEREGISTERINSTR(vnmsubfp128,  0x14000150);
+  XEREGISTERINSTR(vrefp,        0x1000010A);
+  XEREGISTERINSTR(vrefp128,     0x18000630);
+  XEREGISTERINSTR(vrsqrtefp,    0x1000014A);
+  XEREGISTERINSTR(vrsqrtefp128, 0x18000670);
+  XEREGISTERINSTR(vsubfp,       0x1000004A);
+  XEREGISTERINSTR(vsubfp128,    0x14000050);
+  XEREGISTERINSTR(vpkd3d128,    0x18000610);
+  XEREGISTERINSTR(vupkd3d128,   0x180007F0);
+}
+
+
+}  // namespace ppc
+}  // namespace cpu
+}  // namespace xe
@@ -41,7 +41,8 @@ XEDISASMR(addcx,        0x7C000014, XO )(InstrData& i, InstrDisasm& d) {
 
 XEDISASMR(addex,        0x7C000114, XO )(InstrData& i, InstrDisasm& d) {
   d.Init("adde", "Add Extended",
-         (i.XO.OE ? InstrDisasm::kOE : 0) | (i.XO.Rc ? InstrDisasm::kRc : 0));
+         (i.XO.OE ? InstrDisasm::kOE : 0) | (i.XO.Rc ? InstrDisasm::kRc : 0) |
+         InstrDisasm::kCA);
   d.AddRegOperand(InstrRegister::kGPR, i.XO.RT, InstrRegister::kWrite);
   d.AddRegOperand(InstrRegister::kGPR, i.XO.RA, InstrRegister::kRead);
   d.AddRegOperand(InstrRegister::kGPR, i.XO.RB, InstrRegister::kRead);
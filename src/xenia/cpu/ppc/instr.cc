@@ -133,8 +133,10 @@ void InstrAccessBits::MarkAccess(InstrRegister& reg) {
     case InstrRegister::kFPR:
       fpr |= bits << (2 * reg.ordinal);
       break;
-    default:
     case InstrRegister::kVMX:
+      // Vector registers always live in the context and aren't tracked.
+      break;
+    default:
       XEASSERTALWAYS();
       break;
   }
@@ -349,12 +351,43 @@ void InstrDisasm::Dump(std::string& out_str, size_t pad) {
 }
 
 
+namespace {
+
+// Bits that identify an instruction of the given VMX/VMX128 format.
+uint32_t GetVMXFormatMask(uint32_t format) {
+  switch (format) {
+  case kXEPPCInstrFormatVX:       return 0xFC0007FF;
+  case kXEPPCInstrFormatVXR:      return 0xFC0003FF;
+  case kXEPPCInstrFormatVA:       return 0xFC00003F;
+  case kXEPPCInstrFormatVX128:    return 0xFC0003D0;
+  case kXEPPCInstrFormatVX128_1:  return 0xFC0007F3;
+  case kXEPPCInstrFormatVX128_2:  return 0xFC000210;
+  case kXEPPCInstrFormatVX128_3:  return 0xFC0007F0;
+  case kXEPPCInstrFormatVX128_4:  return 0xFC000730;
+  case kXEPPCInstrFormatVX128_5:  return 0xFC000010;
+  case kXEPPCInstrFormatVX128_R:  return 0xFC000390;
+  case kXEPPCInstrFormatVX128_P:  return 0xFC000630;
+  default:                        return 0xFFFFFFFF;
+  }
+}
+
+}  // namespace
+
 InstrType* xe::cpu::ppc::GetInstrType(uint32_t code) {
   InstrType* slot = NULL;
   switch (code >> 26) {
   case 4:
-    // Opcode = 4, index = bits 5-0 (6)
-    slot = &xe::cpu::ppc::tables::instr_table_4[XESELECTBITS(code, 0, 5)];
+  case 5:
+  case 6:
+    // Opcode = 4/5/6, VMX/VMX128, scanned by format mask.
+    for (size_t n = 0; n < XECOUNT(xe::cpu::ppc::tables::instr_table_vmx);
+         n++) {
+      InstrType* vmx_slot = &xe::cpu::ppc::tables::instr_table_vmx[n];
+      if ((code & GetVMXFormatMask(vmx_slot->format)) == vmx_slot->opcode) {
+        slot = vmx_slot;
+        break;
+      }
+    }
     break;
   case 19:
     // Opcode = 19, index = bits 10-1 (10)
@@ -41,6 +41,14 @@ typedef enum {
   kXEPPCInstrFormatVA   = 15,
   kXEPPCInstrFormatVX   = 16,
   kXEPPCInstrFormatVXR  = 17,
+  kXEPPCInstrFormatVX128    = 18,
+  kXEPPCInstrFormatVX128_1  = 19,
+  kXEPPCInstrFormatVX128_2  = 20,
+  kXEPPCInstrFormatVX128_3  = 21,
+  kXEPPCInstrFormatVX128_4  = 22,
+  kXEPPCInstrFormatVX128_5  = 23,
+  kXEPPCInstrFormatVX128_R  = 24,
+  kXEPPCInstrFormatVX128_P  = 25,
 } xe_ppc_instr_format_e;
 
 typedef enum {
@@ -213,11 +221,140 @@ typedef struct {
       uint32_t                : 6;
     } MDS;
     // kXEPPCInstrFormatVA
+    struct {
+      uint32_t        XO      : 6;
+      uint32_t        VC      : 5;
+      uint32_t        VB      : 5;
+      uint32_t        VA      : 5;
+      uint32_t        VD      : 5;
+      uint32_t                : 6;
+    } VA;
     // kXEPPCInstrFormatVX
+    struct {
+      uint32_t        XO      : 11;
+      uint32_t        VB      : 5;
+      uint32_t        VA      : 5;
+      uint32_t        VD      : 5;
+      uint32_t                : 6;
+    } VX;
     // kXEPPCInstrFormatVXR
+    struct {
+      uint32_t        XO      : 10;
+      uint32_t        Rc      : 1;
+      uint32_t        VB      : 5;
+      uint32_t        VA      : 5;
+      uint32_t        VD      : 5;
+      uint32_t                : 6;
+    } VXR;
+
+    // VMX128 register numbers are split across several fields. Use the
+    // XEVX128* macros below to reassemble them.
+    // kXEPPCInstrFormatVX128
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t                : 4;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128;
+    // kXEPPCInstrFormatVX128_1
+    struct {
+      uint32_t                : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 7;
+      uint32_t        RB      : 5;
+      uint32_t        RA      : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_1;
+    // kXEPPCInstrFormatVX128_2
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t        VC      : 3;
+      uint32_t                : 1;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_2;
+    // kXEPPCInstrFormatVX128_3
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 7;
+      uint32_t        VB128l  : 5;
+      uint32_t        IMM     : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_3;
+    // kXEPPCInstrFormatVX128_4
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 2;
+      uint32_t        z       : 2;
+      uint32_t                : 3;
+      uint32_t        VB128l  : 5;
+      uint32_t        IMM     : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_4;
+    // kXEPPCInstrFormatVX128_5
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t        SH      : 4;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_5;
+    // kXEPPCInstrFormatVX128_R
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 1;
+      uint32_t        VA128h  : 1;
+      uint32_t        Rc      : 1;
+      uint32_t                : 3;
+      uint32_t        VA128H  : 1;
+      uint32_t        VB128l  : 5;
+      uint32_t        VA128l  : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_R;
+    // kXEPPCInstrFormatVX128_P
+    struct {
+      uint32_t        VB128h  : 2;
+      uint32_t        VD128h  : 2;
+      uint32_t                : 2;
+      uint32_t        PERMh   : 3;
+      uint32_t                : 2;
+      uint32_t        VB128l  : 5;
+      uint32_t        PERMl   : 5;
+      uint32_t        VD128l  : 5;
+      uint32_t                : 6;
+    } VX128_P;
   };
 } InstrData;
 
+// Reassemble VMX128 register numbers (0-127) from the VX128* format fields.
+#define XEVX128D(f)   ((f).VD128l | ((f).VD128h << 5))
+#define XEVX128A(f)   ((f).VA128l | ((f).VA128h << 5) | ((f).VA128H << 6))
+#define XEVX128B(f)   ((f).VB128l | ((f).VB128h << 5))
+
 
 typedef struct {
   enum RegisterSet {
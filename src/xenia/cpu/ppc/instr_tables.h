@@ -65,13 +65,79 @@ static InstrType* instr_table_prep_63(
 //   pem_64bit_v3.0.2005jul15.pdf, A.2
 //   PowerISA_V2.06B_V2_PUBLIC.pdf
 
-// Opcode = 4, index = bits 5-0 (6)
-static InstrType instr_table_4_unprep[] = {
-  // TODO: all of the vector ops
+// Opcode = 4/5/6, VMX and VMX128 (scanned in order, see GetInstrType)
+// The VMX128 encodings don't share a common index field with VMX, so each
+// entry is matched with a mask derived from its format. More specific
+// formats must come first.
+static InstrType instr_table_vmx[] = {
+  INSTRUCTION(vmrghb,         0x1000000C, VX , General        , 0),
+  INSTRUCTION(vmrghh,         0x1000004C, VX , General        , 0),
+  INSTRUCTION(vmrghw,         0x1000008C, VX , General        , 0),
+  INSTRUCTION(vmrglb,         0x1000010C, VX , General        , 0),
+  INSTRUCTION(vmrglh,         0x1000014C, VX , General        , 0),
+  INSTRUCTION(vmrglw,         0x1000018C, VX , General        , 0),
+  INSTRUCTION(vspltb,         0x1000020C, VX , General        , 0),
+  INSTRUCTION(vsplth,         0x1000024C, VX , General        , 0),
+  INSTRUCTION(vspltw,         0x1000028C, VX , General        , 0),
+  INSTRUCTION(vspltisb,       0x1000030C, VX , General        , 0),
+  INSTRUCTION(vspltish,       0x1000034C, VX , General        , 0),
+  INSTRUCTION(vspltisw,       0x1000038C, VX , General        , 0),
+  INSTRUCTION(vaddfp,         0x1000000A, VX , General        , 0),
+  INSTRUCTION(vsubfp,         0x1000004A, VX , General        , 0),
+  INSTRUCTION(vrefp,          0x1000010A, VX , General        , 0),
+  INSTRUCTION(vrsqrtefp,      0x1000014A, VX , General        , 0),
+  INSTRUCTION(vmaxfp,         0x1000040A, VX , General        , 0),
+  INSTRUCTION(vminfp,         0x1000044A, VX , General        , 0),
+  INSTRUCTION(vcmpeqfp,       0x100000C6, VXR, General        , 0),
+  INSTRUCTION(vcmpgefp,       0x100001C6, VXR, General        , 0),
+  INSTRUCTION(vcmpgtfp,       0x100002C6, VXR, General        , 0),
+  INSTRUCTION(vcmpbfp,        0x100003C6, VXR, General        , 0),
+  INSTRUCTION(vmaddfp,        0x1000002E, VA , General        , 0),
+  INSTRUCTION(vnmsubfp,       0x1000002F, VA , General        , 0),
   INSTRUCTION(vperm,          0x1000002B, VA , General        , 0),
+  INSTRUCTION(vsldoi,         0x1000002C, VA , General        , 0),
+  INSTRUCTION(lvsl128,        0x10000003, VX128_1, General    , 0),
+  INSTRUCTION(lvsr128,        0x10000043, VX128_1, General    , 0),
+  INSTRUCTION(lvewx128,       0x10000083, VX128_1, General    , 0),
+  INSTRUCTION(lvx128,         0x100000C3, VX128_1, General    , 0),
+  INSTRUCTION(stvewx128,      0x10000183, VX128_1, General    , 0),
+  INSTRUCTION(stvx128,        0x100001C3, VX128_1, General    , 0),
+  INSTRUCTION(lvxl128,        0x100002C3, VX128_1, General    , 0),
+  INSTRUCTION(stvxl128,       0x100003C3, VX128_1, General    , 0),
+  INSTRUCTION(lvlx128,        0x10000403, VX128_1, General    , 0),
+  INSTRUCTION(lvrx128,        0x10000443, VX128_1, General    , 0),
+  INSTRUCTION(stvlx128,       0x10000503, VX128_1, General    , 0),
+  INSTRUCTION(stvrx128,       0x10000543, VX128_1, General    , 0),
+  INSTRUCTION(lvlxl128,       0x10000603, VX128_1, General    , 0),
+  INSTRUCTION(lvrxl128,       0x10000643, VX128_1, General    , 0),
+  INSTRUCTION(stvlxl128,      0x10000703, VX128_1, General    , 0),
+  INSTRUCTION(stvrxl128,      0x10000743, VX128_1, General    , 0),
+  INSTRUCTION(vrefp128,       0x18000630, VX128_3, General    , 0),
+  INSTRUCTION(vrsqrtefp128,   0x18000670, VX128_3, General    , 0),
+  INSTRUCTION(vupkd3d128,     0x180007F0, VX128_3, General    , 0),
+  INSTRUCTION(vspltw128,      0x18000730, VX128_3, General    , 0),
+  INSTRUCTION(vspltisw128,    0x18000770, VX128_3, General    , 0),
+  INSTRUCTION(vpkd3d128,      0x18000610, VX128_4, General    , 0),
+  INSTRUCTION(vaddfp128,      0x14000010, VX128, General      , 0),
+  INSTRUCTION(vsubfp128,      0x14000050, VX128, General      , 0),
+  INSTRUCTION(vmulfp128,      0x14000090, VX128, General      , 0),
+  INSTRUCTION(vmaddfp128,     0x140000D0, VX128, General      , 0),
+  INSTRUCTION(vmaddcfp128,    0x14000110, VX128, General      , 0),
+  INSTRUCTION(vnmsubfp128,    0x14000150, VX128, General      , 0),
+  INSTRUCTION(vmsum3fp128,    0x14000190, VX128, General      , 0),
+  INSTRUCTION(vmsum4fp128,    0x140001D0, VX128, General      , 0),
+  INSTRUCTION(vmaxfp128,      0x18000280, VX128, General      , 0),
+  INSTRUCTION(vminfp128,      0x180002C0, VX128, General      , 0),
+  INSTRUCTION(vmrghw128,      0x18000300, VX128, General      , 0),
+  INSTRUCTION(vmrglw128,      0x18000340, VX128, General      , 0),
+  INSTRUCTION(vpermwi128,     0x18000210, VX128_P, General    , 0),
+  INSTRUCTION(vcmpeqfp128,    0x18000000, VX128_R, General    , 0),
+  INSTRUCTION(vcmpgefp128,    0x18000080, VX128_R, General    , 0),
+  INSTRUCTION(vcmpgtfp128,    0x18000100, VX128_R, General    , 0),
+  INSTRUCTION(vcmpbfp128,     0x18000180, VX128_R, General    , 0),
+  INSTRUCTION(vperm128,       0x14000000, VX128_2, General    , 0),
+  INSTRUCTION(vsldoi128,      0x10000010, VX128_5, General    , 0),
 };
-static InstrType* instr_table_4 = instr_table_prep(
-    instr_table_4_unprep, XECOUNT(instr_table_4_unprep), 0, 5);
 
 // Opcode = 19, index = bits 10-1 (10)
 static InstrType instr_table_19_unprep[] = {
@@ -197,6 +263,7 @@ static InstrType instr_table_31_unprep[] = {
   INSTRUCTION(divdx,          0x7C0003D2, XO , General        , 0),
   INSTRUCTION(divwx,          0x7C0003D6, XO , General        , 0),
   INSTRUCTION(lvlx,           0x7C00040E, X  , General        , 0),
+  INSTRUCTION(lvrx,           0x7C00044E, X  , General        , 0),
   INSTRUCTION(ldbrx,          0x7C000428, X  , General        , 0),
   INSTRUCTION(lswx,           0x7C00042A, X  , General        , 0),
   INSTRUCTION(lwbrx,          0x7C00042C, X  , General        , 0),
@@ -208,10 +275,12 @@ static InstrType instr_table_31_unprep[] = {
   INSTRUCTION(sync,           0x7C0004AC, X  , General        , 0),
   INSTRUCTION(lfdx,           0x7C0004AE, X  , General        , 0),
   INSTRUCTION(lfdux,          0x7C0004EE, X  , General        , 0),
+  INSTRUCTION(stvlx,          0x7C00050E, X  , General        , 0),
   INSTRUCTION(stdbrx,         0x7C000528, X  , General        , 0),
   INSTRUCTION(stswx,          0x7C00052A, X  , General        , 0),
   INSTRUCTION(stwbrx,         0x7C00052C, X  , General        , 0),
   INSTRUCTION(stfsx,          0x7C00052E, X  , General        , 0),
+  INSTRUCTION(stvrx,          0x7C00054E, X  , General        , 0),
   INSTRUCTION(stfsux,         0x7C00056E, X  , General        , 0),
   INSTRUCTION(stswi,          0x7C0005AA, X  , General        , 0),
   INSTRUCTION(stfdx,          0x7C0005AE, X  , General        , 0),
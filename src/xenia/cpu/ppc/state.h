@@ -134,6 +134,13 @@ typedef struct XECACHEALIGN64 xe_ppc_state {
   xe_float4_t v[128];             // VMX128 vector registers
   double      f[32];              // Floating-point registers
 
+  // Reservation made by lwarx/ldarx and consumed by stwcx./stdcx.
+  // The value is kept as it was in memory (big-endian) so that the
+  // conditional store can compare against memory directly.
+  uint64_t    reserve_value;
+  uint32_t    reserve_address;
+  uint32_t    reserve_size;       // 0 if no reservation, otherwise 4 or 8
+
   // uint32_t get_fprf() {
   //   return fpscr.value & 0x000F8000;
   // }
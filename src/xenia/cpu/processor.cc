@@ -32,6 +32,7 @@ namespace {
     has_initialized = true;
 
     ppc::RegisterDisasmCategoryALU();
+    ppc::RegisterDisasmCategoryAltivec();
     ppc::RegisterDisasmCategoryControl();
     ppc::RegisterDisasmCategoryFPU();
     ppc::RegisterDisasmCategoryMemory();
@@ -53,16 +54,7 @@ Processor::Processor(xe_memory_ref memory, shared_ptr<Backend> backend) :
 }
 
 Processor::~Processor() {
-  // Cleanup all modules.
-  for (std::vector<ExecModule*>::iterator it = modules_.begin();
-       it != modules_.end(); ++it) {
-    ExecModule* exec_module = *it;
-    if (jit_) {
-      jit_->UninitModule(exec_module);
-    }
-    delete exec_module;
-  }
-  modules_.clear();
+  UnloadModules();
 
   delete jit_;
   delete sym_table_;
@@ -115,6 +107,42 @@ int Processor::Setup() {
   return 0;
 }
 
+void Processor::UnloadModules() {
+  for (std::vector<ExecModule*>::iterator it = modules_.begin();
+       it != modules_.end(); ++it) {
+    ExecModule* exec_module = *it;
+    if (jit_) {
+      jit_->UninitModule(exec_module);
+    }
+    delete exec_module;
+  }
+  modules_.clear();
+}
+
+// Returns the processor to the state it was in just after Setup, so that it
+// (and its memory) can be reused to run another binary. Module code ranges
+// are zeroed and the symbol table and JIT are recreated, which drops all
+// generated code.
+int Processor::Reset() {
+  for (std::vector<ExecModule*>::iterator it = modules_.begin();
+       it != modules_.end(); ++it) {
+    ExecModule* exec_module = *it;
+    if (exec_module->code_addr_low() < exec_module->code_addr_high()) {
+      xe_zero_struct(
+          xe_memory_addr(memory_, exec_module->code_addr_low()),
+          exec_module->code_addr_high() - exec_module->code_addr_low());
+    }
+  }
+  UnloadModules();
+
+  delete jit_;
+  jit_ = NULL;
+  delete sym_table_;
+  sym_table_ = NULL;
+
+  return Setup();
+}
+
 int Processor::LoadRawBinary(const xechar_t* path, uint32_t start_address) {
   ExecModule* exec_module = NULL;
   const xechar_t* name = xestrrchr(path, XE_PATH_SEPARATOR) + 1;
@@ -129,7 +157,10 @@ int Processor::LoadRawBinary(const xechar_t* path, uint32_t start_address) {
 
   int result_code = 1;
 
-  // Place the data into memory at the desired address.
+  // Place the data into memory at the desired address. The guest range is
+  // inaccessible until committed.
+  XEEXPECTNOTZERO(xe_memory_heap_alloc(memory_, start_address,
+                                       (uint32_t)length, 0));
   XEEXPECTZERO(xe_copy_memory(xe_memory_addr(memory_, start_address),
                               xe_memory_get_length(memory_),
                               addr, length));
@@ -235,6 +266,7 @@ uint64_t Processor::Execute(ThreadState* thread_state, uint32_t address,
 
 FunctionSymbol* Processor::GetFunction(uint32_t address) {
   // Attempt to grab the function symbol from the global lookup table.
+  // This is lock-free for addresses within module code ranges.
   FunctionSymbol* fn_symbol = sym_table_->GetFunction(address);
   if (fn_symbol) {
     return fn_symbol;
@@ -259,6 +291,12 @@ FunctionSymbol* Processor::GetFunction(uint32_t address) {
 }
 
 void* Processor::GetFunctionPointer(uint32_t address) {
+  // Fast path: already prepared and in a known code range.
+  void* fn_ptr = sym_table_->GetFunctionPointer(address);
+  if (fn_ptr) {
+    return fn_ptr;
+  }
+
   // Attempt to get the function.
   FunctionSymbol* fn_symbol = GetFunction(address);
   if (!fn_symbol || fn_symbol->type == FunctionSymbol::Unknown) {
@@ -47,6 +47,7 @@ public:
   void set_export_resolver(shared_ptr<kernel::ExportResolver> export_resolver);
 
   int Setup();
+  int Reset();
 
   int LoadRawBinary(const xechar_t* path, uint32_t start_address);
   int LoadXexModule(const char* name, const char* path, xe_xex2_ref xex);
@@ -61,6 +62,8 @@ public:
   void* GetFunctionPointer(uint32_t address);
 
 private:
+  void UnloadModules();
+
   xe_memory_ref       memory_;
   shared_ptr<Backend> backend_;
   shared_ptr<gpu::GraphicsSystem>     graphics_system_;
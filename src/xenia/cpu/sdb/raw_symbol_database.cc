@@ -40,3 +40,7 @@ bool RawSymbolDatabase::IsValueInTextRange(uint32_t value) {
   return value >= start_address_ && value < end_address_;
 }
 
+bool RawSymbolDatabase::IsValueInImageRange(uint32_t value) {
+  return value >= start_address_ && value < end_address_;
+}
+
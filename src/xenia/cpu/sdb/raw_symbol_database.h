@@ -29,6 +29,7 @@ public:
 private:
   virtual uint32_t GetEntryPoint();
   virtual bool IsValueInTextRange(uint32_t value);
+  virtual bool IsValueInImageRange(uint32_t value);
 
   uint32_t start_address_;
   uint32_t end_address_;
@@ -94,6 +94,7 @@ FunctionBlock* FunctionSymbol::SplitBlock(uint32_t address) {
       new_block->outgoing_type = block->outgoing_type;
       new_block->outgoing_address = block->outgoing_address;
       new_block->outgoing_block = block->outgoing_block;
+      new_block->jump_targets.swap(block->jump_targets);
       blocks.insert(std::pair<uint32_t, FunctionBlock*>(address, new_block));
       // Patch up old block.
       block->end_address = address - 4;
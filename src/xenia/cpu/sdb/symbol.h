@@ -15,6 +15,7 @@
 #include <map>
 #include <vector>
 
+#include <xenia/cpu/ppc/instr.h>
 #include <xenia/kernel/export.h>
 
 
@@ -96,6 +97,10 @@ public:
     FunctionSymbol* outgoing_function;
     FunctionBlock*  outgoing_block;
   };
+
+  // Possible targets of a kTargetCTR branch when it was recognized as a
+  // switch through a jump table. All are blocks within the function.
+  std::vector<uint32_t> jump_targets;
 };
 
 class FunctionSymbol : public Symbol {
@@ -112,6 +117,8 @@ public:
     kFlagRestFpr    = 1 << 4,
     kFlagSaveVmx    = 1 << 5,
     kFlagRestVmx    = 1 << 6,
+    kFlagCompiled   = 1 << 7,  // impl_value is the generated function
+    kFlagAccessSummary = 1 << 8,  // access_summary is valid
   };
 
   FunctionSymbol();
@@ -139,6 +146,11 @@ public:
 
   std::map<uint32_t, FunctionBlock*> blocks;
 
+  // Registers that may be read/written by the function or anything it calls.
+  // Only valid with kFlagAccessSummary - without it nothing is known and any
+  // register may be touched (kernel calls, indirect calls, etc).
+  ppc::InstrAccessBits access_summary;
+
   static void AddCall(FunctionSymbol* source, FunctionSymbol* target);
 };
 
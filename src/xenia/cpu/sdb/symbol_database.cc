@@ -9,6 +9,7 @@
 
 #include <xenia/cpu/sdb/symbol_database.h>
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -81,6 +82,10 @@ int SymbolDatabase::Analyze() {
     }
   } while (needs_another_pass);
 
+  // Now that the call graph is complete, fold callees into the register
+  // summaries of their callers.
+  CompleteAccessSummaries();
+
   return 0;
 }
 
@@ -330,8 +335,16 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
       ends_block = true;
     } else if (i.code == 0x4E800420) {
       // bctr -- unconditional branch to CTR.
-      // This is generally a jump to a function pointer (non-return).
+      // This is generally a jump to a function pointer (non-return), unless
+      // it's a switch through a jump table.
       block->outgoing_type = FunctionBlock::kTargetCTR;
+      if (FindJumpTable(fn, addr, block->jump_targets)) {
+        XELOGSDB("bctr %.8X is a switch with %d targets",
+                 addr, (int)block->jump_targets.size());
+        for (size_t n = 0; n < block->jump_targets.size(); n++) {
+          furthest_target = MAX(furthest_target, block->jump_targets[n]);
+        }
+      }
       if (furthest_target > addr) {
         // Remaining targets within function, not end.
         XELOGSDB("ignoring bctr %.8X (branch to %.8X)", addr,
@@ -459,6 +472,11 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
         XELOGSDB("bcctrl %.8X", addr);
       } else {
         XELOGSDB("bcctr %.8X", addr);
+        if (FindJumpTable(fn, addr, block->jump_targets)) {
+          for (size_t n = 0; n < block->jump_targets.size(); n++) {
+            furthest_target = MAX(furthest_target, block->jump_targets[n]);
+          }
+        }
       }
       ends_block = true;
     }
@@ -507,10 +525,23 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
 
   // For each basic block:
   // - find outgoing target block or function
+  // - ensure jump table targets start blocks
   for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
        it != fn->blocks.end(); ++it) {
     FunctionBlock* block = it->second;
 
+    for (size_t n = 0; n < block->jump_targets.size(); n++) {
+      uint32_t target = block->jump_targets[n];
+      if (target > fn->end_address ||
+          (!fn->GetBlock(target) && !fn->SplitBlock(target))) {
+        // Function ended before the target - the table was bogus.
+        XELOGSDB("jump table target %.8X not in function %.8X-%.8X",
+                 target, fn->start_address, fn->end_address);
+        block->jump_targets.clear();
+        break;
+      }
+    }
+
     // If we have some address try to see what it is.
     if (block->outgoing_address) {
       if (block->outgoing_address >= fn->start_address &&
@@ -540,13 +571,218 @@ int SymbolDatabase::AnalyzeFunction(FunctionSymbol* fn) {
   return 0;
 }
 
+bool SymbolDatabase::FindJumpTable(FunctionSymbol* fn, uint32_t address,
+                                   std::vector<uint32_t>& targets) {
+  // Recognizes the switch pattern emitted by the compiler:
+  //   cmplwi  crN, rV, count - 1
+  //   bgt     crN, default
+  //   lis     rB, table@ha
+  //   addi    rB, rB, table@l
+  //   rlwinm  rI, rV, 2, 0, 29
+  //   lwzx    rT, rB, rI
+  //   mtctr   rT
+  //   bctr
+  // The instructions may be scheduled differently, so we walk backwards from
+  // the branch tracking only the registers we care about.
+  const uint32_t max_scan = 16;
+  const uint32_t max_count = 1024;
+  uint8_t* p = xe_memory_addr(memory_, 0);
+
+  uint32_t ctr_reg = 0xFF;
+  uint32_t load_regs[2] = { 0xFF, 0xFF };
+  uint32_t index_reg = 0xFF;
+  uint32_t value_reg = 0xFF;
+  uint32_t base_lo[2] = { 0, 0 };
+  uint32_t base_hi[2] = { 0, 0 };
+  bool has_hi[2] = { false, false };
+  uint32_t count = 0;
+
+  InstrData i;
+  for (uint32_t addr = address - 4;
+       addr >= fn->start_address && addr + max_scan * 4 > address;
+       addr -= 4) {
+    i.code = XEGETUINT32BE(p + addr);
+    i.type = ppc::GetInstrType(i.code);
+    i.address = addr;
+    if (!i.type) {
+      return false;
+    }
+    uint32_t opcode = i.type->opcode;
+    if (opcode == 0x7C0003A6) {
+      // mtspr
+      uint32_t spr = ((i.XFX.spr & 0x1F) << 5) | ((i.XFX.spr >> 5) & 0x1F);
+      if (spr == 9 && ctr_reg == 0xFF) {
+        ctr_reg = i.XFX.RT;
+      }
+    } else if (opcode == 0x7C00002E) {
+      // lwzx
+      if (i.X.RT == ctr_reg && load_regs[0] == 0xFF) {
+        load_regs[0] = i.X.RA;
+        load_regs[1] = i.X.RB;
+      }
+    } else if (opcode == 0x54000000) {
+      // rlwinm
+      if (i.M.SH == 2 && i.M.MB == 0 && i.M.ME == 29 && index_reg == 0xFF) {
+        for (int n = 0; n < 2; n++) {
+          if (i.M.RA == load_regs[n]) {
+            index_reg = n;
+            value_reg = i.M.RT;
+          }
+        }
+      }
+    } else if (opcode == 0x38000000 || opcode == 0x3C000000) {
+      // addi/addis
+      for (int n = 0; n < 2; n++) {
+        if (i.D.RT != load_regs[n] || has_hi[n]) {
+          continue;
+        }
+        if (opcode == 0x38000000 && i.D.RA == load_regs[n]) {
+          base_lo[n] = XEEXTS16(i.D.DS);
+        } else if (opcode == 0x3C000000 && !i.D.RA) {
+          base_hi[n] = i.D.DS << 16;
+          has_hi[n] = true;
+        }
+      }
+    } else if (opcode == 0x28000000) {
+      // cmpli - must be 32-bit and against the switch value
+      if (value_reg != 0xFF && i.D.RA == value_reg && !(i.D.RT & 1)) {
+        count = i.D.DS + 1;
+        break;
+      }
+    } else if (opcode == 0x48000000 || opcode == 0x4C000020 ||
+               opcode == 0x4C000420) {
+      // Flow control other than the bgt to default - give up.
+      return false;
+    }
+  }
+
+  if (!count || count > max_count || index_reg == 0xFF) {
+    return false;
+  }
+  uint32_t base_index = index_reg ^ 1;
+  if (!has_hi[base_index]) {
+    return false;
+  }
+  uint32_t table_address = base_hi[base_index] + base_lo[base_index];
+  if (table_address & 3 ||
+      !IsValueInImageRange(table_address) ||
+      !IsValueInImageRange(table_address + count * 4 - 1)) {
+    return false;
+  }
+
+  // All targets must look like code after the function start. Whether they
+  // are inside the function isn't known until it has been fully scanned.
+  std::vector<uint32_t> table_targets;
+  for (uint32_t n = 0; n < count; n++) {
+    uint32_t target = XEGETUINT32BE(p + table_address + n * 4);
+    if (target & 3 || target <= fn->start_address ||
+        !IsValueInTextRange(target)) {
+      return false;
+    }
+    if (std::find(table_targets.begin(), table_targets.end(), target) ==
+        table_targets.end()) {
+      table_targets.push_back(target);
+    }
+  }
+  targets.swap(table_targets);
+  return true;
+}
+
 int SymbolDatabase::CompleteFunctionGraph(FunctionSymbol* fn) {
   // Find variable accesses.
   // TODO(benvanik): data analysis to find variable accesses.
 
+  // Summarize the registers accessed by the function itself. Anything that
+  // can't be reasoned about leaves the summary invalid.
+  fn->flags &= ~FunctionSymbol::kFlagAccessSummary;
+  fn->access_summary.Clear();
+  if (fn->type != FunctionSymbol::User || !fn->blocks.size()) {
+    return 0;
+  }
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  for (std::map<uint32_t, FunctionBlock*>::iterator it = fn->blocks.begin();
+       it != fn->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    for (uint32_t ia = block->start_address; ia <= block->end_address;
+         ia += 4) {
+      InstrData i;
+      i.address = ia;
+      i.code = XEGETUINT32BE(p + ia);
+      i.type = GetInstrType(i.code);
+      InstrDisasm d;
+      if (!i.type || !i.type->disassemble || i.type->disassemble(i, d)) {
+        fn->access_summary.Clear();
+        return 0;
+      }
+      fn->access_summary.Extend(d.access_bits);
+    }
+    switch (block->outgoing_type) {
+    case FunctionBlock::kTargetLR:
+    case FunctionBlock::kTargetCTR:
+      // Returns and jump tables stay within what we know. Calls through
+      // LR/CTR (LK=1) and other indirect branches could go anywhere.
+      if ((XEGETUINT32BE(p + block->end_address) & 1) ||
+          (block->outgoing_type == FunctionBlock::kTargetCTR &&
+           !block->jump_targets.size())) {
+        fn->access_summary.Clear();
+        return 0;
+      }
+      break;
+    case FunctionBlock::kTargetUnknown:
+      fn->access_summary.Clear();
+      return 0;
+    default:
+      break;
+    }
+  }
+  fn->flags |= FunctionSymbol::kFlagAccessSummary;
+
   return 0;
 }
 
+void SymbolDatabase::CompleteAccessSummaries() {
+  // Fold the summary of each called function into its callers until nothing
+  // changes. This converges as summaries only ever grow or are dropped.
+  // Calling anything without a summary (kernel exports, functions that make
+  // indirect calls) drops the caller's summary too.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (SymbolMap::iterator it = symbols_.begin(); it != symbols_.end();
+         ++it) {
+      if (it->second->symbol_type != Symbol::Function) {
+        continue;
+      }
+      FunctionSymbol* fn = static_cast<FunctionSymbol*>(it->second);
+      if (!(fn->flags & FunctionSymbol::kFlagAccessSummary)) {
+        continue;
+      }
+      for (std::map<uint32_t, FunctionBlock*>::iterator jt =
+           fn->blocks.begin(); jt != fn->blocks.end(); ++jt) {
+        FunctionBlock* block = jt->second;
+        if (block->outgoing_type != FunctionBlock::kTargetFunction) {
+          continue;
+        }
+        FunctionSymbol* target = block->outgoing_function;
+        if (!target ||
+            !(target->flags & FunctionSymbol::kFlagAccessSummary)) {
+          fn->flags &= ~FunctionSymbol::kFlagAccessSummary;
+          fn->access_summary.Clear();
+          changed = true;
+          break;
+        }
+        InstrAccessBits& bits = fn->access_summary;
+        InstrAccessBits& target_bits = target->access_summary;
+        if ((target_bits.spr & ~bits.spr) || (target_bits.cr & ~bits.cr) ||
+            (target_bits.gpr & ~bits.gpr) || (target_bits.fpr & ~bits.fpr)) {
+          bits.Extend(target_bits);
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
 namespace {
 typedef struct {
   uint32_t start_address;
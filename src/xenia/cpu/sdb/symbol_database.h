@@ -56,12 +56,16 @@ protected:
 
   int AnalyzeFunction(FunctionSymbol* fn);
   int CompleteFunctionGraph(FunctionSymbol* fn);
+  void CompleteAccessSummaries();
   bool FillHoles();
   int FlushQueue();
 
   bool IsRestGprLr(uint32_t addr);
+  bool FindJumpTable(FunctionSymbol* fn, uint32_t address,
+                     std::vector<uint32_t>& targets);
   virtual uint32_t GetEntryPoint() = 0;
   virtual bool IsValueInTextRange(uint32_t value) = 0;
+  virtual bool IsValueInImageRange(uint32_t value) = 0;
 
   xe_memory_ref   memory_;
   kernel::ExportResolver* export_resolver_;
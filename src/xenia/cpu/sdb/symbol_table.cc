@@ -18,14 +18,75 @@ using namespace xe::cpu::sdb;
 SymbolTable::SymbolTable() {
   lock_ = xe_mutex_alloc(10000);
   XEASSERTNOTNULL(lock_);
+
+  // 512KB directory. Pages are only allocated for code ranges, and as they
+  // come from calloc the untouched parts are never committed by the OS.
+  pages_ = (Entry**)xe_calloc(kPageCount * sizeof(Entry*));
+  XEASSERTNOTNULL(pages_);
 }
 
 SymbolTable::~SymbolTable() {
+  for (uint32_t n = 0; n < kPageCount; n++) {
+    xe_free(pages_[n]);
+  }
+  xe_free(pages_);
+  pages_ = NULL;
+
   xe_mutex_free(lock_);
   lock_ = NULL;
 }
 
+int SymbolTable::AddCodeRange(uint32_t low_address, uint32_t high_address) {
+  if (low_address >= high_address) {
+    return 1;
+  }
+
+  xe_mutex_lock(lock_);
+
+  for (uint32_t n = low_address >> kPageShift;
+       n <= (high_address - 1) >> kPageShift; n++) {
+    if (pages_[n]) {
+      continue;
+    }
+    Entry* page = (Entry*)xe_calloc(kPageEntryCount * sizeof(Entry));
+    if (!page) {
+      xe_mutex_unlock(lock_);
+      return 1;
+    }
+
+    // Move over anything that was added before the range was known.
+    for (FunctionMap::iterator it = map_.begin(); it != map_.end();) {
+      if (it->first >> kPageShift == n && !(it->first & 3)) {
+        page[(it->first & 0xFFFF) >> 2].symbol = it->second;
+        it = map_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+
+    // Readers don't lock, so the page must be filled before it's published.
+    xe_atomic_cas_ptr(NULL, page, &pages_[n]);
+  }
+
+  xe_mutex_unlock(lock_);
+  return 0;
+}
+
+SymbolTable::Entry* SymbolTable::GetEntry(uint32_t address) {
+  if (address & 3) {
+    return NULL;
+  }
+  Entry* page = pages_[address >> kPageShift];
+  return page ? &page[(address & 0xFFFF) >> 2] : NULL;
+}
+
 int SymbolTable::AddFunction(uint32_t address, FunctionSymbol* symbol) {
+  Entry* entry = GetEntry(address);
+  if (entry) {
+    entry->symbol = symbol;
+    return 0;
+  }
+
   xe_mutex_lock(lock_);
   map_[address] = symbol;
   xe_mutex_unlock(lock_);
@@ -33,9 +94,31 @@ int SymbolTable::AddFunction(uint32_t address, FunctionSymbol* symbol) {
 }
 
 FunctionSymbol* SymbolTable::GetFunction(uint32_t address) {
+  Entry* entry = GetEntry(address);
+  if (entry) {
+    return entry->symbol;
+  }
+
   xe_mutex_lock(lock_);
   FunctionMap::const_iterator it = map_.find(address);
   FunctionSymbol* result = it != map_.end() ? it->second : NULL;
   xe_mutex_unlock(lock_);
   return result;
 }
+
+void SymbolTable::SetFunctionPointer(uint32_t address, void* code) {
+  // Functions outside of code ranges always go the slow way.
+  Entry* entry = GetEntry(address);
+  if (entry) {
+    entry->code = code;
+  }
+}
+
+void* SymbolTable::GetFunctionPointer(uint32_t address) {
+  Entry* entry = GetEntry(address);
+  return entry ? entry->code : NULL;
+}
+
+SymbolTable::Entry** SymbolTable::page_table() {
+  return pages_;
+}
@@ -20,17 +20,41 @@ namespace cpu {
 namespace sdb {
 
 
+// Global guest address -> function lookup.
+// Registered code ranges are covered by a direct-mapped table of 64KB pages,
+// each with an entry for every 4b-aligned address. Lookups in these ranges
+// are lock-free and are simple enough to be inlined into generated code:
+//   entry = page_table()[address >> kPageShift][(address & 0xFFFF) >> 2]
+// Anything outside of a registered range falls back to a locked map.
 class SymbolTable {
 public:
+  static const uint32_t kPageShift      = 16;
+  static const uint32_t kPageCount      = 1 << (32 - kPageShift);
+  static const uint32_t kPageEntryCount = (1 << kPageShift) >> 2;
+
+  typedef struct {
+    sdb::FunctionSymbol*  symbol;
+    void*                 code;     // entry point or redirector, if prepared
+  } Entry;
+
   SymbolTable();
   ~SymbolTable();
 
+  int AddCodeRange(uint32_t low_address, uint32_t high_address);
+
   int AddFunction(uint32_t address, sdb::FunctionSymbol* symbol);
   sdb::FunctionSymbol* GetFunction(uint32_t address);
 
+  void SetFunctionPointer(uint32_t address, void* code);
+  void* GetFunctionPointer(uint32_t address);
+
+  Entry** page_table();
+
 private:
-  // TODO(benvanik): replace with a better data structure.
+  Entry* GetEntry(uint32_t address);
+
   xe_mutex_t* lock_;
+  Entry**     pages_;
   typedef std::tr1::unordered_map<uint32_t, sdb::FunctionSymbol*> FunctionMap;
   FunctionMap map_;
 };
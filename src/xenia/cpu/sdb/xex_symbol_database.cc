@@ -67,6 +67,9 @@ int XexSymbolDatabase::Analyze() {
   // Find __savegprlr_* and __restgprlr_* and the others.
   FindSaveRest();
 
+  // Find CRT routines that the JIT can replace with native versions.
+  FindCrtRoutines();
+
   // Add each import thunk.
   for (size_t n = 0; n < header->import_library_count; n++) {
     AddImports(&header->import_libraries[n]);
@@ -638,7 +641,7 @@ int XexSymbolDatabase::FindSaveRest() {
       FunctionSymbol* fn = GetOrInsertFunction(address);
       fn->set_name(name);
       fn->type = FunctionSymbol::User;
-      fn->flags |= FunctionSymbol::kFlagSaveVmx;
+      fn->flags |= FunctionSymbol::kFlagRestVmx;
       address += 2 * 4;
     }
   }
@@ -646,6 +649,70 @@ int XexSymbolDatabase::FindSaveRest() {
   return 0;
 }
 
+int XexSymbolDatabase::FindCrtRoutines() {
+  // Statically linked CRT routines that are recognizable by their code.
+  // Only the plain byte loop forms are matched here - the unrolled/dcbz
+  // variants differ between XDK versions and are picked up by name when a
+  // map is loaded (--load_module_map).
+  // Values are in memory order, as with FindSaveRest.
+  static const uint32_t strlen_code_values[] = {
+    0x781B6B7C, // mr      r11, r3
+    0x00004B89, // lbz     r10, 0(r11)
+    0x01006B39, // addi    r11, r11, 1
+    0x00000A2B, // cmplwi  cr6, r10, 0
+    0xF4FF9A40, // bne     cr6, -12
+    0x5058637C, // subf    r3, r3, r11
+    0xFFFF6338, // addi    r3, r3, -1
+    0x2000804E, // blr
+  };
+  static const uint32_t memset_code_values[] = {
+    0x781B6B7C, // mr      r11, r3
+    0x0000052B, // cmplwi  cr6, r5, 0
+    0x20009A4D, // beqlr   cr6
+    0xA603A97C, // mtctr   r5
+    0x00008B98, // stb     r4, 0(r11)
+    0x01006B39, // addi    r11, r11, 1
+    0xF8FF0042, // bdnz    -8
+    0x2000804E, // blr
+  };
+  static const struct {
+    const char*     name;
+    const uint32_t* values;
+    size_t          value_count;
+  } routines[] = {
+    { "strlen", strlen_code_values, XECOUNT(strlen_code_values) },
+    { "memset", memset_code_values, XECOUNT(memset_code_values) },
+  };
+
+  const xe_xex2_header_t* header = xe_xex2_get_header(xex_);
+  for (size_t m = 0; m < XECOUNT(routines); m++) {
+    uint32_t address = 0;
+    for (size_t n = 0, i = 0; n < header->section_count && !address; n++) {
+      const xe_xex2_section_t* section = &header->sections[n];
+      const size_t start_address =
+          header->exe_address + (i * xe_xex2_section_length);
+      const size_t end_address =
+          start_address + (section->info.page_count * xe_xex2_section_length);
+      if (section->info.type == XEX_SECTION_CODE) {
+        address = xe_memory_search_aligned(
+            memory_, start_address, end_address,
+            routines[m].values, routines[m].value_count);
+      }
+      i += section->info.page_count;
+    }
+    if (!address) {
+      continue;
+    }
+    FunctionSymbol* fn = GetOrInsertFunction(address);
+    fn->end_address =
+        fn->start_address + (uint32_t)(routines[m].value_count - 1) * 4;
+    fn->set_name(routines[m].name);
+    fn->type = FunctionSymbol::User;
+  }
+
+  return 0;
+}
+
 int XexSymbolDatabase::AddImports(const xe_xex2_import_library_t* library) {
   xe_xex2_import_info_t* import_infos;
   size_t import_info_count;
@@ -769,3 +836,14 @@ bool XexSymbolDatabase::IsValueInTextRange(uint32_t value) {
   }
   return false;
 }
+
+bool XexSymbolDatabase::IsValueInImageRange(uint32_t value) {
+  const xe_xex2_header_t* header = xe_xex2_get_header(xex_);
+  uint32_t low_address = header->exe_address;
+  uint32_t high_address = low_address;
+  for (size_t n = 0; n < header->section_count; n++) {
+    high_address +=
+        header->sections[n].info.page_count * xe_xex2_section_length;
+  }
+  return value >= low_address && value < high_address;
+}
@@ -31,11 +31,13 @@ public:
 
 private:
   int FindSaveRest();
+  int FindCrtRoutines();
   int AddImports(const xe_xex2_import_library_t *library);
   int AddMethodHints();
 
   virtual uint32_t GetEntryPoint();
   virtual bool IsValueInTextRange(uint32_t value);
+  virtual bool IsValueInImageRange(uint32_t value);
 
   xe_xex2_ref xex_;
 };
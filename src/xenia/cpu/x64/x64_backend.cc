@@ -32,6 +32,7 @@ namespace {
     has_initialized = true;
 
     X64RegisterEmitCategoryALU();
+    X64RegisterEmitCategoryAltivec();
     X64RegisterEmitCategoryControl();
     X64RegisterEmitCategoryFPU();
     X64RegisterEmitCategoryMemory();
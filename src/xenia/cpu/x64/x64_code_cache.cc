@@ -0,0 +1,388 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/x64/x64_code_cache.h>
+
+#include <xenia/cpu/cpu-private.h>
+#include <xenia/cpu/x64/x64_emitter.h>
+
+#include <asmjit/asmjit.h>
+#include <beaengine/BeaEngine.h>
+
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::x64;
+
+using namespace AsmJit;
+
+
+namespace {
+
+// Bump whenever the file layout changes. Changes to the emitted code are
+// covered by the config hash (see X64Emitter::GetConfigHash).
+const uint32_t kCacheMagic    = 0x58434330; // 'XCC0'
+const uint32_t kCacheVersion  = 1;
+
+const uint16_t kFixupRel32    = 0x84;
+
+typedef struct {
+  uint32_t  magic;
+  uint32_t  version;
+  uint64_t  image_hash;
+  uint32_t  config_hash;
+  uint32_t  entry_count;
+} FileHeader;
+
+}
+
+
+X64CodeCache::X64CodeCache(const char* path, uint64_t image_hash,
+                           uint32_t config_hash,
+                           uint32_t code_addr_low, uint32_t code_addr_high) :
+    image_hash_(image_hash), config_hash_(config_hash),
+    code_addr_low_(code_addr_low), code_addr_high_(code_addr_high),
+    file_data_(NULL), file_length_(0), dirty_(false) {
+  path_ = xestrdupa(path);
+  lock_ = xe_mutex_alloc(10000);
+  XEASSERTNOTNULL(lock_);
+}
+
+X64CodeCache::~X64CodeCache() {
+  for (std::vector<EntryHeader*>::iterator it = pending_.begin();
+       it != pending_.end(); ++it) {
+    xe_free(*it);
+  }
+  pending_.clear();
+  entries_.clear();
+  xe_free(file_data_);
+  xe_mutex_free(lock_);
+  xe_free(path_);
+}
+
+uint32_t X64CodeCache::code_addr_low() {
+  return code_addr_low_;
+}
+
+uint32_t X64CodeCache::code_addr_high() {
+  return code_addr_high_;
+}
+
+int X64CodeCache::Load() {
+  FILE* file = fopen(path_, "rb");
+  if (!file) {
+    // No cache yet - that's fine, we'll create one on flush.
+    return 0;
+  }
+
+  int result_code = 1;
+  const FileHeader* header = NULL;
+  const uint8_t* p = NULL;
+  const uint8_t* end = NULL;
+
+  fseek(file, 0, SEEK_END);
+  file_length_ = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  XEEXPECT(file_length_ >= sizeof(FileHeader));
+
+  file_data_ = (uint8_t*)xe_malloc(file_length_);
+  XEEXPECTNOTNULL(file_data_);
+  XEEXPECT(fread(file_data_, 1, file_length_, file) == file_length_);
+
+  // Ignore (and later overwrite) caches from other builds or images.
+  header = (const FileHeader*)file_data_;
+  if (header->magic != kCacheMagic ||
+      header->version != kCacheVersion ||
+      header->image_hash != image_hash_ ||
+      header->config_hash != config_hash_) {
+    XELOGCPU("Code cache %s is stale, ignoring", path_);
+    result_code = 0;
+    XEFAIL();
+  }
+
+  // Index all entries. The code stays in the file buffer until requested.
+  p = file_data_ + sizeof(FileHeader);
+  end = file_data_ + file_length_;
+  for (uint32_t n = 0; n < header->entry_count; n++) {
+    const EntryHeader* entry = (const EntryHeader*)p;
+    XEEXPECT(p + sizeof(EntryHeader) <= end);
+    size_t entry_size = sizeof(EntryHeader) +
+        entry->fixup_count * sizeof(Fixup) + entry->code_size;
+    XEEXPECT(p + entry_size <= end);
+    if (ValidateEntry(entry)) {
+      entries_.insert(EntryMap::value_type(entry->address, entry));
+    } else {
+      XELOGCPU("Code cache: ignoring corrupt entry for %.8X", entry->address);
+    }
+    p += XEROUNDUP(entry_size, 8);
+  }
+
+  XELOGCPU("Code cache %s: %d functions", path_, (int)entries_.size());
+
+  result_code = 0;
+XECLEANUP:
+  if (result_code || !entries_.size()) {
+    entries_.clear();
+    xe_free(file_data_);
+    file_data_ = NULL;
+    file_length_ = 0;
+  }
+  fclose(file);
+  return result_code;
+}
+
+bool X64CodeCache::ValidateEntry(const EntryHeader* entry) {
+  // Every fixup must be patched entirely within the function's code.
+  const Fixup* fixups = (const Fixup*)(entry + 1);
+  for (uint32_t n = 0; n < entry->fixup_count; n++) {
+    const Fixup& fixup = fixups[n];
+    uint32_t width;
+    switch (fixup.size) {
+      case 8:
+        width = 8;
+        break;
+      case 4:
+      case kFixupRel32:
+        width = 4;
+        break;
+      default:
+        return false;
+    }
+    if (fixup.offset > entry->code_size ||
+        entry->code_size - fixup.offset < width) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int X64CodeCache::Flush() {
+  xe_mutex_lock(lock_);
+  if (!dirty_) {
+    xe_mutex_unlock(lock_);
+    return 0;
+  }
+
+  int result_code = 1;
+  FileHeader header;
+  static const uint8_t padding[8] = { 0 };
+
+  FILE* file = fopen(path_, "wb");
+  XEEXPECTNOTNULL(file);
+
+  // Everything in the index is rewritten - both entries loaded from the old
+  // file and ones added this run.
+  header.magic        = kCacheMagic;
+  header.version      = kCacheVersion;
+  header.image_hash   = image_hash_;
+  header.config_hash  = config_hash_;
+  header.entry_count  = (uint32_t)entries_.size();
+  XEEXPECT(fwrite(&header, sizeof(header), 1, file) == 1);
+  for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it) {
+    const EntryHeader* entry = it->second;
+    size_t entry_size = sizeof(EntryHeader) +
+        entry->fixup_count * sizeof(Fixup) + entry->code_size;
+    XEEXPECT(fwrite(entry, entry_size, 1, file) == 1);
+    size_t padding_size = XEROUNDUP(entry_size, 8) - entry_size;
+    if (padding_size) {
+      XEEXPECT(fwrite(padding, padding_size, 1, file) == 1);
+    }
+  }
+
+  dirty_ = false;
+  result_code = 0;
+XECLEANUP:
+  if (file) {
+    fclose(file);
+  }
+  if (result_code) {
+    XELOGE("Unable to write code cache %s", path_);
+  }
+  xe_mutex_unlock(lock_);
+  return result_code;
+}
+
+void* X64CodeCache::LoadFunction(X64Emitter* emitter, uint32_t address,
+                                 size_t* out_code_size) {
+  xe_mutex_lock(lock_);
+  EntryMap::iterator it = entries_.find(address);
+  const EntryHeader* entry = it != entries_.end() ? it->second : NULL;
+  xe_mutex_unlock(lock_);
+  if (!entry) {
+    return NULL;
+  }
+
+  const Fixup* fixups = (const Fixup*)(entry + 1);
+  const uint8_t* code = (const uint8_t*)(fixups + entry->fixup_count);
+
+  uint8_t* fn_ptr = (uint8_t*)MemoryManager::getGlobal()->alloc(
+      entry->code_size, kMemoryAllocFreeable);
+  if (!fn_ptr) {
+    return NULL;
+  }
+  xe_copy_struct(fn_ptr, code, entry->code_size);
+
+  for (uint32_t n = 0; n < entry->fixup_count; n++) {
+    const Fixup& fixup = fixups[n];
+    uint8_t* p = fn_ptr + fixup.offset;
+    uint64_t value;
+    bool valid = !emitter->ResolveFixupValue(fixup.type, fixup.key, &value);
+    if (valid) {
+      switch (fixup.size) {
+        case 8:
+          XESETUINT64LE(p, value);
+          break;
+        case 4:
+          valid = value <= 0xFFFFFFFFull;
+          XESETUINT32LE(p, (uint32_t)value);
+          break;
+        case kFixupRel32:
+          {
+            int64_t rel = (int64_t)value - (int64_t)(p + 4);
+            valid = rel == (int32_t)rel;
+            XESETUINT32LE(p, (uint32_t)(int32_t)rel);
+          }
+          break;
+        default:
+          valid = false;
+          break;
+      }
+    }
+    if (!valid) {
+      // Can't be bound (function no longer exists, out of range/etc).
+      // The caller will fall back to compiling the function.
+      XELOGCPU("Code cache: unable to bind fixup %d/%.8X in %.8X",
+               fixup.type, fixup.key, address);
+      MemoryManager::getGlobal()->free(fn_ptr);
+      return NULL;
+    }
+  }
+
+  *out_code_size = entry->code_size;
+  return fn_ptr;
+}
+
+int X64CodeCache::AddFunction(uint32_t address,
+                              const uint8_t* code, size_t code_size,
+                              size_t instr_size,
+                              std::vector<X64FixupValue>& fixup_values) {
+  // Walk the instructions and find every place that references one of the
+  // values the emitter told us about. Immediates/displacements are matched
+  // by value within the instruction bytes, and relative branches by their
+  // resolved target. The trampolines AsmJit appends after the instructions
+  // are just absolute addresses.
+  std::vector<Fixup> fixups;
+  std::vector<bool> covered(code_size, false);
+  DISASM d;
+  xe_zero_struct(&d, sizeof(d));
+  d.Archi = 64;
+  d.EIP = (UIntPtr)code;
+  d.VirtualAddr = (UInt64)code;
+  while (d.EIP < (UIntPtr)(code + instr_size)) {
+    d.SecurityBlock = (UInt32)((UIntPtr)(code + instr_size) - d.EIP);
+    int len = Disasm(&d);
+    if (len == UNKNOWN_OPCODE || len <= 0) {
+      // Can't reason about this code - don't cache it.
+      return 1;
+    }
+    const uint8_t* ip = (const uint8_t*)d.EIP;
+    if (d.Instruction.BranchType && d.Instruction.AddrValue &&
+        (d.Instruction.AddrValue < (UInt64)code ||
+         d.Instruction.AddrValue >= (UInt64)(code + code_size))) {
+      // Relative branch out of the function (rel32 is always last).
+      const uint8_t* rel_p = ip + len - 4;
+      if ((UInt64)(rel_p + 4 + (int32_t)XEGETUINT32LE(rel_p)) ==
+          d.Instruction.AddrValue) {
+        bool found = false;
+        for (size_t m = 0; m < fixup_values.size(); m++) {
+          if (fixup_values[m].value == d.Instruction.AddrValue) {
+            Fixup fixup = {
+              (uint32_t)(rel_p - code), (uint16_t)fixup_values[m].type,
+              kFixupRel32, fixup_values[m].key };
+            fixups.push_back(fixup);
+            found = true;
+            break;
+          }
+        }
+        if (!found) {
+          // Branch to something we can't rebind.
+          return 1;
+        }
+      }
+    }
+    for (size_t m = 0; m < fixup_values.size(); m++) {
+      const X64FixupValue& fv = fixup_values[m];
+      for (int o = 0; o + 4 <= len; o++) {
+        if (o + 8 <= len && XEGETUINT64LE(ip + o) == fv.value) {
+          Fixup fixup = {
+            (uint32_t)(ip + o - code), (uint16_t)fv.type, 8, fv.key };
+          fixups.push_back(fixup);
+          break;
+        } else if (fv.value <= 0xFFFFFFFFull &&
+                   XEGETUINT32LE(ip + o) == (uint32_t)fv.value) {
+          Fixup fixup = {
+            (uint32_t)(ip + o - code), (uint16_t)fv.type, 4, fv.key };
+          fixups.push_back(fixup);
+          break;
+        }
+      }
+    }
+    d.EIP += len;
+    d.VirtualAddr += len;
+  }
+  for (size_t o = instr_size; o + 8 <= code_size; o++) {
+    for (size_t m = 0; m < fixup_values.size(); m++) {
+      const X64FixupValue& fv = fixup_values[m];
+      if (XEGETUINT64LE(code + o) == fv.value) {
+        Fixup fixup = { (uint32_t)o, (uint16_t)fv.type, 8, fv.key };
+        fixups.push_back(fixup);
+        break;
+      }
+    }
+  }
+
+  // Sanity check: no recorded 64-bit value may remain un-fixed anywhere in
+  // the buffer, otherwise we'd be persisting a pointer from this process.
+  for (size_t n = 0; n < fixups.size(); n++) {
+    size_t size = fixups[n].size == kFixupRel32 ? 4 : fixups[n].size;
+    for (size_t o = 0; o < size; o++) {
+      covered[fixups[n].offset + o] = true;
+    }
+  }
+  for (size_t o = 0; o + 8 <= code_size; o++) {
+    if (covered[o]) {
+      continue;
+    }
+    for (size_t m = 0; m < fixup_values.size(); m++) {
+      if (XEGETUINT64LE(code + o) == fixup_values[m].value) {
+        return 1;
+      }
+    }
+  }
+
+  size_t entry_size = sizeof(EntryHeader) +
+      fixups.size() * sizeof(Fixup) + code_size;
+  EntryHeader* entry = (EntryHeader*)xe_calloc(entry_size);
+  entry->address      = address;
+  entry->code_size    = (uint32_t)code_size;
+  entry->fixup_count  = (uint32_t)fixups.size();
+  Fixup* entry_fixups = (Fixup*)(entry + 1);
+  for (size_t n = 0; n < fixups.size(); n++) {
+    entry_fixups[n] = fixups[n];
+  }
+  xe_copy_struct(entry_fixups + fixups.size(), code, code_size);
+
+  xe_mutex_lock(lock_);
+  entries_[address] = entry;
+  pending_.push_back(entry);
+  dirty_ = true;
+  xe_mutex_unlock(lock_);
+
+  return 0;
+}
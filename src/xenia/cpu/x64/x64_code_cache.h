@@ -0,0 +1,115 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_X64_X64_CODE_CACHE_H_
+#define XENIA_CPU_X64_X64_CODE_CACHE_H_
+
+#include <xenia/core.h>
+
+#include <vector>
+
+
+namespace xe {
+namespace cpu {
+namespace x64 {
+
+
+// Identifies what an absolute host value embedded in generated code refers
+// to, so that it can be rebound when the code is loaded in another process.
+enum X64FixupType {
+  kX64FixupMembase        = 0,  // key unused
+  kX64FixupGpuThis        = 1,  // key unused
+  kX64FixupGpuRead        = 2,  // key unused
+  kX64FixupGpuWrite       = 3,  // key unused
+  kX64FixupGlobalExport   = 4,  // key = offset into GlobalExports
+  kX64FixupSymbol         = 5,  // key = guest address of FunctionSymbol
+  kX64FixupFunction       = 6,  // key = guest address of function to call
+  kX64FixupSymbolTable    = 7,  // key unused
+  kX64FixupIndirectBranchCache = 8, // key = guest address of branch site
+  kX64FixupVectorConstants = 9, // key unused
+};
+
+// A host value the emitter embedded into a function while generating it.
+typedef struct {
+  uint64_t  value;
+  uint32_t  type;
+  uint32_t  key;
+} X64FixupValue;
+
+
+class X64Emitter;
+
+
+// Persistent on-disk cache of generated functions.
+// One cache file exists per module and is keyed by a hash of the module image
+// (and the codegen-affecting flags). Each entry holds the x64 code for one
+// guest function along with a list of fixups describing every location that
+// contains a process-specific value (memory base, export thunks, callees/etc).
+// Loading an entry copies the code into executable memory and patches the
+// fixups, skipping analysis and AsmJit entirely.
+class X64CodeCache {
+public:
+  X64CodeCache(const char* path, uint64_t image_hash, uint32_t config_hash,
+               uint32_t code_addr_low, uint32_t code_addr_high);
+  ~X64CodeCache();
+
+  uint32_t code_addr_low();
+  uint32_t code_addr_high();
+
+  int Load();
+  int Flush();
+
+  void* LoadFunction(X64Emitter* emitter, uint32_t address,
+                     size_t* out_code_size);
+  int AddFunction(uint32_t address,
+                  const uint8_t* code, size_t code_size, size_t instr_size,
+                  std::vector<X64FixupValue>& fixup_values);
+
+private:
+  typedef struct {
+    uint32_t  offset;
+    uint16_t  type;
+    uint16_t  size;     // 4 = abs32, 8 = abs64, 0x84 = rel32
+    uint32_t  key;
+  } Fixup;
+  typedef struct {
+    uint32_t  address;
+    uint32_t  code_size;
+    uint32_t  fixup_count;
+    uint32_t  reserved;
+    // Fixup[fixup_count]
+    // uint8_t[code_size]
+  } EntryHeader;
+  typedef std::tr1::unordered_map<uint32_t, const EntryHeader*> EntryMap;
+
+  bool ValidateEntry(const EntryHeader* entry);
+
+  char*       path_;
+  uint64_t    image_hash_;
+  uint32_t    config_hash_;
+  uint32_t    code_addr_low_;
+  uint32_t    code_addr_high_;
+
+  xe_mutex_t* lock_;
+  // Entries loaded from disk point into file_data_. Entries added this run are
+  // individually allocated and tracked in pending_ until flushed.
+  uint8_t*    file_data_;
+  size_t      file_length_;
+  EntryMap    entries_;
+  std::vector<EntryHeader*> pending_;
+  bool        dirty_;
+};
+
+
+}  // namespace x64
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_X64_X64_CODE_CACHE_H_
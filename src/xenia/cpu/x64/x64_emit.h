@@ -21,10 +21,17 @@ namespace x64 {
 
 
 void X64RegisterEmitCategoryALU();
+void X64RegisterEmitCategoryAltivec();
 void X64RegisterEmitCategoryControl();
 void X64RegisterEmitCategoryFPU();
 void X64RegisterEmitCategoryMemory();
 
+// Returns the table of constants used by the vector emitters.
+// Generated code embeds this pointer (see kX64FixupVectorConstants).
+const void* X64GetVectorConstants();
+// Returns the host features and flags that change the vector codegen.
+uint32_t X64GetVectorConfig();
+
 
 #define XEEMITTER(name, opcode, format) int InstrEmit_##name
 
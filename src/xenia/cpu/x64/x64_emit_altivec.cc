@@ -0,0 +1,1320 @@
+/*
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/x64/x64_emit.h>
+
+#include <xenia/cpu/cpu-private.h>
+
+
+using namespace xe::cpu;
+using namespace xe::cpu::ppc;
+
+using namespace AsmJit;
+
+
+DEFINE_bool(vmx_non_java_mode, true,
+    "Flush denormal VMX floating-point results to zero (non-Java mode).");
+DEFINE_bool(vmx_sse41, true,
+    "Use SSE4.1 for VMX instructions when the host supports it.");
+
+
+// Vector registers are kept in the context as four host-endian 32-bit words,
+// so word element n of a guest register is dword lane n of an xmm register.
+// Byte element n lives in host byte (n ^ 3) and half word element n in host
+// word (n ^ 1). Loads and stores byte swap each word with pshufb, and all of
+// the byte/half word shuffles are done with pshufb controls that fold in that
+// swizzle. The controls are precomputed into a single table so that generated
+// code only embeds one pointer.
+
+
+namespace {
+
+enum {
+  kMergeHighByte  = 0,
+  kMergeHighHalf  = 1,
+  kMergeLowByte   = 2,
+  kMergeLowHalf   = 3,
+};
+
+typedef struct XECACHEALIGN64 {
+  uint8_t   byte_swap[16];
+  uint8_t   perm_index_mask[16];
+  uint8_t   perm_index_swap[16];
+  uint8_t   perm_a_bias[16];
+  uint8_t   perm_b_bias[16];
+  // Indexed by EA & 0xF.
+  uint8_t   lvsl[16][16];
+  uint8_t   lvsr[16][16];
+  uint8_t   lvl[16][16];
+  uint8_t   lvr[16][16];
+  uint8_t   stvl[16][16];
+  uint8_t   stvl_mask[16][16];
+  uint8_t   stvr[16][16];
+  uint8_t   stvr_mask[16][16];
+  // Indexed by instruction immediate.
+  uint8_t   sldoi_a[16][16];
+  uint8_t   sldoi_b[16][16];
+  uint8_t   splat_b[16][16];
+  uint8_t   splat_h[8][16];
+  uint8_t   merge_a[4][16];
+  uint8_t   merge_b[4][16];
+  // Floating-point.
+  uint32_t  sign_mask[4];
+  uint32_t  abs_mask[4];
+  uint32_t  min_normal[4];
+  uint32_t  one[4];
+  uint32_t  dot3_mask[4];
+  // D3D pack/unpack. Packed values are carried in the low mantissa bits of
+  // floats biased by 3.0 (or 1.0 for unpacked D3DCOLOR).
+  uint32_t  d3dcolor_min[4];
+  uint32_t  d3dcolor_max[4];
+  uint32_t  short_min[4];
+  uint32_t  short_max[4];
+  uint8_t   pack_d3dcolor[16];
+  uint8_t   pack_short2[16];
+  uint8_t   pack_short4[16];
+  uint8_t   unpack_d3dcolor[16];
+  uint8_t   unpack_short2[16];
+  uint8_t   unpack_short4[16];
+  uint32_t  unpack_d3dcolor_add[4];
+  uint32_t  unpack_short2_add[4];
+  uint32_t  unpack_short4_add[4];
+  // Indexed by destination element: [0] = element 3 only (32-bit insert),
+  // [1] = elements 2-3 (64-bit insert), before rotating into place.
+  uint32_t  insert_mask[2][4];
+} VectorConstants;
+
+VectorConstants vector_constants_;
+
+// Converts a byte selection in guest order (0-15 = VA, 16-31 = VB,
+// 0xFF = zero) into pshufb controls that operate on the register layout.
+void BuildShuffle(const uint8_t sel[16], uint8_t ctl_a[16], uint8_t ctl_b[16]) {
+  for (int k = 0; k < 16; k++) {
+    uint8_t s = sel[k ^ 3];
+    ctl_a[k] = s < 16 ? s ^ 3 : 0x80;
+    ctl_b[k] = (s >= 16 && s < 32) ? (s - 16) ^ 3 : 0x80;
+  }
+}
+
+void InitializeVectorConstants() {
+  VectorConstants& vc = vector_constants_;
+  uint8_t sel[16];
+  uint8_t unused[16];
+
+  for (int k = 0; k < 16; k++) {
+    vc.byte_swap[k]       = k ^ 3;
+    vc.perm_index_mask[k] = 0x1F;
+    vc.perm_index_swap[k] = 0x03;
+    vc.perm_a_bias[k]     = 0x70;
+    vc.perm_b_bias[k]     = 0xF0;
+  }
+
+  for (int sh = 0; sh < 16; sh++) {
+    for (int k = 0; k < 16; k++) {
+      int j = k ^ 3;
+      vc.lvsl[sh][k]  = (uint8_t)(sh + j);
+      vc.lvsr[sh][k]  = (uint8_t)(16 - sh + j);
+      // Loads shuffle raw (guest order) memory into the register layout.
+      vc.lvl[sh][k]   = j + sh < 16 ? (uint8_t)(j + sh) : 0x80;
+      vc.lvr[sh][k]   = (sh && j >= 16 - sh) ? (uint8_t)(j - (16 - sh)) : 0x80;
+      // Stores shuffle the register layout into guest order memory.
+      vc.stvl[sh][k]  = k >= sh ? (uint8_t)((k - sh) ^ 3) : 0x80;
+      vc.stvl_mask[sh][k] = k >= sh ? 0xFF : 0x00;
+      vc.stvr[sh][k]  = k < sh ? (uint8_t)((16 - sh + k) ^ 3) : 0x80;
+      vc.stvr_mask[sh][k] = k < sh ? 0xFF : 0x00;
+    }
+
+    for (int j = 0; j < 16; j++) {
+      sel[j] = (uint8_t)(j + sh);
+    }
+    BuildShuffle(sel, vc.sldoi_a[sh], vc.sldoi_b[sh]);
+
+    for (int j = 0; j < 16; j++) {
+      sel[j] = (uint8_t)sh;
+    }
+    BuildShuffle(sel, vc.splat_b[sh], unused);
+  }
+
+  for (int h = 0; h < 8; h++) {
+    for (int j = 0; j < 16; j++) {
+      sel[j] = (uint8_t)(h * 2 + (j & 1));
+    }
+    BuildShuffle(sel, vc.splat_h[h], unused);
+  }
+
+  for (int low = 0; low < 2; low++) {
+    for (int j = 0; j < 16; j++) {
+      // Bytes alternate VA/VB.
+      sel[j] = (uint8_t)((j & 1) * 16 + low * 8 + (j >> 1));
+    }
+    BuildShuffle(sel, vc.merge_a[kMergeHighByte + low * 2],
+                 vc.merge_b[kMergeHighByte + low * 2]);
+    for (int j = 0; j < 16; j++) {
+      // Half words alternate VA/VB.
+      int h = j >> 1;
+      sel[j] = (uint8_t)((h & 1) * 16 + low * 8 + (h >> 1) * 2 + (j & 1));
+    }
+    BuildShuffle(sel, vc.merge_a[kMergeHighHalf + low * 2],
+                 vc.merge_b[kMergeHighHalf + low * 2]);
+  }
+
+  for (int n = 0; n < 4; n++) {
+    vc.sign_mask[n]         = 0x80000000;
+    vc.abs_mask[n]          = 0x7FFFFFFF;
+    vc.min_normal[n]        = 0x00800000;
+    vc.one[n]               = 0x3F800000;
+    vc.dot3_mask[n]         = n < 3 ? 0xFFFFFFFF : 0;
+    vc.d3dcolor_min[n]      = 0x40400000;
+    vc.d3dcolor_max[n]      = 0x404000FF;
+    vc.short_min[n]         = 0x403F8001;
+    vc.short_max[n]         = 0x40407FFF;
+    vc.unpack_d3dcolor_add[n] = 0x3F800000;
+    vc.unpack_short2_add[n] = n < 2 ? 0x40400000 : (n == 3 ? 0x3F800000 : 0);
+    vc.unpack_short4_add[n] = 0x40400000;
+    vc.insert_mask[0][n]    = n == 3 ? 0xFFFFFFFF : 0;
+    vc.insert_mask[1][n]    = n >= 2 ? 0xFFFFFFFF : 0;
+  }
+
+  // Controls below are in register layout: byte b of word n is host byte
+  // n * 4 + b, with b = 0 the least significant.
+  static const uint8_t pack_d3dcolor[16] = {
+    // A = w, R = x, G = y, B = z
+    0x80, 0x80, 0x80, 0x80,  0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80,     8,    4,    0,   12,
+  };
+  static const uint8_t pack_short2[16] = {
+    // x << 16 | y
+    0x80, 0x80, 0x80, 0x80,  0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80,     4,    5,    0,    1,
+  };
+  static const uint8_t pack_short4[16] = {
+    // x << 16 | y, z << 16 | w
+    0x80, 0x80, 0x80, 0x80,  0x80, 0x80, 0x80, 0x80,
+       4,    5,    0,    1,    12,   13,    8,    9,
+  };
+  static const uint8_t unpack_d3dcolor[16] = {
+    // R, G, B, A from word 3
+      14, 0x80, 0x80, 0x80,    13, 0x80, 0x80, 0x80,
+      12, 0x80, 0x80, 0x80,    15, 0x80, 0x80, 0x80,
+  };
+  static const uint8_t unpack_short2[16] = {
+    // Halves of word 3 into the top of words 0-1 for sign extension.
+    0x80, 0x80,   14,   15,  0x80, 0x80,   12,   13,
+    0x80, 0x80, 0x80, 0x80,  0x80, 0x80, 0x80, 0x80,
+  };
+  static const uint8_t unpack_short4[16] = {
+    0x80, 0x80,   10,   11,  0x80, 0x80,    8,    9,
+    0x80, 0x80,   14,   15,  0x80, 0x80,   12,   13,
+  };
+  xe_copy_struct(vc.pack_d3dcolor, pack_d3dcolor, 16);
+  xe_copy_struct(vc.pack_short2, pack_short2, 16);
+  xe_copy_struct(vc.pack_short4, pack_short4, 16);
+  xe_copy_struct(vc.unpack_d3dcolor, unpack_d3dcolor, 16);
+  xe_copy_struct(vc.unpack_short2, unpack_short2, 16);
+  xe_copy_struct(vc.unpack_short4, unpack_short4, 16);
+}
+
+bool HasSse41() {
+  return FLAGS_vmx_sse41 &&
+      (CpuInfo::getGlobal()->getFeatures() & kX86FeatureSse41) != 0;
+}
+
+}  // namespace
+
+
+namespace xe {
+namespace cpu {
+namespace x64 {
+
+
+const void* X64GetVectorConstants() {
+  return &vector_constants_;
+}
+
+uint32_t X64GetVectorConfig() {
+  return (HasSse41() ? 1 : 0) | (FLAGS_vmx_non_java_mode ? 2 : 0);
+}
+
+
+// Common helpers.
+
+GpVar XeEmitVectorEA(X64Emitter& e, X86Compiler& c, uint32_t ra, uint32_t rb) {
+  // if RA = 0 then
+  //   b <- 0
+  // else
+  //   b <- (RA)
+  // EA <- b + (RB)
+  GpVar ea(c.newGpVar());
+  c.mov(ea, e.gpr_value(rb));
+  if (ra) {
+    c.add(ea, e.gpr_value(ra));
+  }
+  return ea;
+}
+
+// Returns a pointer to the row of a table indexed by EA & 0xF.
+GpVar XeEmitVectorTableRow(X64Emitter& e, X86Compiler& c, GpVar& ea) {
+  GpVar row(c.newGpVar());
+  c.mov(row, ea);
+  c.and_(row, imm(0xF));
+  c.shl(row, imm(4));
+  c.add(row, e.vector_constants());
+  return row;
+}
+
+// Returns the host address of the quadword containing EA.
+GpVar XeEmitVectorAlignedAddress(X64Emitter& e, X86Compiler& c,
+                                 uint32_t cia, GpVar& ea) {
+  GpVar aligned_ea(c.newGpVar());
+  c.mov(aligned_ea, ea);
+  c.and_(aligned_ea, imm(~0xF));
+  return e.TouchMemoryAddress(cia, aligned_ea);
+}
+
+int XeEmitLoadVector(X64Emitter& e, X86Compiler& c, InstrData& i,
+                     uint32_t vd, uint32_t ra, uint32_t rb) {
+  // EA <- b + (RB)
+  // VD <- MEM(EA & ~0xF, 16)
+  GpVar ea = XeEmitVectorEA(e, c, ra, rb);
+  GpVar addr = XeEmitVectorAlignedAddress(e, c, i.address, ea);
+  XmmVar v(c.newXmmVar());
+  c.movdqa(v, dqword_ptr(addr));
+  c.pshufb(v, dqword_ptr(e.vector_constants(),
+                         offsetof(VectorConstants, byte_swap)));
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitStoreVector(X64Emitter& e, X86Compiler& c, InstrData& i,
+                      uint32_t vs, uint32_t ra, uint32_t rb) {
+  // EA <- b + (RB)
+  // MEM(EA & ~0xF, 16) <- (VS)
+  GpVar ea = XeEmitVectorEA(e, c, ra, rb);
+  GpVar addr = XeEmitVectorAlignedAddress(e, c, i.address, ea);
+  XmmVar v = e.vr_value(vs);
+  c.pshufb(v, dqword_ptr(e.vector_constants(),
+                         offsetof(VectorConstants, byte_swap)));
+  c.movdqa(dqword_ptr(addr), v);
+  return 0;
+}
+
+int XeEmitStoreVectorElement(X64Emitter& e, X86Compiler& c, InstrData& i,
+                             uint32_t vs, uint32_t ra, uint32_t rb,
+                             uint32_t size) {
+  // EA <- (b + (RB)) & ~(size - 1)
+  // MEM(EA, size) <- (VS)[EA & 0xF]
+  GpVar ea = XeEmitVectorEA(e, c, ra, rb);
+
+  // The element index depends on the address, so the element is read straight
+  // out of the context instead of being extracted from a register.
+  GpVar offset(c.newGpVar());
+  c.mov(offset, ea);
+  c.and_(offset, imm(0xF & ~(size - 1)));
+  if (size < 4) {
+    c.xor_(offset, imm(4 - size));
+  }
+  GpVar state = c.getGpArg(0);
+  size_t base = offsetof(xe_ppc_state_t, v) + 16 * vs;
+  GpVar value(c.newGpVar());
+  switch (size) {
+    case 1:
+      c.movzx(value, byte_ptr(state, offset, kScale1Times, base));
+      break;
+    case 2:
+      c.movzx(value, word_ptr(state, offset, kScale1Times, base));
+      break;
+    case 4:
+      c.mov(value.r32(), dword_ptr(state, offset, kScale1Times, base));
+      break;
+  }
+
+  if (size > 1) {
+    c.and_(ea, imm(~(size - 1)));
+  }
+  e.WriteMemory(i.address, ea, size, value);
+  return 0;
+}
+
+int XeEmitLoadVectorShift(X64Emitter& e, X86Compiler& c, InstrData& i,
+                          uint32_t vd, uint32_t ra, uint32_t rb, bool left) {
+  // sh <- (b + (RB)) & 0xF
+  // lvsl: VD <- sh || sh + 1 || ... || sh + 15
+  // lvsr: VD <- 16 - sh || 17 - sh || ... || 31 - sh
+  GpVar ea = XeEmitVectorEA(e, c, ra, rb);
+  GpVar row = XeEmitVectorTableRow(e, c, ea);
+  XmmVar v(c.newXmmVar());
+  c.movdqa(v, dqword_ptr(row, left ? offsetof(VectorConstants, lvsl) :
+                                     offsetof(VectorConstants, lvsr)));
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitLoadVectorPartial(X64Emitter& e, X86Compiler& c, InstrData& i,
+                            uint32_t vd, uint32_t ra, uint32_t rb, bool left) {
+  // sh <- EA & 0xF
+  // lvlx: VD <- MEM(EA, 16 - sh) || zeros
+  // lvrx: VD <- zeros || MEM(EA & ~0xF, sh)
+  // Both halves come from the quadword containing EA, so a single aligned
+  // load and a shuffle handles every alignment.
+  GpVar ea = XeEmitVectorEA(e, c, ra, rb);
+  GpVar addr = XeEmitVectorAlignedAddress(e, c, i.address, ea);
+  GpVar row = XeEmitVectorTableRow(e, c, ea);
+  XmmVar v(c.newXmmVar());
+  c.movdqa(v, dqword_ptr(addr));
+  c.pshufb(v, dqword_ptr(row, left ? offsetof(VectorConstants, lvl) :
+                                     offsetof(VectorConstants, lvr)));
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitStoreVectorPartial(X64Emitter& e, X86Compiler& c, InstrData& i,
+                             uint32_t vs, uint32_t ra, uint32_t rb, bool left) {
+  // sh <- EA & 0xF
+  // stvlx: MEM(EA, 16 - sh) <- (VS)[0:15 - sh]
+  // stvrx: MEM(EA & ~0xF, sh) <- (VS)[16 - sh:15]
+  // Merged into the containing quadword with a masked read-modify-write.
+  // TODO: this isn't atomic with respect to other threads writing
+  //     the untouched bytes.
+  GpVar ea = XeEmitVectorEA(e, c, ra, rb);
+  GpVar addr = XeEmitVectorAlignedAddress(e, c, i.address, ea);
+  GpVar row = XeEmitVectorTableRow(e, c, ea);
+  XmmVar v = e.vr_value(vs);
+  c.pshufb(v, dqword_ptr(row, left ? offsetof(VectorConstants, stvl) :
+                                     offsetof(VectorConstants, stvr)));
+  XmmVar mask(c.newXmmVar());
+  c.movdqa(mask, dqword_ptr(row, left ? offsetof(VectorConstants, stvl_mask) :
+                                        offsetof(VectorConstants, stvr_mask)));
+  c.pandn(mask, dqword_ptr(addr));
+  c.por(mask, v);
+  c.movdqa(dqword_ptr(addr), mask);
+  return 0;
+}
+
+// Shuffles VA (and VB if ctl_b is non-zero) with the given table controls.
+int XeEmitVectorShuffle(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                        uint32_t va, size_t ctl_a,
+                        uint32_t vb, size_t ctl_b) {
+  GpVar consts = e.vector_constants();
+  XmmVar v = e.vr_value(va);
+  c.pshufb(v, dqword_ptr(consts, ctl_a));
+  if (ctl_b) {
+    XmmVar vb_value = e.vr_value(vb);
+    c.pshufb(vb_value, dqword_ptr(consts, ctl_b));
+    c.por(v, vb_value);
+  }
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitVectorPermute(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                        uint32_t va, uint32_t vb, uint32_t vc) {
+  // For each byte i:
+  //   sel <- (VC)[i] & 0x1F
+  //   VD[i] <- ((VA) || (VB))[sel]
+  // The byte swizzle is an xor of the low two index bits. pshufb then selects
+  // from VA for indices 0-15 (biased to 0x70-0x7F) and from VB for 16-31
+  // (biased to 0x00-0x0F), zeroing the other side via the high bit.
+  GpVar consts = e.vector_constants();
+  XmmVar ctl_a = e.vr_value(vc);
+  c.pand(ctl_a, dqword_ptr(consts, offsetof(VectorConstants, perm_index_mask)));
+  c.pxor(ctl_a, dqword_ptr(consts, offsetof(VectorConstants, perm_index_swap)));
+  XmmVar ctl_b(c.newXmmVar());
+  c.movdqa(ctl_b, ctl_a);
+  c.paddb(ctl_a, dqword_ptr(consts, offsetof(VectorConstants, perm_a_bias)));
+  c.paddb(ctl_b, dqword_ptr(consts, offsetof(VectorConstants, perm_b_bias)));
+
+  XmmVar v = e.vr_value(va);
+  c.pshufb(v, ctl_a);
+  XmmVar vb_value = e.vr_value(vb);
+  c.pshufb(vb_value, ctl_b);
+  c.por(v, vb_value);
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitVectorSplatImmediate(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                               uint32_t value) {
+  XmmVar v(c.newXmmVar());
+  if (!value) {
+    c.pxor(v, v);
+  } else {
+    GpVar word(c.newGpVar());
+    c.mov(word, imm(value));
+    c.movd(v, word.r32());
+    c.pshufd(v, v, imm(0));
+  }
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitVectorShuffleWords(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                             uint32_t vb, uint32_t order) {
+  // order is a pshufd immediate (2 bits per destination word, word 0 low).
+  XmmVar v = e.vr_value(vb);
+  c.pshufd(v, v, imm(order));
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+int XeEmitVectorMergeWords(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                           uint32_t va, uint32_t vb, bool high) {
+  // high: VD <- VA[0] || VB[0] || VA[1] || VB[1]
+  // low:  VD <- VA[2] || VB[2] || VA[3] || VB[3]
+  XmmVar v = e.vr_value(va);
+  if (high) {
+    c.punpckldq(v, e.vr_value(vb));
+  } else {
+    c.punpckhdq(v, e.vr_value(vb));
+  }
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+uint32_t XeVectorSignExtend5(uint32_t v) {
+  return v & 0x10 ? v | 0xFFFFFFF0 : v;
+}
+
+// Flushes denormal results to zero (keeping the sign) when emulating the
+// non-Java mode the 360 runs in. The host has no equivalent that doesn't
+// also change scalar FPU behavior, so results are fixed up explicitly.
+void XeEmitVectorFlushDenormals(X64Emitter& e, X86Compiler& c, XmmVar& v) {
+  if (!FLAGS_vmx_non_java_mode) {
+    return;
+  }
+  GpVar consts = e.vector_constants();
+  XmmVar keep(c.newXmmVar());
+  c.movaps(keep, v);
+  c.andps(keep, dqword_ptr(consts, offsetof(VectorConstants, abs_mask)));
+  // |v| >= FLT_MIN, or NaN.
+  c.cmpps(keep, dqword_ptr(consts, offsetof(VectorConstants, min_normal)),
+          imm(5));
+  XmmVar sign(c.newXmmVar());
+  c.movaps(sign, v);
+  c.andps(sign, dqword_ptr(consts, offsetof(VectorConstants, sign_mask)));
+  c.andps(v, keep);
+  c.orps(v, sign);
+}
+
+void XeEmitUpdateVectorFloat(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                             XmmVar& v) {
+  XeEmitVectorFlushDenormals(e, c, v);
+  e.update_vr_value(vd, v);
+}
+
+enum VectorFloatOp {
+  kVectorFloatAdd,
+  kVectorFloatSub,
+  kVectorFloatMul,
+  kVectorFloatMax,
+  kVectorFloatMin,
+};
+
+void XeEmitVectorFloatOp(X86Compiler& c, VectorFloatOp op,
+                         XmmVar& v, const XmmVar& other) {
+  switch (op) {
+    case kVectorFloatAdd: c.addps(v, other); break;
+    case kVectorFloatSub: c.subps(v, other); break;
+    case kVectorFloatMul: c.mulps(v, other); break;
+    case kVectorFloatMax: c.maxps(v, other); break;
+    case kVectorFloatMin: c.minps(v, other); break;
+  }
+}
+
+int XeEmitVectorFloat2(X64Emitter& e, X86Compiler& c, VectorFloatOp op,
+                       uint32_t vd, uint32_t va, uint32_t vb) {
+  // VD <- (VA) op (VB)
+  XmmVar v = e.vr_value(va);
+  XeEmitVectorFloatOp(c, op, v, e.vr_value(vb));
+  XeEmitUpdateVectorFloat(e, c, vd, v);
+  return 0;
+}
+
+int XeEmitVectorMultiplyAdd(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                            uint32_t va, uint32_t vc, uint32_t vb,
+                            bool negate) {
+  // VD <- (VA) * (VC) + (VB)
+  // negate: VD <- (VB) - (VA) * (VC)
+  // The multiply is rounded separately; the host has no fused form here.
+  XmmVar v = e.vr_value(va);
+  c.mulps(v, e.vr_value(vc));
+  if (negate) {
+    XmmVar t = e.vr_value(vb);
+    c.subps(t, v);
+    XeEmitUpdateVectorFloat(e, c, vd, t);
+  } else {
+    c.addps(v, e.vr_value(vb));
+    XeEmitUpdateVectorFloat(e, c, vd, v);
+  }
+  return 0;
+}
+
+int XeEmitVectorDotProduct(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                           uint32_t va, uint32_t vb, bool dot3) {
+  // VD[n] <- (VA[0] * VB[0]) + ... + (VA[2|3] * VB[2|3])
+  XmmVar v = e.vr_value(va);
+  if (HasSse41()) {
+    c.dpps(v, e.vr_value(vb), imm(dot3 ? 0x7F : 0xFF));
+  } else {
+    c.mulps(v, e.vr_value(vb));
+    if (dot3) {
+      c.andps(v, dqword_ptr(e.vector_constants(),
+                            offsetof(VectorConstants, dot3_mask)));
+    }
+    XmmVar t(c.newXmmVar());
+    c.pshufd(t, v, imm(0xB1));
+    c.addps(v, t);
+    c.pshufd(t, v, imm(0x4E));
+    c.addps(v, t);
+  }
+  XeEmitUpdateVectorFloat(e, c, vd, v);
+  return 0;
+}
+
+int XeEmitVectorReciprocal(X64Emitter& e, X86Compiler& c, uint32_t vd,
+                           uint32_t vb, bool sqrt) {
+  // vrefp: VD <- 1 / (VB)
+  // vrsqrtefp: VD <- 1 / sqrt(VB)
+  // rcpps/rsqrtps are much less precise than the 360 estimates, so the full
+  // divide is used.
+  XmmVar divisor = e.vr_value(vb);
+  if (sqrt) {
+    c.sqrtps(divisor, divisor);
+  }
+  XmmVar v(c.newXmmVar());
+  c.movaps(v, dqword_ptr(e.vector_constants(), offsetof(VectorConstants, one)));
+  c.divps(v, divisor);
+  XeEmitUpdateVectorFloat(e, c, vd, v);
+  return 0;
+}
+
+enum VectorCompareOp {
+  kVectorCompareEQ,
+  kVectorCompareGE,
+  kVectorCompareGT,
+  kVectorCompareBounds,
+};
+
+int XeEmitVectorCompare(X64Emitter& e, X86Compiler& c, VectorCompareOp op,
+                        uint32_t vd, uint32_t va, uint32_t vb, uint32_t rc) {
+  // VD[n] <- (VA[n] op VB[n]) ? 0xFFFFFFFF : 0
+  // If Rc, CR6 <- all true || 0 || all false || 0
+  // vcmpbfp instead sets bit 0 if VA[n] > VB[n] and bit 1 if
+  // VA[n] < -VB[n] and only ever sets the all-in-bounds CR6 bit.
+  XmmVar v;
+  XmmVar any;
+  switch (op) {
+    case kVectorCompareEQ:
+      v = e.vr_value(va);
+      c.cmpps(v, e.vr_value(vb), imm(0));
+      break;
+    case kVectorCompareGE:
+      // a >= b == b <= a
+      v = e.vr_value(vb);
+      c.cmpps(v, e.vr_value(va), imm(2));
+      break;
+    case kVectorCompareGT:
+      // a > b == b < a
+      v = e.vr_value(vb);
+      c.cmpps(v, e.vr_value(va), imm(1));
+      break;
+    case kVectorCompareBounds: {
+      GpVar consts = e.vector_constants();
+      XmmVar a = e.vr_value(va);
+      XmmVar b = e.vr_value(vb);
+      // !(a <= b)
+      v = XmmVar(c.newXmmVar());
+      c.movaps(v, a);
+      c.cmpps(v, b, imm(6));
+      // !(a >= -b) == !(-b <= a)
+      XmmVar lower(c.newXmmVar());
+      c.movaps(lower, b);
+      c.xorps(lower, dqword_ptr(consts, offsetof(VectorConstants, sign_mask)));
+      c.cmpps(lower, a, imm(6));
+      if (rc) {
+        any = XmmVar(c.newXmmVar());
+        c.movaps(any, v);
+        c.orps(any, lower);
+      }
+      c.andps(v, dqword_ptr(consts, offsetof(VectorConstants, sign_mask)));
+      c.andps(lower, dqword_ptr(consts, offsetof(VectorConstants, sign_mask)));
+      c.psrld(lower, imm(1));
+      c.orps(v, lower);
+      break;
+    }
+  }
+  e.update_vr_value(vd, v);
+
+  if (rc) {
+    GpVar mask(c.newGpVar());
+    GpVar cr(c.newGpVar());
+    c.xor_(cr, cr);
+    if (op == kVectorCompareBounds) {
+      c.movmskps(mask, any);
+      c.test(mask, mask);
+      c.sete(cr.r8());
+      c.shl(cr, imm(2));
+    } else {
+      c.movmskps(mask, v);
+      GpVar none(c.newGpVar());
+      c.xor_(none, none);
+      c.cmp(mask, imm(0xF));
+      c.sete(cr.r8());
+      c.test(mask, mask);
+      c.sete(none.r8());
+      c.shl(none, imm(2));
+      c.or_(cr, none);
+    }
+    e.update_cr_value(6, cr);
+  }
+  return 0;
+}
+
+
+// Vector load/store (VMX)
+
+XEEMITTER(lvebx,        0x7C00000E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // The other elements are undefined, so load the whole quadword.
+  return XeEmitLoadVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(lvehx,        0x7C00004E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(lvewx,        0x7C00008E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(lvewx128,     0x10000083, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, XEVX128D(i.VX128_1),
+                          i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEEMITTER(lvsl,         0x7C00000C, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorShift(e, c, i, i.X.RT, i.X.RA, i.X.RB, true);
+}
+
+XEEMITTER(lvsl128,      0x10000003, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorShift(e, c, i, XEVX128D(i.VX128_1),
+                               i.VX128_1.RA, i.VX128_1.RB, true);
+}
+
+XEEMITTER(lvsr,         0x7C00004C, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorShift(e, c, i, i.X.RT, i.X.RA, i.X.RB, false);
+}
+
+XEEMITTER(lvsr128,      0x10000043, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorShift(e, c, i, XEVX128D(i.VX128_1),
+                               i.VX128_1.RA, i.VX128_1.RB, false);
+}
+
+XEEMITTER(lvx,          0x7C0000CE, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(lvx128,       0x100000C3, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, XEVX128D(i.VX128_1),
+                          i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEEMITTER(lvxl,         0x7C0002CE, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(lvxl128,      0x100002C3, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVector(e, c, i, XEVX128D(i.VX128_1),
+                          i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEEMITTER(stvebx,       0x7C00010E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorElement(e, c, i, i.X.RT, i.X.RA, i.X.RB, 1);
+}
+
+XEEMITTER(stvehx,       0x7C00014E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorElement(e, c, i, i.X.RT, i.X.RA, i.X.RB, 2);
+}
+
+XEEMITTER(stvewx,       0x7C00018E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorElement(e, c, i, i.X.RT, i.X.RA, i.X.RB, 4);
+}
+
+XEEMITTER(stvewx128,    0x10000183, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorElement(e, c, i, XEVX128D(i.VX128_1),
+                                  i.VX128_1.RA, i.VX128_1.RB, 4);
+}
+
+XEEMITTER(stvx,         0x7C0001CE, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(stvx128,      0x100001C3, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVector(e, c, i, XEVX128D(i.VX128_1),
+                           i.VX128_1.RA, i.VX128_1.RB);
+}
+
+XEEMITTER(stvxl,        0x7C0003CE, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVector(e, c, i, i.X.RT, i.X.RA, i.X.RB);
+}
+
+XEEMITTER(stvxl128,     0x100003C3, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVector(e, c, i, XEVX128D(i.VX128_1),
+                           i.VX128_1.RA, i.VX128_1.RB);
+}
+
+
+// Vector load/store unaligned (Xbox 360 extension)
+
+XEEMITTER(lvlx,         0x7C00040E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorPartial(e, c, i, i.X.RT, i.X.RA, i.X.RB, true);
+}
+
+XEEMITTER(lvlx128,      0x10000403, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                 i.VX128_1.RA, i.VX128_1.RB, true);
+}
+
+XEEMITTER(lvlxl128,     0x10000603, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                 i.VX128_1.RA, i.VX128_1.RB, true);
+}
+
+XEEMITTER(lvrx,         0x7C00044E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorPartial(e, c, i, i.X.RT, i.X.RA, i.X.RB, false);
+}
+
+XEEMITTER(lvrx128,      0x10000443, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                 i.VX128_1.RA, i.VX128_1.RB, false);
+}
+
+XEEMITTER(lvrxl128,     0x10000643, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                 i.VX128_1.RA, i.VX128_1.RB, false);
+}
+
+XEEMITTER(stvlx,        0x7C00050E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorPartial(e, c, i, i.X.RT, i.X.RA, i.X.RB, true);
+}
+
+XEEMITTER(stvlx128,     0x10000503, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                  i.VX128_1.RA, i.VX128_1.RB, true);
+}
+
+XEEMITTER(stvlxl128,    0x10000703, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                  i.VX128_1.RA, i.VX128_1.RB, true);
+}
+
+XEEMITTER(stvrx,        0x7C00054E, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorPartial(e, c, i, i.X.RT, i.X.RA, i.X.RB, false);
+}
+
+XEEMITTER(stvrx128,     0x10000543, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                  i.VX128_1.RA, i.VX128_1.RB, false);
+}
+
+XEEMITTER(stvrxl128,    0x10000743, VX128_1)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreVectorPartial(e, c, i, XEVX128D(i.VX128_1),
+                                  i.VX128_1.RA, i.VX128_1.RB, false);
+}
+
+
+// Vector merge/permute/splat
+
+XEEMITTER(vmrghb,       0x1000000C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorShuffle(
+      e, c, i.VX.VD,
+      i.VX.VA, offsetof(VectorConstants, merge_a[kMergeHighByte]),
+      i.VX.VB, offsetof(VectorConstants, merge_b[kMergeHighByte]));
+}
+
+XEEMITTER(vmrghh,       0x1000004C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorShuffle(
+      e, c, i.VX.VD,
+      i.VX.VA, offsetof(VectorConstants, merge_a[kMergeHighHalf]),
+      i.VX.VB, offsetof(VectorConstants, merge_b[kMergeHighHalf]));
+}
+
+XEEMITTER(vmrghw,       0x1000008C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorMergeWords(e, c, i.VX.VD, i.VX.VA, i.VX.VB, true);
+}
+
+XEEMITTER(vmrghw128,    0x18000300, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorMergeWords(e, c, XEVX128D(i.VX128), XEVX128A(i.VX128),
+                                XEVX128B(i.VX128), true);
+}
+
+XEEMITTER(vmrglb,       0x1000010C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorShuffle(
+      e, c, i.VX.VD,
+      i.VX.VA, offsetof(VectorConstants, merge_a[kMergeLowByte]),
+      i.VX.VB, offsetof(VectorConstants, merge_b[kMergeLowByte]));
+}
+
+XEEMITTER(vmrglh,       0x1000014C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorShuffle(
+      e, c, i.VX.VD,
+      i.VX.VA, offsetof(VectorConstants, merge_a[kMergeLowHalf]),
+      i.VX.VB, offsetof(VectorConstants, merge_b[kMergeLowHalf]));
+}
+
+XEEMITTER(vmrglw,       0x1000018C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorMergeWords(e, c, i.VX.VD, i.VX.VA, i.VX.VB, false);
+}
+
+XEEMITTER(vmrglw128,    0x18000340, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorMergeWords(e, c, XEVX128D(i.VX128), XEVX128A(i.VX128),
+                                XEVX128B(i.VX128), false);
+}
+
+XEEMITTER(vperm,        0x1000002B, VA )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorPermute(e, c, i.VA.VD, i.VA.VA, i.VA.VB, i.VA.VC);
+}
+
+XEEMITTER(vperm128,     0x14000000, VX128_2)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorPermute(e, c, XEVX128D(i.VX128_2), XEVX128A(i.VX128_2),
+                             XEVX128B(i.VX128_2), i.VX128_2.VC);
+}
+
+XEEMITTER(vpermwi128,   0x18000210, VX128_P)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD[n] <- (VB)[(PERM >> (6 - 2n)) & 3]
+  // pshufd reads its selectors in the opposite order.
+  uint32_t perm = i.VX128_P.PERMl | (i.VX128_P.PERMh << 5);
+  uint32_t order = 0;
+  for (uint32_t n = 0; n < 4; n++) {
+    order |= ((perm >> (6 - 2 * n)) & 3) << (2 * n);
+  }
+  return XeEmitVectorShuffleWords(e, c, XEVX128D(i.VX128_P),
+                                  XEVX128B(i.VX128_P), order);
+}
+
+XEEMITTER(vsldoi,       0x1000002C, VA )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD <- ((VA) || (VB))[SH:SH + 15]
+  uint32_t sh = i.VA.VC & 0xF;
+  return XeEmitVectorShuffle(
+      e, c, i.VA.VD,
+      i.VA.VA, offsetof(VectorConstants, sldoi_a) + sh * 16,
+      i.VA.VB, offsetof(VectorConstants, sldoi_b) + sh * 16);
+}
+
+XEEMITTER(vsldoi128,    0x10000010, VX128_5)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t sh = i.VX128_5.SH;
+  return XeEmitVectorShuffle(
+      e, c, XEVX128D(i.VX128_5),
+      XEVX128A(i.VX128_5), offsetof(VectorConstants, sldoi_a) + sh * 16,
+      XEVX128B(i.VX128_5), offsetof(VectorConstants, sldoi_b) + sh * 16);
+}
+
+XEEMITTER(vspltb,       0x1000020C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD[n] <- (VB)[UIMM]
+  uint32_t uimm = i.VX.VA & 0xF;
+  return XeEmitVectorShuffle(
+      e, c, i.VX.VD,
+      i.VX.VB, offsetof(VectorConstants, splat_b) + uimm * 16,
+      0, 0);
+}
+
+XEEMITTER(vsplth,       0x1000024C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t uimm = i.VX.VA & 0x7;
+  return XeEmitVectorShuffle(
+      e, c, i.VX.VD,
+      i.VX.VB, offsetof(VectorConstants, splat_h) + uimm * 16,
+      0, 0);
+}
+
+XEEMITTER(vspltw,       0x1000028C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t uimm = i.VX.VA & 0x3;
+  return XeEmitVectorShuffleWords(e, c, i.VX.VD, i.VX.VB, uimm * 0x55);
+}
+
+XEEMITTER(vspltw128,    0x18000730, VX128_3)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t uimm = i.VX128_3.IMM & 0x3;
+  return XeEmitVectorShuffleWords(e, c, XEVX128D(i.VX128_3),
+                                  XEVX128B(i.VX128_3), uimm * 0x55);
+}
+
+XEEMITTER(vspltisb,     0x1000030C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD[n] <- EXTS(SIMM)
+  uint32_t value = XeVectorSignExtend5(i.VX.VA) & 0xFF;
+  return XeEmitVectorSplatImmediate(e, c, i.VX.VD, value * 0x01010101);
+}
+
+XEEMITTER(vspltish,     0x1000034C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t value = XeVectorSignExtend5(i.VX.VA) & 0xFFFF;
+  return XeEmitVectorSplatImmediate(e, c, i.VX.VD, value * 0x00010001);
+}
+
+XEEMITTER(vspltisw,     0x1000038C, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t value = XeVectorSignExtend5(i.VX.VA);
+  return XeEmitVectorSplatImmediate(e, c, i.VX.VD, value);
+}
+
+XEEMITTER(vspltisw128,  0x18000770, VX128_3)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  uint32_t value = XeVectorSignExtend5(i.VX128_3.IMM);
+  return XeEmitVectorSplatImmediate(e, c, XEVX128D(i.VX128_3), value);
+}
+
+
+// Vector floating-point
+
+XEEMITTER(vaddfp,       0x1000000A, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatAdd, i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEEMITTER(vaddfp128,    0x14000010, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatAdd, XEVX128D(i.VX128),
+                            XEVX128A(i.VX128), XEVX128B(i.VX128));
+}
+
+XEEMITTER(vcmpbfp,      0x100003C6, VXR)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareBounds,
+                             i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEEMITTER(vcmpbfp128,   0x18000180, VX128_R)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareBounds,
+                             XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                             XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEEMITTER(vcmpeqfp,     0x100000C6, VXR)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareEQ,
+                             i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEEMITTER(vcmpeqfp128,  0x18000000, VX128_R)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareEQ,
+                             XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                             XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEEMITTER(vcmpgefp,     0x100001C6, VXR)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareGE,
+                             i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEEMITTER(vcmpgefp128,  0x18000080, VX128_R)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareGE,
+                             XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                             XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEEMITTER(vcmpgtfp,     0x100002C6, VXR)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareGT,
+                             i.VXR.VD, i.VXR.VA, i.VXR.VB, i.VXR.Rc);
+}
+
+XEEMITTER(vcmpgtfp128,  0x18000100, VX128_R)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorCompare(e, c, kVectorCompareGT,
+                             XEVX128D(i.VX128_R), XEVX128A(i.VX128_R),
+                             XEVX128B(i.VX128_R), i.VX128_R.Rc);
+}
+
+XEEMITTER(vmaddcfp128,  0x14000110, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD <- (VA) * (VD) + (VB)
+  const uint32_t vd = XEVX128D(i.VX128);
+  return XeEmitVectorMultiplyAdd(e, c, vd, XEVX128A(i.VX128), vd,
+                                 XEVX128B(i.VX128), false);
+}
+
+XEEMITTER(vmaddfp,      0x1000002E, VA )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorMultiplyAdd(e, c, i.VA.VD, i.VA.VA, i.VA.VC, i.VA.VB,
+                                 false);
+}
+
+XEEMITTER(vmaddfp128,   0x140000D0, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD <- (VA) * (VB) + (VD)
+  const uint32_t vd = XEVX128D(i.VX128);
+  return XeEmitVectorMultiplyAdd(e, c, vd, XEVX128A(i.VX128),
+                                 XEVX128B(i.VX128), vd, false);
+}
+
+XEEMITTER(vmaxfp,       0x1000040A, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatMax, i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEEMITTER(vmaxfp128,    0x18000280, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatMax, XEVX128D(i.VX128),
+                            XEVX128A(i.VX128), XEVX128B(i.VX128));
+}
+
+XEEMITTER(vminfp,       0x1000044A, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatMin, i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEEMITTER(vminfp128,    0x180002C0, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatMin, XEVX128D(i.VX128),
+                            XEVX128A(i.VX128), XEVX128B(i.VX128));
+}
+
+XEEMITTER(vmsum3fp128,  0x14000190, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorDotProduct(e, c, XEVX128D(i.VX128), XEVX128A(i.VX128),
+                                XEVX128B(i.VX128), true);
+}
+
+XEEMITTER(vmsum4fp128,  0x140001D0, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorDotProduct(e, c, XEVX128D(i.VX128), XEVX128A(i.VX128),
+                                XEVX128B(i.VX128), false);
+}
+
+XEEMITTER(vmulfp128,    0x14000090, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatMul, XEVX128D(i.VX128),
+                            XEVX128A(i.VX128), XEVX128B(i.VX128));
+}
+
+XEEMITTER(vnmsubfp,     0x1000002F, VA )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorMultiplyAdd(e, c, i.VA.VD, i.VA.VA, i.VA.VC, i.VA.VB,
+                                 true);
+}
+
+XEEMITTER(vnmsubfp128,  0x14000150, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD <- (VD) - (VA) * (VB)
+  const uint32_t vd = XEVX128D(i.VX128);
+  return XeEmitVectorMultiplyAdd(e, c, vd, XEVX128A(i.VX128),
+                                 XEVX128B(i.VX128), vd, true);
+}
+
+XEEMITTER(vrefp,        0x1000010A, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorReciprocal(e, c, i.VX.VD, i.VX.VB, false);
+}
+
+XEEMITTER(vrefp128,     0x18000630, VX128_3)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorReciprocal(e, c, XEVX128D(i.VX128_3),
+                                XEVX128B(i.VX128_3), false);
+}
+
+XEEMITTER(vrsqrtefp,    0x1000014A, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorReciprocal(e, c, i.VX.VD, i.VX.VB, true);
+}
+
+XEEMITTER(vrsqrtefp128, 0x18000670, VX128_3)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorReciprocal(e, c, XEVX128D(i.VX128_3),
+                                XEVX128B(i.VX128_3), true);
+}
+
+XEEMITTER(vsubfp,       0x1000004A, VX )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatSub, i.VX.VD, i.VX.VA, i.VX.VB);
+}
+
+XEEMITTER(vsubfp128,    0x14000050, VX128)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitVectorFloat2(e, c, kVectorFloatSub, XEVX128D(i.VX128),
+                            XEVX128A(i.VX128), XEVX128B(i.VX128));
+}
+
+
+// Vector D3D pack/unpack (Xbox 360 extension)
+
+XEEMITTER(vpkd3d128,    0x18000610, VX128_4)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // packed <- pack_type(VB), saturated to the range of the type
+  // 32-bit pack: VD[3 - shift] <- packed[3]
+  // 64-bit pack: VD[2 - shift] || VD[3 - shift] <- packed[2] || packed[3]
+  const uint32_t vd = XEVX128D(i.VX128_4);
+  const uint32_t type = i.VX128_4.IMM >> 2;
+  const uint32_t pack = i.VX128_4.IMM & 0x3;
+  const uint32_t shift = i.VX128_4.z;
+
+  size_t min_offset;
+  size_t max_offset;
+  size_t ctl_offset;
+  switch (type) {
+    case 0: // VPACK_D3DCOLOR
+      min_offset = offsetof(VectorConstants, d3dcolor_min);
+      max_offset = offsetof(VectorConstants, d3dcolor_max);
+      ctl_offset = offsetof(VectorConstants, pack_d3dcolor);
+      break;
+    case 1: // VPACK_NORMSHORT2
+      min_offset = offsetof(VectorConstants, short_min);
+      max_offset = offsetof(VectorConstants, short_max);
+      ctl_offset = offsetof(VectorConstants, pack_short2);
+      break;
+    case 4: // VPACK_NORMSHORT4
+      min_offset = offsetof(VectorConstants, short_min);
+      max_offset = offsetof(VectorConstants, short_max);
+      ctl_offset = offsetof(VectorConstants, pack_short4);
+      break;
+    default:
+      // TODO: NORMPACKED32/64 and FLOAT16 types.
+      XEINSTRNOTIMPLEMENTED();
+      return 1;
+  }
+  if (!pack || (pack > 1 && shift == 3)) {
+    // TODO: 64-bit inserts that wrap around the register.
+    XEINSTRNOTIMPLEMENTED();
+    return 1;
+  }
+
+  GpVar consts = e.vector_constants();
+  XmmVar packed(c.newXmmVar());
+  c.movaps(packed, e.vr_value(XEVX128B(i.VX128_4)));
+  c.maxps(packed, dqword_ptr(consts, min_offset));
+  c.minps(packed, dqword_ptr(consts, max_offset));
+
+  c.pshufb(packed, dqword_ptr(consts, ctl_offset));
+
+  // Rotate so that element 3 lands in element 3 - shift.
+  uint32_t order = 0;
+  for (uint32_t n = 0; n < 4; n++) {
+    order |= ((n + shift) & 3) << (2 * n);
+  }
+  if (shift) {
+    c.pshufd(packed, packed, imm(order));
+  }
+
+  XmmVar v = e.vr_value(vd);
+  if (HasSse41()) {
+    uint32_t lanes = 1 << (3 - shift);
+    if (pack > 1) {
+      lanes |= 1 << (2 - shift);
+    }
+    c.blendps(v, packed, imm(lanes));
+  } else {
+    XmmVar mask(c.newXmmVar());
+    c.pshufd(mask, dqword_ptr(consts, offsetof(VectorConstants, insert_mask) +
+                                      (pack > 1 ? 16 : 0)), imm(order));
+    c.andps(packed, mask);
+    c.andnps(mask, v);
+    c.orps(packed, mask);
+    v = packed;
+  }
+  e.update_vr_value(vd, v);
+  return 0;
+}
+
+XEEMITTER(vupkd3d128,   0x180007F0, VX128_3)(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  // VD <- unpack_type(VB[3]) (VB[2] || VB[3] for 64-bit types)
+  const uint32_t type = i.VX128_3.IMM >> 2;
+  GpVar consts = e.vector_constants();
+  XmmVar v = e.vr_value(XEVX128B(i.VX128_3));
+  switch (type) {
+    case 0: // VPACK_D3DCOLOR
+      // Each channel becomes 1.0 + c * 2^-23.
+      c.pshufb(v, dqword_ptr(consts, offsetof(VectorConstants,
+                                               unpack_d3dcolor)));
+      c.por(v, dqword_ptr(consts, offsetof(VectorConstants,
+                                            unpack_d3dcolor_add)));
+      break;
+    case 1: // VPACK_NORMSHORT2
+      // x, y become 3.0 + s * 2^-22, z = 0, w = 1.0.
+      c.pshufb(v, dqword_ptr(consts, offsetof(VectorConstants,
+                                               unpack_short2)));
+      c.psrad(v, imm(16));
+      c.paddd(v, dqword_ptr(consts, offsetof(VectorConstants,
+                                              unpack_short2_add)));
+      break;
+    case 4: // VPACK_NORMSHORT4
+      c.pshufb(v, dqword_ptr(consts, offsetof(VectorConstants,
+                                               unpack_short4)));
+      c.psrad(v, imm(16));
+      c.paddd(v, dqword_ptr(consts, offsetof(VectorConstants,
+                                              unpack_short4_add)));
+      break;
+    default:
+      // TODO: NORMPACKED32/64 and FLOAT16 types.
+      XEINSTRNOTIMPLEMENTED();
+      return 1;
+  }
+  e.update_vr_value(XEVX128D(i.VX128_3), v);
+  return 0;
+}
+
+
+void X64RegisterEmitCategoryAltivec() {
+  InitializeVectorConstants();
+
+  XEREGISTERINSTR(lvebx,        0x7C00000E);
+  XEREGISTERINSTR(lvehx,        0x7C00004E);
+  XEREGISTERINSTR(lvewx,        0x7C00008E);
+  XEREGISTERINSTR(lvewx128,     0x10000083);
+  XEREGISTERINSTR(lvsl,         0x7C00000C);
+  XEREGISTERINSTR(lvsl128,      0x10000003);
+  XEREGISTERINSTR(lvsr,         0x7C00004C);
+  XEREGISTERINSTR(lvsr128,      0x10000043);
+  XEREGISTERINSTR(lvx,          0x7C0000CE);
+  XEREGISTERINSTR(lvx128,       0x100000C3);
+  XEREGISTERINSTR(lvxl,         0x7C0002CE);
+  XEREGISTERINSTR(lvxl128,      0x100002C3);
+  XEREGISTERINSTR(stvebx,       0x7C00010E);
+  XEREGISTERINSTR(stvehx,       0x7C00014E);
+  XEREGISTERINSTR(stvewx,       0x7C00018E);
+  XEREGISTERINSTR(stvewx128,    0x10000183);
+  XEREGISTERINSTR(stvx,         0x7C0001CE);
+  XEREGISTERINSTR(stvx128,      0x100001C3);
+  XEREGISTERINSTR(stvxl,        0x7C0003CE);
+  XEREGISTERINSTR(stvxl128,     0x100003C3);
+  XEREGISTERINSTR(lvlx,         0x7C00040E);
+  XEREGISTERINSTR(lvlx128,      0x10000403);
+  XEREGISTERINSTR(lvlxl128,     0x10000603);
+  XEREGISTERINSTR(lvrx,         0x7C00044E);
+  XEREGISTERINSTR(lvrx128,      0x10000443);
+  XEREGISTERINSTR(lvrxl128,     0x10000643);
+  XEREGISTERINSTR(stvlx,        0x7C00050E);
+  XEREGISTERINSTR(stvlx128,     0x10000503);
+  XEREGISTERINSTR(stvlxl128,    0x10000703);
+  XEREGISTERINSTR(stvrx,        0x7C00054E);
+  XEREGISTERINSTR(stvrx128,     0x10000543);
+  XEREGISTERINSTR(stvrxl128,    0x10000743);
+  XEREGISTERINSTR(vmrghb,       0x1000000C);
+  XEREGISTERINSTR(vmrghh,       0x1000004C);
+  XEREGISTERINSTR(vmrghw,       0x1000008C);
+  XEREGISTERINSTR(vmrghw128,    0x18000300);
+  XEREGISTERINSTR(vmrglb,       0x1000010C);
+  XEREGISTERINSTR(vmrglh,       0x1000014C);
+  XEREGISTERINSTR(vmrglw,       0x1000018C);
+  XEREGISTERINSTR(vmrglw128,    0x18000340);
+  XEREGISTERINSTR(vperm,        0x1000002B);
+  XEREGISTERINSTR(vperm128,     0x14000000);
+  XEREGISTERINSTR(vpermwi128,   0x18000210);
+  XEREGISTERINSTR(vsldoi,       0x1000002C);
+  XEREGISTERINSTR(vsldoi128,    0x10000010);
+  XEREGISTERINSTR(vspltb,       0x1000020C);
+  XEREGISTERINSTR(vsplth,       0x1000024C);
+  XEREGISTERINSTR(vspltw,       0x1000028C);
+  XEREGISTERINSTR(vspltw128,    0x18000730);
+  XEREGISTERINSTR(vspltisb,     0x1000030C);
+  XEREGISTERINSTR(vspltish,     0x1000034C);
+  XEREGISTERINSTR(vspltisw,     0x1000038C);
+  XEREGISTERINSTR(vspltisw128,  0x18000770);
+  XEREGISTERINSTR(vaddfp,       0x1000000A);
+  XEREGISTERINSTR(vaddfp128,    0x14000010);
+  XEREGISTERINSTR(vcmpbfp,      0x100003C6);
+  XEREGISTERINSTR(vcmpbfp128,   0x18000180);
+  XEREGISTERINSTR(vcmpeqfp,     0x100000C6);
+  XEREGISTERINSTR(vcmpeqfp128,  0x18000000);
+  XEREGISTERINSTR(vcmpgefp,     0x100001C6);
+  XEREGISTERINSTR(vcmpgefp128,  0x18000080);
+  XEREGISTERINSTR(vcmpgtfp,     0x100002C6);
+  XEREGISTERINSTR(vcmpgtfp128,  0x18000100);
+  XEREGISTERINSTR(vmaddcfp128,  0x14000110);
+  XEREGISTERINSTR(vmaddfp,      0x1000002E);
+  XEREGISTERINSTR(vmaddfp128,   0x140000D0);
+  XEREGISTERINSTR(vmaxfp,       0x1000040A);
+  XEREGISTERINSTR(vmaxfp128,    0x18000280);
+  XEREGISTERINSTR(vminfp,       0x1000044A);
+  XEREGISTERINSTR(vminfp128,    0x180002C0);
+  XEREGISTERINSTR(vmsum3fp128,  0x14000190);
+  XEREGISTERINSTR(vmsum4fp128,  0x140001D0);
+  XEREGISTERINSTR(vmulfp128,    0x14000090);
+  XEREGISTERINSTR(vnmsubfp,     0x1000002F);
+  XEREGISTERINSTR(vnmsubfp128,  0x14000150);
+  XEREGISTERINSTR(vrefp,        0x1000010A);
+  XEREGISTERINSTR(vrefp128,     0x18000630);
+  XEREGISTERINSTR(vrsqrtefp,    0x1000014A);
+  XEREGISTERINSTR(vrsqrtefp128, 0x18000670);
+  XEREGISTERINSTR(vsubfp,       0x1000004A);
+  XEREGISTERINSTR(vsubfp128,    0x14000050);
+  XEREGISTERINSTR(vpkd3d128,    0x18000610);
+  XEREGISTERINSTR(vupkd3d128,   0x180007F0);
+}
+
+
+}  // namespace x64
+}  // namespace cpu
+}  // namespace xe
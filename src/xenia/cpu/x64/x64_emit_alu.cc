@@ -25,6 +25,53 @@ namespace x64 {
 
 // Integer arithmetic (A-3)
 
+// Emits the XO-form add/subtract extended family:
+//   RT <- v + rhs + CA
+// where v is (RA) or ¬(RA) and rhs is (RB) or an immediate (0/-1). CA is
+// loaded into the host carry flag from the register it is held in so that
+// chains of these don't go through XER. Without carry_in CA is ignored.
+int XeEmitAddCarrying(X64Emitter& e, X86Compiler& c, InstrData& i,
+                      GpVar& v, GpVar* rb, int64_t addend, bool carry_in) {
+  if (carry_in) {
+    GpVar ca(e.ca_value());
+    c.bt(ca, imm(0));
+    if (rb) {
+      c.adc(v, *rb);
+    } else {
+      c.adc(v, imm(addend));
+    }
+  } else {
+    if (rb) {
+      c.add(v, *rb);
+    } else {
+      c.add(v, imm(addend));
+    }
+  }
+  GpVar cc(c.newGpVar());
+  c.setc(cc.r8());
+  GpVar oc;
+  if (i.XO.OE) {
+    oc = c.newGpVar();
+    c.seto(oc.r8());
+  }
+
+  e.update_gpr_value(i.XO.RT, v);
+  e.update_xer_with_carry(cc);
+  if (i.XO.OE) {
+    // With XER[OV/SO] update too.
+    e.update_xer_with_overflow(oc);
+  }
+
+  if (i.XO.Rc) {
+    // With cr0 update.
+    e.update_cr_with_cond(0, v);
+  }
+
+  e.clear_constant_gpr_value(i.XO.RT);
+
+  return 0;
+}
+
 XEEMITTER(addx,         0x7C000214, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
   // RD <- (RA) + (RB)
 
@@ -51,13 +98,22 @@ XEEMITTER(addx,         0x7C000214, XO )(X64Emitter& e, X86Compiler& c, InstrDat
 }
 
 XEEMITTER(addcx,        0x7C000014, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // RD <- (RA) + (RB)
+  // CA <- carry bit
+
+  GpVar v(c.newGpVar());
+  c.mov(v, e.gpr_value(i.XO.RA));
+  GpVar rb(e.gpr_value(i.XO.RB));
+  return XeEmitAddCarrying(e, c, i, v, &rb, 0, false);
 }
 
 XEEMITTER(addex,        0x7C000114, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // RD <- (RA) + (RB) + XER[CA]
+
+  GpVar v(c.newGpVar());
+  c.mov(v, e.gpr_value(i.XO.RA));
+  GpVar rb(e.gpr_value(i.XO.RB));
+  return XeEmitAddCarrying(e, c, i, v, &rb, 0, true);
 }
 
 XEEMITTER(addi,         0x38000000, D  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
@@ -157,44 +213,19 @@ XEEMITTER(addis,        0x3C000000, D  )(X64Emitter& e, X86Compiler& c, InstrDat
 }
 
 XEEMITTER(addmex,       0x7C0001D4, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // RT <- (RA) + CA - 1
+
+  GpVar v(c.newGpVar());
+  c.mov(v, e.gpr_value(i.XO.RA));
+  return XeEmitAddCarrying(e, c, i, v, NULL, -1, true);
 }
 
 XEEMITTER(addzex,       0x7C000194, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
   // RT <- (RA) + CA
 
-  // Add in carry flag from XER, only if needed.
-  // It may be possible to do this much more efficiently.
-  GpVar xer(c.newGpVar());
-  c.mov(xer, e.xer_value());
-  c.shr(xer, imm(29));
-  c.and_(xer, imm(1));
   GpVar v(c.newGpVar());
   c.mov(v, e.gpr_value(i.XO.RA));
-  c.add(v, xer);
-  GpVar cc(c.newGpVar());
-  c.setc(cc.r8());
-
-  e.update_gpr_value(i.XO.RT, v);
-  e.update_xer_with_carry(cc);
-
-  if (i.XO.OE) {
-    // With XER[SO] update too.
-    //e.update_xer_with_overflow_and_carry(b.CreateExtractValue(v, 1));
-  } else {
-    // Just CA update.
-    //e.update_xer_with_carry(b.CreateExtractValue(v, 1));
-  }
-
-  if (i.XO.Rc) {
-    // With cr0 update.
-    e.update_cr_with_cond(0, v);
-  }
-
-  e.clear_constant_gpr_value(i.XO.RT);
-
-  return 0;
+  return XeEmitAddCarrying(e, c, i, v, NULL, 0, true);
 }
 
 XEEMITTER(divdx,        0x7C0003D2, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
@@ -524,50 +555,26 @@ XEEMITTER(subfex,       0x7C000110, XO )(X64Emitter& e, X86Compiler& c, InstrDat
   GpVar v(c.newGpVar());
   c.mov(v, e.gpr_value(i.XO.RA));
   c.not_(v);
-
-  // Add in carry flag from XER, only if needed.
-  // It may be possible to do this much more efficiently.
-  GpVar xer(c.newGpVar());
-  c.mov(xer, e.xer_value());
-  c.shr(xer, imm(29));
-  c.and_(xer, imm(1));
-  Label post_stc_label = c.newLabel();
-  c.jz(post_stc_label, kCondHintLikely);
-  c.stc();
-  c.bind(post_stc_label);
-
-  c.adc(v, e.gpr_value(i.XO.RB));
-  GpVar cc(c.newGpVar());
-  c.setc(cc.r8());
-
-  e.update_gpr_value(i.XO.RT, v);
-
-  if (i.XO.OE) {
-    // With XER update.
-    XEASSERTALWAYS();
-    //e.update_xer_with_overflow_and_carry(b.CreateExtractValue(v, 1));
-  } else {
-    e.update_xer_with_carry(cc);
-  }
-
-  if (i.XO.Rc) {
-    // With cr0 update.
-    e.update_cr_with_cond(0, v);
-  }
-
-  e.clear_constant_gpr_value(i.XO.RT);
-
-  return 0;
+  GpVar rb(e.gpr_value(i.XO.RB));
+  return XeEmitAddCarrying(e, c, i, v, &rb, 0, true);
 }
 
 XEEMITTER(subfmex,      0x7C0001D0, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // RT <- ¬(RA) + CA - 1
+
+  GpVar v(c.newGpVar());
+  c.mov(v, e.gpr_value(i.XO.RA));
+  c.not_(v);
+  return XeEmitAddCarrying(e, c, i, v, NULL, -1, true);
 }
 
 XEEMITTER(subfzex,      0x7C000190, XO )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
+  // RT <- ¬(RA) + CA
+
+  GpVar v(c.newGpVar());
+  c.mov(v, e.gpr_value(i.XO.RA));
+  c.not_(v);
+  return XeEmitAddCarrying(e, c, i, v, NULL, 0, true);
 }
 
 
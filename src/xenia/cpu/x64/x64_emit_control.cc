@@ -54,11 +54,13 @@ int XeEmitIndirectBranchTo(
   if (!lk && reg == kXEPPCRegLR) {
     // The return block will spill registers for us.
     // TODO(benvanik): 'lr_mismatch' debug info.
-    // Note: we need to test on *only* the 32-bit target, as the target ptr may
+    // Note: we need to compare *only* the 32-bit target, as the target ptr may
     //     have garbage in the upper 32 bits.
-    c.test(target.r32(), c.getGpArg(1).r32());
+    // In functions that never change LR this is always taken unless we were
+    // entered with a mismatched LR, so the fallback below is cold there.
+    c.cmp(target.r32(), c.getGpArg(1).r32());
     // TODO(benvanik): evaluate hint here.
-    c.jnz(e.GetReturnLabel(), kCondHintLikely);
+    c.je(e.GetReturnLabel(), kCondHintLikely);
   }
 
   // Defer to the generator, which will do fancy things.
@@ -66,11 +68,44 @@ int XeEmitIndirectBranchTo(
   return e.GenerateIndirectionBranch(cia, target, lk, likely_local);
 }
 
+// Condition of a conditional branch. Either a host value that is nonzero when
+// the branch should be taken or, when only a CR bit is tested, the bit itself
+// so that the emitter can fuse the test with the compare that produced it.
+typedef struct {
+  GpVar*    value;
+  uint32_t  bi;
+  bool      is_set;
+} XeBranchCondition;
+
+void XeJumpOnCondition(
+    X64Emitter& e, X86Compiler& c, XeBranchCondition* condition, bool taken,
+    Label& label, uint32_t hint = kCondHintNone) {
+  if (condition->value) {
+    c.test(condition->value->r8(), condition->value->r8());
+    if (taken) {
+      c.jnz(label, hint);
+    } else {
+      c.jz(label, hint);
+    }
+  } else {
+    e.JumpOnCrBit(condition->bi,
+                  taken ? condition->is_set : !condition->is_set,
+                  label, hint);
+  }
+}
+
 int XeEmitBranchTo(
     X64Emitter& e, X86Compiler& c, const char* src, uint32_t cia,
-    bool lk, GpVar* condition = NULL) {
+    bool lk, XeBranchCondition* condition = NULL) {
   FunctionBlock* fn_block = e.fn_block();
 
+  // Any CR field/XER bits still pending must be written back before we
+  // leave. CR conditions take care of this themselves as they may consume it.
+  e.FlushPendingXer(true);
+  if (!condition || condition->value) {
+    e.FlushPendingCr(true);
+  }
+
   // Fast-path for branches to other blocks.
   // Only valid when not tracing branches.
   if (!FLAGS_trace_branches &&
@@ -80,8 +115,7 @@ int XeEmitBranchTo(
     if (condition) {
       // Fast test -- if condition passed then jump to target.
       // TODO(benvanik): need to spill here? somehow?
-      c.test((*condition).r8(), (*condition).r8());
-      c.jnz(target_label);
+      XeJumpOnCondition(e, c, condition, true, target_label);
     } else {
       // TODO(benvanik): need to spill here?
       //e.SpillRegisters();
@@ -95,9 +129,8 @@ int XeEmitBranchTo(
   if (condition) {
     // TODO(benvanik): add debug info for this?
     post_jump_label = c.newLabel();
-    c.test((*condition).r8(), (*condition).r8());
     // TODO(benvanik): experiment with various hints?
-    c.jz(post_jump_label, kCondHintNone);
+    XeJumpOnCondition(e, c, condition, false, post_jump_label, kCondHintNone);
   }
 
   e.TraceBranch(cia);
@@ -112,13 +145,20 @@ int XeEmitBranchTo(
       break;
     case FunctionBlock::kTargetFunction:
     {
-      // Spill all registers to memory.
-      // TODO(benvanik): only spill ones used by the target function? Use
-      //     calling convention flags on the function to not spill temp
-      //     registers?
-      e.SpillRegisters();
-
       XEASSERTNOTNULL(fn_block->outgoing_function);
+      if (e.IsInlinedFunction(fn_block->outgoing_function)) {
+        // The helper body runs in place. When called LR is already cia + 4
+        // so its blr just continues on; as a tail branch it returns to
+        // whatever LR it left (__restgprlr_* restores it).
+        e.InlineFunction(fn_block->outgoing_function);
+        if (!lk) {
+          result = XeEmitIndirectBranchTo(e, c, src, cia, false, kXEPPCRegLR);
+        }
+        break;
+      }
+
+      // CallFunction spills modified registers the target may access (all of
+      // them if there's no summary for it) to memory.
       // TODO(benvanik): check to see if this is the last block in the function.
       //     This would enable tail calls/etc.
       bool is_end = false;
@@ -135,7 +175,10 @@ int XeEmitBranchTo(
         GpVar lr(c.newGpVar());
         c.mov(lr, imm(cia + 4));
         e.CallFunction(fn_block->outgoing_function, lr, false);
-        e.FillRegisters();
+        FunctionSymbol* target = fn_block->outgoing_function;
+        e.FillRegisters(
+            (target->flags & FunctionSymbol::kFlagAccessSummary) ?
+            &target->access_summary : NULL);
       }
       break;
     }
@@ -235,9 +278,16 @@ XEEMITTER(bcx,          0x40000000, B  )(X64Emitter& e, X86Compiler& c, InstrDat
     }
   }
 
+  XeBranchCondition condition = { NULL, i.XL.BI,
+                                  XESELECTBITS(i.XL.BO, 3, 3) ? true : false };
+  bool cond_is_cr = false;
   GpVar cond_ok;
   if (XESELECTBITS(i.B.BO, 4, 4)) {
     // Ignore cond.
+  } else if (ctr_ok.getId() == kInvalidValue) {
+    // Only the CR bit is tested. Leave it to the emitter, which can branch
+    // directly on the compare that set it.
+    cond_is_cr = true;
   } else {
     GpVar cr(c.newGpVar());
     c.mov(cr, e.cr_value(i.XL.BI >> 2));
@@ -261,6 +311,9 @@ XEEMITTER(bcx,          0x40000000, B  )(X64Emitter& e, X86Compiler& c, InstrDat
   } else if (cond_ok.getId() != kInvalidValue) {
     ok = &cond_ok;
   }
+  if (ok) {
+    condition.value = ok;
+  }
 
   uint32_t nia;
   if (i.B.AA) {
@@ -268,7 +321,8 @@ XEEMITTER(bcx,          0x40000000, B  )(X64Emitter& e, X86Compiler& c, InstrDat
   } else {
     nia = i.address + XEEXTS26(i.B.BD << 2);
   }
-  if (XeEmitBranchTo(e, c, "bcx", i.address, i.B.LK, ok)) {
+  if (XeEmitBranchTo(e, c, "bcx", i.address, i.B.LK,
+                     (ok || cond_is_cr) ? &condition : NULL)) {
     return 1;
   }
 
@@ -292,29 +346,17 @@ XEEMITTER(bcctrx,       0x4C000420, XL )(X64Emitter& e, X86Compiler& c, InstrDat
     e.update_lr_value(imm(i.address + 4));
   }
 
-  GpVar cond_ok;
-  if (XESELECTBITS(i.XL.BO, 4, 4)) {
-    // Ignore cond.
-  } else {
-    GpVar cr(c.newGpVar());
-    c.mov(cr, e.cr_value(i.XL.BI >> 2));
-    c.and_(cr, imm(1 << (i.XL.BI & 3)));
-    c.cmp(cr, imm(0));
-    cond_ok = c.newGpVar();
-    if (XESELECTBITS(i.XL.BO, 3, 3)) {
-      c.setnz(cond_ok.r8());
-    } else {
-      c.setz(cond_ok.r8());
-    }
-  }
-
-  // We do a bit of optimization here to make the llvm assembly easier to read.
-  GpVar* ok = NULL;
-  if (cond_ok.getId() != kInvalidValue) {
-    ok = &cond_ok;
+  XeBranchCondition condition = { NULL, i.XL.BI,
+                                  XESELECTBITS(i.XL.BO, 3, 3) ? true : false };
+  bool cond_is_cr = false;
+  if (!XESELECTBITS(i.XL.BO, 4, 4)) {
+    // Only the CR bit is tested. Leave it to the emitter, which can branch
+    // directly on the compare that set it.
+    cond_is_cr = true;
   }
 
-  if (XeEmitBranchTo(e, c, "bcctrx", i.address, i.XL.LK, ok)) {
+  if (XeEmitBranchTo(e, c, "bcctrx", i.address, i.XL.LK,
+                     cond_is_cr ? &condition : NULL)) {
     return 1;
   }
 
@@ -361,9 +403,16 @@ XEEMITTER(bclrx,        0x4C000020, XL )(X64Emitter& e, X86Compiler& c, InstrDat
     }
   }
 
+  XeBranchCondition condition = { NULL, i.XL.BI,
+                                  XESELECTBITS(i.XL.BO, 3, 3) ? true : false };
+  bool cond_is_cr = false;
   GpVar cond_ok;
   if (XESELECTBITS(i.XL.BO, 4, 4)) {
     // Ignore cond.
+  } else if (ctr_ok.getId() == kInvalidValue) {
+    // Only the CR bit is tested. Leave it to the emitter, which can branch
+    // directly on the compare that set it.
+    cond_is_cr = true;
   } else {
     GpVar cr(c.newGpVar());
     c.mov(cr, e.cr_value(i.XL.BI >> 2));
@@ -387,8 +436,12 @@ XEEMITTER(bclrx,        0x4C000020, XL )(X64Emitter& e, X86Compiler& c, InstrDat
   } else if (cond_ok.getId() != kInvalidValue) {
     ok = &cond_ok;
   }
+  if (ok) {
+    condition.value = ok;
+  }
 
-  if (XeEmitBranchTo(e, c, "bclrx", i.address, i.XL.LK, ok)) {
+  if (XeEmitBranchTo(e, c, "bclrx", i.address, i.XL.LK,
+                     (ok || cond_is_cr) ? &condition : NULL)) {
     return 1;
   }
 
@@ -979,40 +979,53 @@ XEEMITTER(stswx,        0x7C00052A, X  )(X64Emitter& e, X86Compiler& c, InstrDat
 
 // Memory synchronization (A-18)
 
-XEEMITTER(eieio,        0x7C0006AC, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
-}
-
-XEEMITTER(isync,        0x4C00012C, XL )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
-}
-
-XEEMITTER(ldarx,        0x7C0000A8, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
-}
-
-XEEMITTER(lwarx,        0x7C000028, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+// lwarx/ldarx and stwcx./stdcx. share these.
+// The reservation is per thread (in xe_ppc_state_t) and remembers the value
+// that was loaded. A conditional store only happens if memory still holds that
+// value, which is checked and stored in one lock cmpxchg so that other host
+// threads running guest code can't slip a store in between. Unlike the real
+// reservation this can't see a location being changed and changed back.
+
+int XeEmitLoadReserve(X64Emitter& e, X86Compiler& c, InstrData& i,
+                      uint32_t size) {
   // if RA = 0 then
   //   b <- 0
   // else
   //   b <- (RA)
   // EA <- b + (RB)
   // RESERVE <- 1
-  // RESERVE_LENGTH <- 4
+  // RESERVE_LENGTH <- size
   // RESERVE_ADDR <- real_addr(EA)
-  // RT <- i32.0 || MEM(EA, 4)
-
-  // TODO(benvanik): make this right
+  // RT <- MEM(EA, size) (zero extended)
 
   GpVar ea(c.newGpVar());
   c.mov(ea, e.gpr_value(i.X.RB));
   if (i.X.RA) {
     c.add(ea, e.gpr_value(i.X.RA));
   }
-  GpVar v = e.ReadMemory(i.address, ea, 4, /* acquire */ true);
+  GpVar host_ea(e.TouchMemoryAddress(i.address, ea));
+
+  // Aligned loads are atomic, so this is the value the reservation holds.
+  GpVar raw(c.newGpVar());
+  if (size == 4) {
+    c.mov(raw.r32(), dword_ptr(host_ea));
+  } else {
+    c.mov(raw, qword_ptr(host_ea));
+  }
+
+  GpVar state(c.getGpArg(0));
+  c.mov(qword_ptr(state, offsetof(xe_ppc_state_t, reserve_value)), raw);
+  c.mov(dword_ptr(state, offsetof(xe_ppc_state_t, reserve_address)),
+        ea.r32());
+  c.mov(dword_ptr(state, offsetof(xe_ppc_state_t, reserve_size)), imm(size));
+
+  GpVar v(c.newGpVar());
+  c.mov(v, raw);
+  if (size == 4) {
+    c.bswap(v.r32());
+  } else {
+    c.bswap(v.r64());
+  }
   e.update_gpr_value(i.X.RT, v);
 
   e.clear_constant_gpr_value(i.X.RT);
@@ -1020,38 +1033,100 @@ XEEMITTER(lwarx,        0x7C000028, X  )(X64Emitter& e, X86Compiler& c, InstrDat
   return 0;
 }
 
-XEEMITTER(stdcx,        0x7C0001AD, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
-  XEINSTRNOTIMPLEMENTED();
-  return 1;
-}
-
-XEEMITTER(stwcx,        0x7C00012D, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+int XeEmitStoreConditional(X64Emitter& e, X86Compiler& c, InstrData& i,
+                           uint32_t size) {
   // if RA = 0 then
   //   b <- 0
   // else
   //   b <- (RA)
   // EA <- b + (RB)
-  // RESERVE stuff...
-  // MEM(EA, 4) <- (RS)[32:63]
-  // n <- 1 if store performed
+  // if RESERVE then
+  //   if RESERVE_LENGTH = size and RESERVE_ADDR = real_addr(EA) then
+  //     MEM(EA, size) <- (RS)
+  //     n <- 1
+  //   else
+  //     n <- 0
+  // else
+  //   n <- 0
+  // RESERVE <- 0
   // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
 
-  // TODO(benvanik): make this right
-
   GpVar ea(c.newGpVar());
   c.mov(ea, e.gpr_value(i.X.RB));
   if (i.X.RA) {
     c.add(ea, e.gpr_value(i.X.RA));
   }
-  GpVar v = e.gpr_value(i.X.RT);
-  e.WriteMemory(i.address, ea, 4, v, /* release */ true);
 
-  // We always succeed.
-  e.update_cr_value(0, e.get_uint64(1 << 2));
+  // Everything the store needs is set up before branching so that both
+  // paths leave the registers in the same place.
+  GpVar host_ea(e.TouchMemoryAddress(i.address, ea));
+  GpVar v(c.newGpVar());
+  c.mov(v, e.gpr_value(i.X.RT));
+  if (size == 4) {
+    c.bswap(v.r32());
+  } else {
+    c.bswap(v.r64());
+  }
+  GpVar state(c.getGpArg(0));
+  GpVar expected(c.newGpVar());
+  c.mov(expected, qword_ptr(state, offsetof(xe_ppc_state_t, reserve_value)));
+  GpVar reserve_size(c.newGpVar());
+  c.mov(reserve_size.r32(),
+        dword_ptr(state, offsetof(xe_ppc_state_t, reserve_size)));
+  GpVar n(c.newGpVar());
+  c.xor_(n, n);
+
+  // The reservation is gone whether or not the store happens.
+  c.mov(dword_ptr(state, offsetof(xe_ppc_state_t, reserve_size)), imm(0));
+
+  Label done_label(c.newLabel());
+  c.cmp(reserve_size.r32(), imm(size));
+  c.jne(done_label, kCondHintUnlikely);
+  c.cmp(ea.r32(),
+        dword_ptr(state, offsetof(xe_ppc_state_t, reserve_address)));
+  c.jne(done_label, kCondHintUnlikely);
+  c.lock();
+  if (size == 4) {
+    c.cmpxchg(dword_ptr(host_ea), v.r32(), expected.r32());
+  } else {
+    c.cmpxchg(qword_ptr(host_ea), v.r64(), expected.r64());
+  }
+  c.sete(n.r8());
+  c.bind(done_label);
+
+  // SO is not tracked, as with the compare instructions.
+  c.shl(n, imm(2));
+  e.update_cr_value(0, n);
 
   return 0;
 }
 
+XEEMITTER(eieio,        0x7C0006AC, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  XEINSTRNOTIMPLEMENTED();
+  return 1;
+}
+
+XEEMITTER(isync,        0x4C00012C, XL )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  XEINSTRNOTIMPLEMENTED();
+  return 1;
+}
+
+XEEMITTER(ldarx,        0x7C0000A8, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadReserve(e, c, i, 8);
+}
+
+XEEMITTER(lwarx,        0x7C000028, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitLoadReserve(e, c, i, 4);
+}
+
+XEEMITTER(stdcx,        0x7C0001AD, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreConditional(e, c, i, 8);
+}
+
+XEEMITTER(stwcx,        0x7C00012D, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
+  return XeEmitStoreConditional(e, c, i, 4);
+}
+
 XEEMITTER(sync,         0x7C0004AC, X  )(X64Emitter& e, X86Compiler& c, InstrData& i) {
   XEINSTRNOTIMPLEMENTED();
   return 1;
@@ -9,8 +9,12 @@
 
 #include <xenia/cpu/x64/x64_emitter.h>
 
+#include <algorithm>
+
 #include <xenia/cpu/cpu-private.h>
 #include <xenia/cpu/ppc/state.h>
+#include <xenia/cpu/x64/x64_emit.h>
+#include <xenia/cpu/x64/x64_jit.h>
 
 #include <beaengine/BeaEngine.h>
 
@@ -22,10 +26,77 @@ using namespace xe::cpu::x64;
 using namespace AsmJit;
 
 
+namespace {
+
+// Folded into the code cache config hash. Bump whenever the emitted code
+// changes so that functions cached by an older build are not reused.
+const uint32_t kCodegenVersion = 18;
+
+// Offsets in the redirector stubs generated by PrepareFunction.
+const size_t kRedirectorSlotOffset  = 8;
+const size_t kRedirectorThunkOffset = 16;
+
+// Register allocation budgets. Guest registers beyond these (or ones touched
+// too rarely to be worth a fill/spill) stay in the context and are accessed
+// through memory. The GP budget leaves room for the state/lr arguments and
+// temporaries.
+const uint32_t kMaxCachedGpRegisters  = 10;
+const uint32_t kMaxCachedXmmRegisters = 12;
+const uint32_t kMinCachedAccesses     = 2;
+// Accesses within a loop body count this many times per nesting level.
+const uint32_t kLoopWeight            = 8;
+const uint32_t kMaxBlockWeight        = kLoopWeight * kLoopWeight * kLoopWeight;
+
+// Flag liveness bits. CR field n is bit n.
+const uint16_t kLiveCrNonVolatile     = (1 << 2) | (1 << 3) | (1 << 4);
+const uint16_t kLiveXer               = 1 << 8;
+const uint16_t kLiveAll               = 0x1FF;
+
+void CountRegisterAccesses(uint64_t bits, uint32_t* counts, size_t count,
+                           uint32_t weight) {
+  for (size_t n = 0; n < count; n++, bits >>= 2) {
+    if (bits & 0x3) {
+      counts[n] += weight;
+    }
+  }
+}
+
+enum RegisterSet {
+  kRegisterSetSpr,
+  kRegisterSetCr,
+  kRegisterSetGpr,
+  kRegisterSetFpr,
+};
+
+typedef struct {
+  uint32_t    weight;
+  RegisterSet set;
+  uint32_t    index;
+} RegisterCandidate;
+
+bool CompareRegisterCandidates(const RegisterCandidate& a,
+                               const RegisterCandidate& b) {
+  return a.weight > b.weight;
+}
+
+}  // namespace
+
+
+DECLARE_bool(log_indirect_branch_stats);
+
 DEFINE_bool(memory_address_verification, false,
-    "Whether to add additional checks to generated memory load/stores.");
-DEFINE_bool(cache_registers, false,
-    "Cache PPC registers inside of functions.");
+    "Report guest loads/stores that fault in the host as access violations.");
+DEFINE_bool(cache_registers, true,
+    "Keep frequently used PPC registers in host registers inside functions.");
+
+DEFINE_bool(inline_indirect_branch_caches, true,
+    "Emit inline caches at indirect branch sites.");
+DEFINE_bool(inline_save_rest, true,
+    "Inline calls to the __savegprlr_*/__restgprlr_*/etc prolog helpers.");
+DEFINE_bool(hle_crt_routines, true,
+    "Replace guest CRT routines with native code: the strlen/memset byte "
+    "loops found by signature, plus memcpy/memmove/memset/strlen/XMemCpy/"
+    "XMemSet when named by a loaded module map.");
 
 DEFINE_bool(log_codegen, false,
     "Log codegen to stdout.");
@@ -44,26 +115,27 @@ DEFINE_bool(annotate_disassembly, true,
  * possible to exploit the SSA nature of LLVM to reuse register values within
  * a function without needing to flush to memory.
  *
- * Function calls (any branch outside of the function) will result in an
- * expensive flush of registers.
+ * Function calls (any branch outside of the function) will result in a
+ * flush of registers. Calls to functions with a register summary from the SDB
+ * only flush the registers the target may access.
  *
  * TODO(benvanik): track arguments by looking for register reads without writes
- * TODO(benvanik): avoid flushing registers for leaf nodes
  * TODO(benvnaik): pass return value in LLVM return, not by memory
  */
 
 
-X64Emitter::X64Emitter(xe_memory_ref memory) :
-    memory_(memory), logger_(NULL) {
+X64Emitter::X64Emitter(X64JIT* jit, xe_memory_ref memory) :
+    jit_(jit), memory_(memory), cpu_features_(jit->cpu_features()),
+    logger_(NULL) {
   // I don't like doing this, but there's no public access to these members.
   assembler_._properties = compiler_._properties;
 
   // Grab global exports.
   cpu::GetGlobalExports(&global_exports_);
 
-  // Lock used for all codegen.
-  // It'd be nice to have multiple emitters/etc that could be used to prevent
-  // contention of the JIT.
+  // Lock held by whichever thread is currently using this emitter.
+  // The JIT owns a pool of emitters and hands them out to compiling threads,
+  // so this is only contended when the pool is exhausted.
   lock_ = xe_mutex_alloc(10000);
   XEASSERTNOTNULL(lock_);
 
@@ -100,13 +172,20 @@ void X64Emitter::Lock() {
   xe_mutex_lock(lock_);
 }
 
+bool X64Emitter::TryLock() {
+  return xe_mutex_trylock(lock_) == 0;
+}
+
 void X64Emitter::Unlock() {
   xe_mutex_unlock(lock_);
 }
 
 int X64Emitter::PrepareFunction(FunctionSymbol* symbol) {
+  // NOTE: the caller must hold this emitter (see X64JIT::AcquireEmitter).
+  // Other emitters may be preparing the same symbol concurrently, so the
+  // result is published with a CAS below.
   int result_code = 1;
-  Lock();
+  void* fn_ptr = NULL;
 
   if (symbol->impl_value) {
     result_code = 0;
@@ -117,20 +196,32 @@ int X64Emitter::PrepareFunction(FunctionSymbol* symbol) {
 
   // Create the custom redirector function.
   // This function will jump to the on-demand compilation routine to
-  // generate the real function as required. Afterwards, it will be
-  // overwritten with a jump to the new function.
+  // generate the real function as required. Afterwards, the jump slot is
+  // switched over to the new function.
+  //
+  // The stub never changes after it's made - it always jumps through an
+  // 8b aligned slot, and compiling the function is just an atomic store of
+  // the new target into it. As that's a data write there are no
+  // cross-modifying code issues with other threads running the stub.
 
   if (logger_) {
     logger_->setEnabled(false);
   }
 
   // PrepareFunction:
-  // ; mov rcx, ppc_state -- comes in as arg
-  // ; mov rdx, lr        -- comes in as arg
-  // mov r8, [emitter]
-  // mov r9, [symbol]
-  // call [OnDemandCompileTrampoline]
-  // jmp [rax]
+  // +0   jmp [rip + 2]         ; -> [+8]
+  // +6   nop x2
+  // +8   dq target             ; initially +16, patched by OnDemandCompile
+  // +16  ; mov rcx, ppc_state  -- comes in as arg
+  //      ; mov rdx, lr         -- comes in as arg
+  //      mov r8, [jit]
+  //      mov r9, [symbol]
+  //      call [OnDemandCompileTrampoline]
+  //      jmp [rax]
+  assembler_.db(0xFF); assembler_.db(0x25); assembler_.dd(2);
+  assembler_.nop(); assembler_.nop();
+  assembler_.dq(0);
+  XEASSERT(assembler_.getOffset() == kRedirectorThunkOffset);
 
 #if defined(ASMJIT_WINDOWS)
   // Calling convetion: kX86FuncConvX64W
@@ -138,9 +229,9 @@ int X64Emitter::PrepareFunction(FunctionSymbol* symbol) {
   assembler_.push(rcx); // ppc_state
   assembler_.push(rdx); // lr
   assembler_.sub(rsp, imm(0x20));
-  assembler_.mov(rcx, imm((uint64_t)this));
+  assembler_.mov(rcx, imm((uint64_t)jit_));
   assembler_.mov(rdx, imm((uint64_t)symbol));
-  assembler_.call(X64Emitter::OnDemandCompileTrampoline);
+  assembler_.call(X64JIT::OnDemandCompileTrampoline);
   assembler_.add(rsp, imm(0x20));
   assembler_.pop(rdx); // lr
   assembler_.pop(rcx); // ppc_state
@@ -151,9 +242,9 @@ int X64Emitter::PrepareFunction(FunctionSymbol* symbol) {
   assembler_.push(rdi); // ppc_state
   assembler_.push(rsi); // lr
   assembler_.sub(rsp, imm(0x20));
-  assembler_.mov(rdi, imm((uint64_t)this));
+  assembler_.mov(rdi, imm((uint64_t)jit_));
   assembler_.mov(rsi, imm((uint64_t)symbol));
-  assembler_.call(X64Emitter::OnDemandCompileTrampoline);
+  assembler_.call(X64JIT::OnDemandCompileTrampoline);
   assembler_.add(rsp, imm(0x20));
   assembler_.pop(rsi); // lr
   assembler_.pop(rdi); // ppc_state
@@ -161,9 +252,20 @@ int X64Emitter::PrepareFunction(FunctionSymbol* symbol) {
 #endif  // ASM_JIT_WINDOWS
 
   // Assemble and stash.
-  void* fn_ptr = assembler_.make();
-  symbol->impl_value = fn_ptr;
-  symbol->impl_size = assembler_.getCodeSize();
+  // If another emitter beat us to it we throw ours away and use theirs.
+  fn_ptr = assembler_.make();
+  XEEXPECTNOTNULL(fn_ptr);
+  // MemoryManager allocations are always at least 16b aligned, so the slot is
+  // naturally aligned and stores to it are atomic.
+  XEASSERTZERO((uint64_t)fn_ptr & 0x7);
+  *(uint8_t**)((uint8_t*)fn_ptr + kRedirectorSlotOffset) =
+      (uint8_t*)fn_ptr + kRedirectorThunkOffset;
+  if (xe_atomic_cas_ptr(NULL, fn_ptr, &symbol->impl_value)) {
+    symbol->impl_size = assembler_.getCodeSize();
+    jit_->sym_table()->SetFunctionPointer(symbol->start_address, fn_ptr);
+  } else {
+    MemoryManager::getGlobal()->free(fn_ptr);
+  }
 
   result_code = 0;
 XECLEANUP:
@@ -171,21 +273,13 @@ XECLEANUP:
   if (logger_) {
     logger_->setEnabled(true);
   }
-  Unlock();
   return result_code;
 }
 
-void* X64Emitter::OnDemandCompileTrampoline(
-    X64Emitter* emitter, FunctionSymbol* symbol) {
-  // This function is called by the redirector code from PrepareFunction.
-  // We jump into the member OnDemandCompile and pass back the
-  // result.
-  return emitter->OnDemandCompile(symbol);
-}
-
 void* X64Emitter::OnDemandCompile(FunctionSymbol* symbol) {
+  // NOTE: the caller must hold this emitter and have ensured that no other
+  // emitter is compiling the same symbol (see X64JIT::OnDemandCompile).
   void* redirector_ptr = symbol->impl_value;
-  size_t redirector_size = symbol->impl_size;
 
   // Generate the real function.
   int result_code = MakeFunction(symbol);
@@ -197,34 +291,18 @@ void* X64Emitter::OnDemandCompile(FunctionSymbol* symbol) {
     return 0;
   }
 
-  // TODO(benvanik): find a way to patch in that is thread safe?
-  // Overwrite the redirector function to jump to the new one.
-  // This preserves the arguments passed to the redirector.
-  uint8_t* bp = (uint8_t*)redirector_ptr;
-  size_t o = 0;
-  uint64_t target_ptr = (uint64_t)symbol->impl_value;
-  if (target_ptr & ~0xFFFFFFFFLL) {
-    // mov rax, imm64
-    bp[o++] = 0x48; bp[o++] = 0xB8;
-    for (int n = 0; n < 8; n++) {
-      bp[o++] = (target_ptr >> (n * 8)) & 0xFF;
-    }
-  } else {
-    // mov rax, imm32
-    bp[o++] = 0x48; bp[o++] = 0xC7; bp[o++] = 0xC0;
-    for (int n = 0; n < 4; n++) {
-      bp[o++] = (target_ptr >> (n * 8)) & 0xFF;
-    }
-  }
-  // jmp rax
-  bp[o++] = 0xFF; bp[o++] = 0xE0;
+  // Indirect branches can go straight to the new code from now on.
+  jit_->sym_table()->SetFunctionPointer(
+      symbol->start_address, symbol->impl_value);
 
-  // Write some no-ops to cover up the rest of the redirection.
-  // NOTE: not currently doing this as we overwrite the code that
-  //       got us here and endup just running nops.
-  // while (o < redirector_size) {
-  //   bp[o++] = 0x90;
-  // }
+  // Switch the redirector over to the new function. Threads already in the
+  // stub either see the old slot value and come through here (and wait on
+  // the compile request) or see the new one and jump straight in.
+  void** slot = (void**)((uint8_t*)redirector_ptr + kRedirectorSlotOffset);
+  void* thunk_ptr = (uint8_t*)redirector_ptr + kRedirectorThunkOffset;
+  if (!xe_atomic_cas_ptr(thunk_ptr, symbol->impl_value, slot)) {
+    XELOGCPU("Compile(%s): redirector already patched", symbol->name());
+  }
 
   return symbol->impl_value;
 }
@@ -233,7 +311,39 @@ int X64Emitter::MakeFunction(FunctionSymbol* symbol) {
   X86Compiler& c = compiler_;
 
   int result_code = 1;
-  Lock();
+  X64CodeCache* code_cache = NULL;
+  size_t instr_size = 0;
+
+  // Guest routines with a native replacement are just calls to it.
+  x64_hle_function_t hle_function = NULL;
+  if (FLAGS_hle_crt_routines && symbol->type == FunctionSymbol::User) {
+    hle_function = X64LookupHleFunction(symbol->name());
+  }
+
+  // Only user functions are cached - kernel thunks and native replacements
+  // are tiny and bake in pointers to host code/data.
+  if (symbol->type == FunctionSymbol::User && !hle_function) {
+    code_cache = jit_->GetCodeCache(symbol->start_address);
+  }
+  if (code_cache) {
+    size_t cached_size = 0;
+    void* cached_ptr = code_cache->LoadFunction(this, symbol->start_address,
+                                                &cached_size);
+    if (cached_ptr) {
+      if (FLAGS_log_codegen) {
+        XELOGCPU("Compile(%s): loaded from code cache to 0x%p",
+            symbol->name(), cached_ptr);
+      }
+      // Access sites aren't cached, so faults in here are only attributed to
+      // the function.
+      if (FLAGS_memory_address_verification) {
+        std::vector<X64AccessSite> no_sites;
+        jit_->AddCodeRange(symbol, cached_ptr, cached_size, no_sites);
+      }
+      symbol->impl_value = cached_ptr;
+      return 0;
+    }
+  }
 
   if (FLAGS_log_codegen) {
     XELOGCPU("Compile(%s): beginning compilation...", symbol->name());
@@ -247,13 +357,44 @@ int X64Emitter::MakeFunction(FunctionSymbol* symbol) {
   external_indirection_block_ = Label();
 
   bbs_.clear();
+  access_labels_.clear();
+
+  // Track every process-specific value that may be embedded in the code so
+  // that the code cache can rebind them. Calls to other functions are
+  // recorded as they are emitted.
+  fixup_values_.clear();
+  if (code_cache) {
+    RecordFixupValue(xe_memory_addr(memory_, 0), kX64FixupMembase, 0);
+    RecordFixupValue(gpu_this_, kX64FixupGpuThis, 0);
+    RecordFixupValue(gpu_read_, kX64FixupGpuRead, 0);
+    RecordFixupValue(gpu_write_, kX64FixupGpuWrite, 0);
+    void** exports = (void**)&global_exports_;
+    for (size_t n = 0; n < sizeof(GlobalExports) / sizeof(void*); n++) {
+      RecordFixupValue(exports[n], kX64FixupGlobalExport,
+                       (uint32_t)(n * sizeof(void*)));
+    }
+    RecordFixupValue(symbol, kX64FixupSymbol, symbol->start_address);
+    RecordFixupValue(jit_->sym_table()->page_table(), kX64FixupSymbolTable, 0);
+    RecordFixupValue(X64GetVectorConstants(), kX64FixupVectorConstants, 0);
+  }
 
   access_bits_.Clear();
+  xe_zero_struct(&access_counts_, sizeof(access_counts_));
 
   clear_all_constant_gpr_values();
+  block_constants_.clear();
+  block_flags_live_out_.clear();
+  pending_cr_.is_pending = false;
+  pending_cr_.lhs = GpVar();
+  pending_cr_.rhs = GpVar();
+  pending_xer_.has_ca = false;
+  pending_xer_.has_ov = false;
+  pending_xer_.ca = GpVar();
+  pending_xer_.ov = GpVar();
 
   locals_.indirection_target = GpVar();
   locals_.indirection_cia = GpVar();
+  locals_.membase = GpVar();
 
   locals_.xer = GpVar();
   locals_.lr = GpVar();
@@ -285,7 +426,11 @@ int X64Emitter::MakeFunction(FunctionSymbol* symbol) {
     }
     break;
   case FunctionSymbol::User:
-    result_code = MakeUserFunction();
+    if (hle_function) {
+      result_code = MakeHleFunction(hle_function);
+    } else {
+      result_code = MakeUserFunction();
+    }
     break;
   default:
     XEASSERTALWAYS();
@@ -306,8 +451,40 @@ int X64Emitter::MakeFunction(FunctionSymbol* symbol) {
   XEEXPECTZERO(result_code);
 
   // Perform final assembly/relocation.
+  instr_size = assembler_.getOffset();
   symbol->impl_value = assembler_.make();
 
+  // Let the JIT map faults in this code back to guest instructions.
+  if (FLAGS_memory_address_verification && symbol->impl_value) {
+    std::vector<X64AccessSite> access_sites;
+    for (std::vector<AccessLabel>::iterator it = access_labels_.begin();
+         it != access_labels_.end(); ++it) {
+      // Like _properties above, label offsets have no public accessor.
+      // Labels dropped as unreachable are never bound and have no offset.
+      const intptr_t offset = assembler_._labels[
+          it->label.getId() & kOperandIdValueMask].offset;
+      if (offset >= 0) {
+        X64AccessSite site;
+        site.host_offset = (uint32_t)offset;
+        site.cia = it->cia;
+        access_sites.push_back(site);
+      }
+    }
+    jit_->AddCodeRange(symbol, symbol->impl_value, assembler_.getCodeSize(),
+                       access_sites);
+  }
+
+  // Stash in the code cache for future runs. Functions that reference
+  // something we can't rebind are just not cached.
+  if (code_cache && symbol->impl_value) {
+    if (code_cache->AddFunction(symbol->start_address,
+                                (const uint8_t*)symbol->impl_value,
+                                assembler_.getCodeSize(), instr_size,
+                                fixup_values_)) {
+      XELOGCPU("Compile(%s): not cacheable", symbol->name());
+    }
+  }
+
   if (FLAGS_log_codegen) {
     XELOGCPU("Compile(%s): compiled to 0x%p (%db)",
         symbol->name(),
@@ -340,7 +517,6 @@ XECLEANUP:
   assembler_.clear();
   compiler_.clear();
 
-  Unlock();
   return result_code;
 }
 
@@ -379,6 +555,26 @@ int X64Emitter::MakeMissingImportFunction() {
   return 0;
 }
 
+int X64Emitter::MakeHleFunction(x64_hle_function_t hle_function) {
+  X86Compiler& c = compiler_;
+
+  TraceUserCall();
+
+  // void hle_function(ppc_state*, data*)
+  GpVar arg1 = c.newGpVar(kX86VarTypeGpq);
+  c.xor_(arg1, arg1);
+  X86CompilerFuncCall* call = c.call((void*)hle_function);
+  call->setComment(symbol_->name());
+  call->setPrototype(kX86FuncConvDefault,
+      FuncBuilder2<void, void*, void*>());
+  call->setArgument(0, c.getGpArg(0));
+  call->setArgument(1, arg1);
+
+  c.ret();
+
+  return 0;
+}
+
 int X64Emitter::MakeUserFunction() {
   X86Compiler& c = compiler_;
 
@@ -401,6 +597,22 @@ int X64Emitter::MakeUserFunction() {
     XEIGNORE(PrepareBasicBlock(block));
   }
 
+  // Find the GPRs with known constant values on entry to each block so that
+  // addresses/etc built in one block can be used as immediates in others.
+  PropagateConstants();
+
+  // Find which CR fields/XER are read by later blocks, so that compares
+  // consumed by a branch or carries consumed in the block need not be written
+  // back.
+  ComputeFlagLiveness();
+
+  // Keep the guest memory base in a register for the whole function so that
+  // every load/store can address guest memory as [membase + ea] instead of
+  // rematerializing the 64-bit base each time. The context pointer is already
+  // pinned as the first argument.
+  locals_.membase = c.newGpVar(kX86VarTypeGpq, "membase");
+  c.mov(locals_.membase, imm((uint64_t)xe_memory_addr(memory_, 0)));
+
   // Setup all local variables now that we know what we need.
   // This happens in the entry block.
   SetupLocals();
@@ -461,18 +673,15 @@ void X64Emitter::GenerateSharedBlocks() {
       c.comment("Shared external indirection block");
     }
     SpillRegisters();
-    X86CompilerFuncCall* call = c.call(global_exports_.XeIndirectBranch);
-    call->setPrototype(kX86FuncConvDefault,
-        FuncBuilder3<void*, void*, uint64_t, uint64_t>());
-    call->setArgument(0, c.getGpArg(0));
-    call->setArgument(1, locals_.indirection_target);
-    call->setArgument(2, locals_.indirection_cia);
-    GpVar target_ptr(c.newGpVar());
-    call->setReturn(target_ptr);
+    // The shared block is one site for the entire function. The odd address
+    // keeps it from colliding with a real branch site.
+    GpVar target_ptr = LookupFunctionPointer(
+        symbol_->start_address | 1,
+        locals_.indirection_target, locals_.indirection_cia);
 
     // Call target.
     // void fn(ppc_state*, uint64_t)
-    call = c.call(target_ptr);
+    X86CompilerFuncCall* call = c.call(target_ptr);
     call->setComment("Indirection branch");
     call->setPrototype(kX86FuncConvDefault,
         FuncBuilder2<void, void*, uint64_t>());
@@ -489,16 +698,69 @@ void X64Emitter::GenerateSharedBlocks() {
     if (FLAGS_annotate_disassembly) {
       c.comment("Shared internal indirection block");
     }
-    c.int3();
-    // SwitchInst* switch_i = b.CreateSwitch(
-    //     b.CreateLoad(locals_.indirection_target),
-    //     external_indirection_block_,
-    //     static_cast<int>(bbs_.size()));
-    // for (std::map<uint32_t, BasicBlock*>::iterator it = bbs_.begin();
-    //      it != bbs_.end(); ++it) {
-    //   switch_i->addCase(b.getInt64(it->first), it->second);
-    // }
+
+    // Gather all known jump table targets in the function. Only these are
+    // searched - anything else goes external (and will likely become its own
+    // function, as it would have without the table).
+    std::vector<uint32_t> targets;
+    for (std::map<uint32_t, FunctionBlock*>::iterator it =
+         symbol_->blocks.begin(); it != symbol_->blocks.end(); ++it) {
+      FunctionBlock* block = it->second;
+      targets.insert(targets.end(),
+                     block->jump_targets.begin(), block->jump_targets.end());
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    GenerateJumpTableSearch(targets, 0, targets.size());
+  }
+}
+
+void X64Emitter::GenerateJumpTableSearch(std::vector<uint32_t>& targets,
+                                         size_t begin, size_t end) {
+  X86Compiler& c = compiler_;
+
+  // Binary search over the sorted targets, ending in direct jumps to the
+  // block labels. A real memory jump table would be a single indirect jmp,
+  // but the compiler cannot track register state across an indirect jump
+  // into blocks, so we give it explicit edges instead. Switches rarely have
+  // more than a few dozen cases, so this is only a handful of compares.
+  // Note that we compare only the low 32 bits, as the upper half may have
+  // garbage in it.
+  GpVar target = locals_.indirection_target;
+  if (end - begin <= 4) {
+    for (size_t n = begin; n < end; n++) {
+      c.cmp(target.r32(), imm(targets[n]));
+      c.je(GetBlockLabel(targets[n]));
+    }
+    c.jmp(external_indirection_block_);
+    return;
+  }
+
+  size_t mid = begin + (end - begin) / 2;
+  Label upper_label(c.newLabel());
+  c.cmp(target.r32(), imm(targets[mid]));
+  c.jae(upper_label);
+  GenerateJumpTableSearch(targets, begin, mid);
+  c.bind(upper_label);
+  GenerateJumpTableSearch(targets, mid, end);
+}
+
+uint32_t X64Emitter::GetBlockWeight(FunctionBlock* block) {
+  // Any backward branch to a block at or before us from a block at or after
+  // us forms a loop we are in. This ignores irreducible flow, which only
+  // affects how hot registers look.
+  uint32_t weight = 1;
+  for (std::map<uint32_t, FunctionBlock*>::iterator it =
+       symbol_->blocks.begin(); it != symbol_->blocks.end(); ++it) {
+    FunctionBlock* tail = it->second;
+    if (tail->outgoing_type == FunctionBlock::kTargetBlock &&
+        tail->outgoing_address <= tail->start_address &&
+        tail->outgoing_address <= block->start_address &&
+        tail->start_address >= block->start_address) {
+      weight = MIN(weight * kLoopWeight, kMaxBlockWeight);
+    }
   }
+  return weight;
 }
 
 int X64Emitter::PrepareBasicBlock(FunctionBlock* block) {
@@ -514,8 +776,39 @@ int X64Emitter::PrepareBasicBlock(FunctionBlock* block) {
   // TODO(benvanik): perhaps we want to stash this for each basic block?
   // We could use this for faster checking of cr/ca checks/etc.
   InstrAccessBits access_bits;
+  const uint32_t weight = GetBlockWeight(block);
+  int result_code = PrepareInstructions(block->start_address,
+                                        block->end_address,
+                                        weight, access_bits);
+  if (result_code) {
+    return result_code;
+  }
+
+  // Helpers that will be inlined at the end of the block are part of it.
+  if (block->outgoing_type == FunctionBlock::kTargetFunction &&
+      block->outgoing_function) {
+    uint32_t inline_end = GetInlineEndAddress(block->outgoing_function);
+    if (inline_end) {
+      result_code = PrepareInstructions(
+          block->outgoing_function->start_address, inline_end,
+          weight, access_bits);
+      if (result_code) {
+        return result_code;
+      }
+    }
+  }
+
+  // Add in access bits to function access bits.
+  access_bits_.Extend(access_bits);
+
+  return 0;
+}
+
+int X64Emitter::PrepareInstructions(uint32_t start_address,
+                                    uint32_t end_address, uint32_t weight,
+                                    InstrAccessBits& access_bits) {
   uint8_t* p = xe_memory_addr(memory_, 0);
-  for (uint32_t ia = block->start_address; ia <= block->end_address; ia += 4) {
+  for (uint32_t ia = start_address; ia <= end_address; ia += 4) {
     InstrData i;
     i.address = ia;
     i.code = XEGETUINT32BE(p + ia);
@@ -538,12 +831,280 @@ int X64Emitter::PrepareBasicBlock(FunctionBlock* block) {
 
     // Accumulate access bits.
     access_bits.Extend(d.access_bits);
+    CountRegisterAccesses(d.access_bits.spr, access_counts_.spr,
+                          XECOUNT(access_counts_.spr), weight);
+    CountRegisterAccesses(d.access_bits.cr, access_counts_.cr,
+                          XECOUNT(access_counts_.cr), weight);
+    CountRegisterAccesses(d.access_bits.gpr, access_counts_.gpr,
+                          XECOUNT(access_counts_.gpr), weight);
+    CountRegisterAccesses(d.access_bits.fpr, access_counts_.fpr,
+                          XECOUNT(access_counts_.fpr), weight);
   }
+  return 0;
+}
 
-  // Add in access bits to function access bits.
-  access_bits_.Extend(access_bits);
+void X64Emitter::PropagateConstants() {
+  // Forward dataflow over the blocks of the function. The state at the start
+  // of a block is the meet of the states at the end of all of its
+  // predecessors: a GPR is only constant if it has the same value on every
+  // incoming edge. Edges are taken from the sdb block exits plus fall-through,
+  // which may over-approximate but never misses a real edge.
+  // Blocks that can be entered from outside of the flow we can see (the
+  // function entry and jump table targets reached through the shared
+  // indirection block) start with nothing known.
+  ConstantState unknown;
+  xe_zero_struct(&unknown, sizeof(unknown));
+
+  std::vector<uint32_t> pending;
+  for (std::map<uint32_t, FunctionBlock*>::iterator it =
+       symbol_->blocks.begin(); it != symbol_->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    for (std::vector<uint32_t>::iterator jt = block->jump_targets.begin();
+         jt != block->jump_targets.end(); ++jt) {
+      block_constants_[*jt] = unknown;
+      pending.push_back(*jt);
+    }
+  }
+  block_constants_[symbol_->blocks.begin()->first] = unknown;
+  pending.push_back(symbol_->blocks.begin()->first);
 
-  return 0;
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  while (pending.size()) {
+    uint32_t address = pending.back();
+    pending.pop_back();
+    std::map<uint32_t, FunctionBlock*>::iterator it =
+        symbol_->blocks.find(address);
+    if (it == symbol_->blocks.end()) {
+      continue;
+    }
+    FunctionBlock* block = it->second;
+
+    ConstantState state = block_constants_[address];
+    for (uint32_t ia = block->start_address; ia <= block->end_address;
+         ia += 4) {
+      InstrData i;
+      i.address = ia;
+      i.code = XEGETUINT32BE(p + ia);
+      i.type = ppc::GetInstrType(i.code);
+      ppc::InstrDisasm d;
+      if (!i.type || !i.type->disassemble || i.type->disassemble(i, d)) {
+        // Nothing can be said about what this does.
+        state = unknown;
+        continue;
+      }
+      UpdateConstantState(i, d, state);
+    }
+
+    if (block->outgoing_type == FunctionBlock::kTargetBlock) {
+      if (MergeConstantState(block->outgoing_address, state)) {
+        pending.push_back(block->outgoing_address);
+      }
+    }
+
+    // Conditional branches (and calls) continue on to the next block.
+    // Anything called may clobber every GPR, so only straight-line flow
+    // carries values over.
+    ++it;
+    if (it != symbol_->blocks.end()) {
+      bool is_call =
+          block->outgoing_type == FunctionBlock::kTargetFunction ||
+          block->outgoing_type == FunctionBlock::kTargetLR ||
+          block->outgoing_type == FunctionBlock::kTargetCTR;
+      if (MergeConstantState(it->first, is_call ? unknown : state)) {
+        pending.push_back(it->first);
+      }
+    }
+  }
+}
+
+void X64Emitter::UpdateConstantState(InstrData& i, InstrDisasm& d,
+                                     ConstantState& state) {
+  // Only the immediate forms used to build addresses and constants are
+  // evaluated; this must match what their emitters track in
+  // set_constant_gpr_value. Any other write makes the GPR unknown.
+  uint32_t target = 32;
+  uint32_t source = 0;
+  bool known = false;
+  uint64_t value = 0;
+  switch (i.code >> 26) {
+  case 14:  // addi
+  case 15:  // addis
+    target = i.D.RT;
+    source = i.D.RA;
+    value = XEEXTS16(i.D.DS);
+    if ((i.code >> 26) == 15) {
+      value <<= 16;
+    }
+    if (!source) {
+      known = true;
+    } else if (state.gpr[source].is_constant) {
+      known = true;
+      value += state.gpr[source].value;
+    }
+    break;
+  case 24:  // ori
+  case 25:  // oris
+  case 26:  // xori
+  case 27:  // xoris
+  case 28:  // andi.
+  case 29:  // andis.
+    target = i.D.RA;
+    source = i.D.RT;
+    if (state.gpr[source].is_constant) {
+      known = true;
+      value = state.gpr[source].value;
+      switch (i.code >> 26) {
+      case 24: value = value | i.D.DS;          break;
+      case 25: value = value | (i.D.DS << 16);  break;
+      case 26: value = value ^ i.D.DS;          break;
+      case 27: value = value ^ (i.D.DS << 16);  break;
+      case 28: value = value & i.D.DS;          break;
+      case 29: value = value & (i.D.DS << 16);  break;
+      }
+    }
+    break;
+  }
+
+  uint64_t bits = d.access_bits.gpr;
+  for (uint32_t n = 0; n < 32; n++, bits >>= 2) {
+    if (bits & 0x2) {
+      state.gpr[n].is_constant = false;
+      state.gpr[n].value = 0;
+    }
+  }
+  if (known) {
+    state.gpr[target].is_constant = true;
+    state.gpr[target].value = value;
+  }
+}
+
+bool X64Emitter::MergeConstantState(uint32_t address, ConstantState& state) {
+  // Returns true if the entry state of the block changed and it needs to be
+  // (re)visited.
+  std::map<uint32_t, ConstantState>::iterator it =
+      block_constants_.find(address);
+  if (it == block_constants_.end()) {
+    block_constants_.insert(
+        std::pair<uint32_t, ConstantState>(address, state));
+    return true;
+  }
+  bool changed = false;
+  ConstantState& entry = it->second;
+  for (size_t n = 0; n < XECOUNT(entry.gpr); n++) {
+    if (entry.gpr[n].is_constant &&
+        (!state.gpr[n].is_constant ||
+         state.gpr[n].value != entry.gpr[n].value)) {
+      entry.gpr[n].is_constant = false;
+      entry.gpr[n].value = 0;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void X64Emitter::ComputeFlagLiveness() {
+  // Backward dataflow over the blocks of the function using the same edges as
+  // PropagateConstants. Leaving the function (calls, returns, indirect
+  // branches) only keeps the non-volatile fields cr2-cr4 live, as nothing
+  // else (including XER) may be relied upon across a call by the ABI.
+
+  // Flags read before being written (use) and written (def) in each block.
+  std::map<uint32_t, std::pair<uint16_t, uint16_t> > use_def;
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  for (std::map<uint32_t, FunctionBlock*>::iterator it =
+       symbol_->blocks.begin(); it != symbol_->blocks.end(); ++it) {
+    FunctionBlock* block = it->second;
+    uint16_t use = 0;
+    uint16_t def = 0;
+    for (uint32_t ia = block->start_address; ia <= block->end_address;
+         ia += 4) {
+      InstrData i;
+      i.address = ia;
+      i.code = XEGETUINT32BE(p + ia);
+      i.type = ppc::GetInstrType(i.code);
+      ppc::InstrDisasm d;
+      if (!i.type || !i.type->disassemble || i.type->disassemble(i, d)) {
+        // Could read anything.
+        use |= kLiveAll & ~def;
+        continue;
+      }
+      // CR fields are 2 bits each, XER is the low 2 bits of spr.
+      uint64_t bits = d.access_bits.cr | ((d.access_bits.spr & 0x3) << 16);
+      for (uint32_t n = 0; n < 9; n++, bits >>= 2) {
+        if ((bits & 0x1) && !(def & (1 << n))) {
+          use |= 1 << n;
+        }
+        if (bits & 0x2) {
+          def |= 1 << n;
+        }
+      }
+    }
+    use_def[it->first] = std::make_pair(use, def);
+    block_flags_live_out_[it->first] = 0;
+  }
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::map<uint32_t, FunctionBlock*>::reverse_iterator it =
+         symbol_->blocks.rbegin(); it != symbol_->blocks.rend(); ++it) {
+      FunctionBlock* block = it->second;
+      uint16_t live = 0;
+      switch (block->outgoing_type) {
+      case FunctionBlock::kTargetBlock:
+        if (symbol_->blocks.count(block->outgoing_address)) {
+          std::pair<uint16_t, uint16_t>& target =
+              use_def[block->outgoing_address];
+          live |= target.first |
+              (block_flags_live_out_[block->outgoing_address] &
+               ~target.second);
+        } else {
+          live = kLiveAll;
+        }
+        break;
+      case FunctionBlock::kTargetFunction:
+      case FunctionBlock::kTargetLR:
+        live |= kLiveCrNonVolatile;
+        break;
+      case FunctionBlock::kTargetCTR:
+        live |= kLiveCrNonVolatile;
+        for (std::vector<uint32_t>::iterator jt = block->jump_targets.begin();
+             jt != block->jump_targets.end(); ++jt) {
+          if (symbol_->blocks.count(*jt)) {
+            std::pair<uint16_t, uint16_t>& target = use_def[*jt];
+            live |= target.first |
+                (block_flags_live_out_[*jt] & ~target.second);
+          } else {
+            live = kLiveAll;
+          }
+        }
+        break;
+      case FunctionBlock::kTargetNone:
+        break;
+      default:
+      case FunctionBlock::kTargetUnknown:
+        live = kLiveAll;
+        break;
+      }
+
+      // Anything may also continue on to the next block.
+      if (it != symbol_->blocks.rbegin()) {
+        std::map<uint32_t, FunctionBlock*>::reverse_iterator next = it;
+        --next;
+        std::pair<uint16_t, uint16_t>& target = use_def[next->first];
+        live |= target.first |
+            (block_flags_live_out_[next->first] & ~target.second);
+      } else if (block->outgoing_type == FunctionBlock::kTargetNone) {
+        live = kLiveAll;
+      }
+
+      uint16_t& live_out = block_flags_live_out_[it->first];
+      if ((live | live_out) != live_out) {
+        live_out |= live;
+        changed = true;
+      }
+    }
+  }
 }
 
 void X64Emitter::GenerateBasicBlock(FunctionBlock* block) {
@@ -559,12 +1120,15 @@ void X64Emitter::GenerateBasicBlock(FunctionBlock* block) {
     c.comment("bb %.8X - %.8X", block->start_address, block->end_address);
   }
 
-  // Reset constant values.
-  // They may be valid, but it's hard to tell.
-  // If we wanted we could ensure that any incoming edges were immediately
-  // preceeding us and not something that was messing with the values, however
-  // most constant values are set within their own blocks anyway.
-  clear_all_constant_gpr_values();
+  // Start with the constant values known on all incoming edges.
+  std::map<uint32_t, ConstantState>::iterator constants_it =
+      block_constants_.find(block->start_address);
+  if (constants_it != block_constants_.end()) {
+    xe_copy_struct(gpr_values_, constants_it->second.gpr,
+                   sizeof(gpr_values_));
+  } else {
+    clear_all_constant_gpr_values();
+  }
 
   // This will create a label if it hasn't already been done.
   std::map<uint32_t, Label>::iterator label_it =
@@ -579,63 +1143,13 @@ void X64Emitter::GenerateBasicBlock(FunctionBlock* block) {
     i.address = ia;
     i.code = XEGETUINT32BE(p + ia);
     i.type = ppc::GetInstrType(i.code);
-
-    // Add debugging tag.
-    // TODO(benvanik): add debugging info?
-
-    if (FLAGS_log_codegen || FLAGS_annotate_disassembly) {
-      if (!i.type) {
-        if (FLAGS_log_codegen) {
-          printf("%.8X: %.8X ???", ia, i.code);
-        }
-        if (FLAGS_annotate_disassembly) {
-          c.comment("%.8X: %.8X ???", ia, i.code);
-        }
-      } else if (i.type->disassemble) {
-        ppc::InstrDisasm d;
-        i.type->disassemble(i, d);
-        std::string disasm;
-        d.Dump(disasm);
-        if (FLAGS_log_codegen) {
-          printf("    %.8X: %.8X %s\n", ia, i.code, disasm.c_str());
-        }
-        if (FLAGS_annotate_disassembly) {
-          c.comment("%.8X: %.8X %s", ia, i.code, disasm.c_str());
-        }
-      } else {
-        if (FLAGS_log_codegen) {
-          printf("    %.8X: %.8X %s ???\n", ia, i.code, i.type->name);
-        }
-        if (FLAGS_annotate_disassembly) {
-          c.comment("%.8X: %.8X %s ???", ia, i.code, i.type->name);
-        }
-      }
-    }
-
-    if (FLAGS_log_codegen) {
-      fflush(stdout);
-    }
-
-    TraceInstruction(i);
-
-    if (!i.type) {
-      XELOGCPU("Invalid instruction %.8X %.8X", ia, i.code);
-      TraceInvalidInstruction(i);
-      continue;
-    }
-
-    typedef int (*InstrEmitter)(X64Emitter& g, X86Compiler& c, InstrData& i);
-    InstrEmitter emit = (InstrEmitter)i.type->emit;
-    if (!i.type->emit || emit(*this, compiler_, i)) {
-      // This printf is handy for sort/uniquify to find instructions.
-      printf("unimplinstr %s\n", i.type->name);
-
-      XELOGCPU("Unimplemented instr %.8X %.8X %s",
-               ia, i.code, i.type->name);
-      TraceInvalidInstruction(i);
-    }
+    GenerateInstruction(i);
   }
 
+  // Write back any CR field/XER bits still pending before leaving the block.
+  FlushPendingCr(true);
+  FlushPendingXer(true);
+
   // If we fall through, create the branch.
   if (block->outgoing_type == FunctionBlock::kTargetNone) {
     // BasicBlock* next_bb = GetNextBasicBlock();
@@ -652,6 +1166,132 @@ void X64Emitter::GenerateBasicBlock(FunctionBlock* block) {
   // TODO(benvanik): finish up BB
 }
 
+void X64Emitter::GenerateInstruction(InstrData& i) {
+  X86Compiler& c = compiler_;
+
+  // Add debugging tag.
+  // TODO(benvanik): add debugging info?
+
+  if (FLAGS_log_codegen || FLAGS_annotate_disassembly) {
+    if (!i.type) {
+      if (FLAGS_log_codegen) {
+        printf("%.8X: %.8X ???", i.address, i.code);
+      }
+      if (FLAGS_annotate_disassembly) {
+        c.comment("%.8X: %.8X ???", i.address, i.code);
+      }
+    } else if (i.type->disassemble) {
+      ppc::InstrDisasm d;
+      i.type->disassemble(i, d);
+      std::string disasm;
+      d.Dump(disasm);
+      if (FLAGS_log_codegen) {
+        printf("    %.8X: %.8X %s\n", i.address, i.code, disasm.c_str());
+      }
+      if (FLAGS_annotate_disassembly) {
+        c.comment("%.8X: %.8X %s", i.address, i.code, disasm.c_str());
+      }
+    } else {
+      if (FLAGS_log_codegen) {
+        printf("    %.8X: %.8X %s ???\n", i.address, i.code, i.type->name);
+      }
+      if (FLAGS_annotate_disassembly) {
+        c.comment("%.8X: %.8X %s ???", i.address, i.code, i.type->name);
+      }
+    }
+  }
+
+  if (FLAGS_log_codegen) {
+    fflush(stdout);
+  }
+
+  TraceInstruction(i);
+
+  if (!i.type) {
+    XELOGCPU("Invalid instruction %.8X %.8X", i.address, i.code);
+    TraceInvalidInstruction(i);
+    return;
+  }
+
+  typedef int (*InstrEmitter)(X64Emitter& g, X86Compiler& c, InstrData& i);
+  InstrEmitter emit = (InstrEmitter)i.type->emit;
+  gpr_values_set_ = 0;
+  if (!i.type->emit || emit(*this, compiler_, i)) {
+    // This printf is handy for sort/uniquify to find instructions.
+    printf("unimplinstr %s\n", i.type->name);
+
+    XELOGCPU("Unimplemented instr %.8X %.8X %s",
+             i.address, i.code, i.type->name);
+    TraceInvalidInstruction(i);
+  }
+
+  // Values may now be live across blocks, so anything written that the
+  // emitter didn't explicitly track can no longer be trusted.
+  ppc::InstrDisasm d;
+  if (!i.type->disassemble || i.type->disassemble(i, d)) {
+    clear_all_constant_gpr_values();
+  } else {
+    uint64_t bits = d.access_bits.gpr;
+    for (uint32_t n = 0; n < 32; n++, bits >>= 2) {
+      if ((bits & 0x2) && !(gpr_values_set_ & (1u << n))) {
+        clear_constant_gpr_value(n);
+      }
+    }
+  }
+}
+
+uint32_t X64Emitter::GetInlineEndAddress(FunctionSymbol* target_symbol) {
+  // Only the compiler's register save/restore helpers are inlined. Each is a
+  // run of loads/stores off of r1 (r12 for VMX) entered part way through for
+  // the registers a function uses, and ends in a blr.
+  const uint32_t save_rest_flags =
+      FunctionSymbol::kFlagSaveGprLr | FunctionSymbol::kFlagRestGprLr |
+      FunctionSymbol::kFlagSaveFpr | FunctionSymbol::kFlagRestFpr |
+      FunctionSymbol::kFlagSaveVmx | FunctionSymbol::kFlagRestVmx;
+  if (!FLAGS_inline_save_rest || FLAGS_trace_user_calls ||
+      !(target_symbol->flags & save_rest_flags)) {
+    return 0;
+  }
+
+  // The longest is __savevmx_64/__restvmx_64 at 64 li/stvx pairs.
+  const uint32_t max_length = 160 * 4;
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  for (uint32_t ia = target_symbol->start_address;
+       ia < target_symbol->start_address + max_length; ia += 4) {
+    if (XEGETUINT32BE(p + ia) == 0x4E800020) {
+      // blr
+      return ia != target_symbol->start_address ? ia - 4 : 0;
+    }
+  }
+  return 0;
+}
+
+bool X64Emitter::IsInlinedFunction(FunctionSymbol* target_symbol) {
+  return GetInlineEndAddress(target_symbol) != 0;
+}
+
+void X64Emitter::InlineFunction(FunctionSymbol* target_symbol) {
+  X86Compiler& c = compiler_;
+
+  uint32_t end_address = GetInlineEndAddress(target_symbol);
+  XEASSERTNOTZERO(end_address);
+
+  if (FLAGS_annotate_disassembly) {
+    c.comment("inlined %s", target_symbol->name());
+  }
+
+  // Everything but the final blr, which is up to the caller.
+  uint8_t* p = xe_memory_addr(memory_, 0);
+  for (uint32_t ia = target_symbol->start_address; ia <= end_address;
+       ia += 4) {
+    InstrData i;
+    i.address = ia;
+    i.code = XEGETUINT32BE(p + ia);
+    i.type = ppc::GetInstrType(i.code);
+    GenerateInstruction(i);
+  }
+}
+
 Label& X64Emitter::GetReturnLabel() {
   X86Compiler& c = compiler_;
   // Implicit creation on first use.
@@ -674,10 +1314,18 @@ int X64Emitter::CallFunction(FunctionSymbol* target_symbol,
   // If the target function was small we could try to make the whole thing now.
   PrepareFunction(target_symbol);
 
-  SpillRegisters();
+  // Only what the callee may access needs to be in memory. Tail calls never
+  // come back here, so everything is spilled for our caller.
+  if (!tail && (target_symbol->flags & FunctionSymbol::kFlagAccessSummary)) {
+    SpillRegisters(&target_symbol->access_summary);
+  } else {
+    SpillRegisters();
+  }
 
   uint64_t target_ptr = (uint64_t)target_symbol->impl_value;
   XEASSERTNOTNULL(target_ptr);
+  RecordFixupValue(target_symbol->impl_value, kX64FixupFunction,
+                   target_symbol->start_address);
 
 #if 0
   if (tail) {
@@ -926,6 +1574,8 @@ int X64Emitter::GenerateIndirectionBranch(uint32_t cia, GpVar& target,
       external_indirection_block_.getId() == kInvalidValue) {
     external_indirection_block_ = c.newLabel();
   }
+  // Only switches through a known jump table stay local.
+  likely_local = likely_local && fn_block_->jump_targets.size();
   if (likely_local && internal_indirection_block_.getId() == kInvalidValue) {
     internal_indirection_block_ = c.newLabel();
   }
@@ -942,7 +1592,6 @@ int X64Emitter::GenerateIndirectionBranch(uint32_t cia, GpVar& target,
   // If it is jump to that basic block. If the basic block is not found it means
   // we have a jump inside the function that wasn't identified via static
   // analysis. These are bad as they require function regeneration.
-#if 0
   if (likely_local) {
     // Note that we only support LK=0, as we are using shared tables.
     XEASSERT(!lk);
@@ -950,18 +1599,15 @@ int X64Emitter::GenerateIndirectionBranch(uint32_t cia, GpVar& target,
     c.save(locals_.indirection_target);
     c.mov(locals_.indirection_cia, imm(cia));
     c.save(locals_.indirection_cia);
-    // if (target >= start && target < end) jmp internal_indirection_block;
+    // if (target >= start && target <= end) jmp internal_indirection_block;
     // else jmp external_indirection_block;
-    GpVar in_range(c.newGpVar());
-    c.cmp(target, imm(symbol_->start_address));
-    c.setge(in_range.r8Lo());
-    c.jl(external_indirection_block_, kCondHintLikely);
-    c.cmp(target, imm(symbol_->end_address));
-    c.jge(external_indirection_block_, kCondHintLikely);
+    c.cmp(target.r32(), imm(symbol_->start_address));
+    c.jb(external_indirection_block_, kCondHintUnlikely);
+    c.cmp(target.r32(), imm(symbol_->end_address));
+    c.ja(external_indirection_block_, kCondHintUnlikely);
     c.jmp(internal_indirection_block_);
     return 0;
   }
-#endif
 
   // If we are LK=0 jump to the shared indirection block. This prevents us
   // from needing to fill the registers again after the call and shares more
@@ -983,18 +1629,11 @@ int X64Emitter::GenerateIndirectionBranch(uint32_t cia, GpVar& target,
     // TODO(benvanik): remove once fixed: https://code.google.com/p/asmjit/issues/detail?id=86
     GpVar arg2 = c.newGpVar(kX86VarTypeGpq);
     c.mov(arg2, imm(cia));
-    X86CompilerFuncCall* call = c.call(global_exports_.XeIndirectBranch);
-    call->setPrototype(kX86FuncConvDefault,
-        FuncBuilder3<void*, void*, uint64_t, uint64_t>());
-    call->setArgument(0, c.getGpArg(0));
-    call->setArgument(1, target);
-    call->setArgument(2, arg2);
-    GpVar target_ptr(c.newGpVar());
-    call->setReturn(target_ptr);
+    GpVar target_ptr = LookupFunctionPointer(cia, target, arg2);
 
     // Call target.
     // void fn(ppc_state*, uint64_t)
-    call = c.call(target_ptr);
+    X86CompilerFuncCall* call = c.call(target_ptr);
     call->setComment("Indirection branch");
     call->setPrototype(kX86FuncConvDefault,
         FuncBuilder2<void, void*, uint64_t>());
@@ -1011,11 +1650,201 @@ int X64Emitter::GenerateIndirectionBranch(uint32_t cia, GpVar& target,
   return 0;
 }
 
-GpVar X64Emitter::read_gpu_register(uint32_t r) {
-  X86Compiler& c = compiler_;
+void X64Emitter::RecordFixupValue(const void* value, X64FixupType type,
+                                  uint32_t key) {
+  if (!value) {
+    return;
+  }
+  X64FixupValue fixup_value = { (uint64_t)value, type, key };
+  fixup_values_.push_back(fixup_value);
+}
 
-  GpVar this_imm(c.newGpVar());
-  c.mov(this_imm, imm((uint64_t)gpu_this_));
+int X64Emitter::ResolveFixupValue(uint32_t type, uint32_t key,
+                                  uint64_t* out_value) {
+  FunctionSymbol* target_symbol;
+  switch (type) {
+  case kX64FixupMembase:
+    *out_value = (uint64_t)xe_memory_addr(memory_, 0);
+    return 0;
+  case kX64FixupGpuThis:
+    *out_value = (uint64_t)gpu_this_;
+    return gpu_this_ ? 0 : 1;
+  case kX64FixupGpuRead:
+    *out_value = (uint64_t)gpu_read_;
+    return gpu_read_ ? 0 : 1;
+  case kX64FixupGpuWrite:
+    *out_value = (uint64_t)gpu_write_;
+    return gpu_write_ ? 0 : 1;
+  case kX64FixupGlobalExport:
+    if (key + sizeof(void*) > sizeof(GlobalExports)) {
+      return 1;
+    }
+    *out_value = *(uint64_t*)((uint8_t*)&global_exports_ + key);
+    return 0;
+  case kX64FixupSymbol:
+    target_symbol = jit_->sym_table()->GetFunction(key);
+    if (!target_symbol) {
+      return 1;
+    }
+    *out_value = (uint64_t)target_symbol;
+    return 0;
+  case kX64FixupSymbolTable:
+    *out_value = (uint64_t)jit_->sym_table()->page_table();
+    return 0;
+  case kX64FixupIndirectBranchCache:
+    // Statistics start over with each run.
+    *out_value = (uint64_t)jit_->AllocIndirectBranchCache(key);
+    return 0;
+  case kX64FixupVectorConstants:
+    *out_value = (uint64_t)X64GetVectorConstants();
+    return 0;
+  case kX64FixupFunction:
+    // Callees get a redirector just like when compiling the call.
+    target_symbol = jit_->sym_table()->GetFunction(key);
+    if (!target_symbol || PrepareFunction(target_symbol)) {
+      return 1;
+    }
+    *out_value = (uint64_t)target_symbol->impl_value;
+    return 0;
+  default:
+    return 1;
+  }
+}
+
+uint32_t X64Emitter::GetConfigHash(uint32_t cpu_features) {
+  // Any flag that changes the generated code must be part of this so that
+  // cached code is not reused across configurations.
+  const bool flags[] = {
+    FLAGS_memory_address_verification,
+    FLAGS_cache_registers,
+    FLAGS_inline_indirect_branch_caches,
+    FLAGS_log_indirect_branch_stats,
+    FLAGS_inline_save_rest,
+    FLAGS_hle_crt_routines,
+    FLAGS_trace_instructions,
+    FLAGS_trace_registers,
+    FLAGS_trace_branches,
+    FLAGS_trace_user_calls,
+    FLAGS_trace_kernel_calls,
+  };
+  uint32_t hash = 2166136261u;
+  for (size_t n = 0; n < XECOUNT(flags); n++) {
+    hash = (hash ^ (flags[n] ? 1 : 0)) * 16777619u;
+  }
+  // Generated code bakes in the emitter version and the state layout.
+  const uint32_t values[] = {
+    kCodegenVersion,
+    (uint32_t)sizeof(GlobalExports),
+    (uint32_t)sizeof(xe_ppc_state_t),
+    (uint32_t)offsetof(xe_ppc_state_t, r),
+    (uint32_t)offsetof(xe_ppc_state_t, v),
+    (uint32_t)offsetof(xe_ppc_state_t, f),
+    (uint32_t)offsetof(xe_ppc_state_t, reserve_value),
+    (uint32_t)offsetof(xe_ppc_state_t, reserve_address),
+    (uint32_t)offsetof(xe_ppc_state_t, reserve_size),
+  };
+  for (size_t n = 0; n < XECOUNT(values); n++) {
+    hash = (hash ^ values[n]) * 16777619u;
+  }
+  hash = (hash ^ X64GetVectorConfig()) * 16777619u;
+  hash = (hash ^ cpu_features) * 16777619u;
+  return hash;
+}
+
+GpVar X64Emitter::LookupFunctionPointer(uint32_t site_cia, GpVar& target,
+                                        GpVar& cia) {
+  X86Compiler& c = compiler_;
+
+  GpVar target_ptr(c.newGpVar());
+  Label done_label(c.newLabel());
+  Label table_label(c.newLabel());
+
+  if (FLAGS_inline_indirect_branch_caches) {
+    // Check the site's inline cache first. Most indirect branches (virtual
+    // calls, function pointers/etc) only ever see one or two targets.
+    // On a miss XeIndirectBranchMiss resolves the target and fills the cache.
+    // Once the cache is full and still missing the site is megamorphic and
+    // we go straight to the table lookup below.
+    IndirectBranchCache* cache = jit_->AllocIndirectBranchCache(site_cia);
+    RecordFixupValue(cache, kX64FixupIndirectBranchCache, site_cia);
+    GpVar cache_ptr(c.newGpVar());
+    c.mov(cache_ptr, imm((uint64_t)cache));
+    for (size_t n = 0; n < XE_INDIRECT_BRANCH_CACHE_SIZE; n++) {
+      Label next_label(c.newLabel());
+      size_t entry_offset = offsetof(IndirectBranchCache, entries) +
+          n * sizeof(IndirectBranchCacheEntry);
+      c.cmp(target, qword_ptr(cache_ptr, entry_offset +
+          offsetof(IndirectBranchCacheEntry, target)));
+      c.jne(next_label, kCondHintUnlikely);
+      c.mov(target_ptr, qword_ptr(cache_ptr, entry_offset +
+          offsetof(IndirectBranchCacheEntry, target_ptr)));
+      // Racy, but these are only statistics. Every thread hitting the site
+      // would fight over the line, so only count when they'll be logged.
+      if (FLAGS_log_indirect_branch_stats) {
+        c.inc(qword_ptr(cache_ptr, offsetof(IndirectBranchCache, hits)));
+      }
+      c.jmp(done_label);
+      c.bind(next_label);
+    }
+    c.cmp(dword_ptr(cache_ptr, offsetof(IndirectBranchCache, megamorphic)),
+          imm(0));
+    c.jnz(table_label, kCondHintNone);
+    X86CompilerFuncCall* call = c.call(global_exports_.XeIndirectBranchMiss);
+    call->setPrototype(kX86FuncConvDefault,
+        FuncBuilder4<void*, void*, uint64_t, uint64_t, void*>());
+    call->setArgument(0, c.getGpArg(0));
+    call->setArgument(1, target);
+    call->setArgument(2, cia);
+    call->setArgument(3, cache_ptr);
+    call->setReturn(target_ptr);
+    c.jmp(done_label);
+
+    c.bind(table_label);
+    if (FLAGS_log_indirect_branch_stats) {
+      c.inc(qword_ptr(cache_ptr, offsetof(IndirectBranchCache, misses)));
+    }
+  }
+
+  // Inline lookup in the symbol table pages:
+  //   page = pages[target >> 16];
+  //   target_ptr = page ? page[(target & 0xFFFF) >> 2].code : NULL;
+  // Entries are 16b, so (target & 0xFFFC) * 4 is the entry offset.
+  // Only if the function has not been prepared yet (or is outside of any
+  // module) do we take the slow path through XeIndirectBranch.
+  Label slow_label(c.newLabel());
+  GpVar page(c.newGpVar());
+  GpVar index(c.newGpVar());
+  c.mov(page, imm((uint64_t)jit_->sym_table()->page_table()));
+  c.mov(index.r32(), target.r32());
+  c.shr(index.r32(), imm(SymbolTable::kPageShift));
+  c.mov(page, qword_ptr(page, index, kScale8Times));
+  c.test(page, page);
+  c.jz(slow_label, kCondHintUnlikely);
+  c.mov(index.r32(), target.r32());
+  c.and_(index.r32(), imm(0xFFFC));
+  c.mov(target_ptr, qword_ptr(page, index, kScale4Times,
+                              offsetof(SymbolTable::Entry, code)));
+  c.test(target_ptr, target_ptr);
+  c.jnz(done_label, kCondHintLikely);
+
+  c.bind(slow_label);
+  X86CompilerFuncCall* call = c.call(global_exports_.XeIndirectBranch);
+  call->setPrototype(kX86FuncConvDefault,
+      FuncBuilder3<void*, void*, uint64_t, uint64_t>());
+  call->setArgument(0, c.getGpArg(0));
+  call->setArgument(1, target);
+  call->setArgument(2, cia);
+  call->setReturn(target_ptr);
+
+  c.bind(done_label);
+  return target_ptr;
+}
+
+GpVar X64Emitter::read_gpu_register(uint32_t r) {
+  X86Compiler& c = compiler_;
+
+  GpVar this_imm(c.newGpVar());
+  c.mov(this_imm, imm((uint64_t)gpu_this_));
   GpVar reg_imm(c.newGpVar());
   c.mov(reg_imm, imm(r & 0xFFFF));
 
@@ -1053,52 +1882,103 @@ void X64Emitter::SetupLocals() {
     return;
   }
 
-  uint64_t spr_t = access_bits_.spr;
-  if (spr_t & 0x3) {
-    locals_.xer = c.newGpVar(kX86VarTypeGpq, "xer");
+  // Rank every accessed register by its weighted access count and give host
+  // registers to the hottest ones, within the budgets. The locals live for
+  // the whole function so values stay in registers across blocks; AsmJit
+  // spills them to the stack itself if it runs out. Registers not chosen
+  // go through the context on each access.
+  std::vector<RegisterCandidate> candidates;
+  for (uint32_t n = 0; n < XECOUNT(access_counts_.spr); n++) {
+    if (n == 1 && is_leaf_function()) {
+      // LR is only read by the return check, which can load it itself.
+      continue;
+    }
+    RegisterCandidate candidate = {
+        access_counts_.spr[n], kRegisterSetSpr, n };
+    candidates.push_back(candidate);
+  }
+  for (uint32_t n = 0; n < XECOUNT(access_counts_.cr); n++) {
+    RegisterCandidate candidate = {
+        access_counts_.cr[n], kRegisterSetCr, n };
+    candidates.push_back(candidate);
   }
-  spr_t >>= 2;
-  if (spr_t & 0x3) {
-    locals_.lr = c.newGpVar(kX86VarTypeGpq, "lr");
+  for (uint32_t n = 0; n < XECOUNT(access_counts_.gpr); n++) {
+    RegisterCandidate candidate = {
+        access_counts_.gpr[n], kRegisterSetGpr, n };
+    candidates.push_back(candidate);
   }
-  spr_t >>= 2;
-  if (spr_t & 0x3) {
-    locals_.ctr = c.newGpVar(kX86VarTypeGpq, "ctr");
+  for (uint32_t n = 0; n < XECOUNT(access_counts_.fpr); n++) {
+    RegisterCandidate candidate = {
+        access_counts_.fpr[n], kRegisterSetFpr, n };
+    candidates.push_back(candidate);
   }
-  spr_t >>= 2;
-  // TODO: FPCSR
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   CompareRegisterCandidates);
 
-  char name[8];
+  static const char* spr_names[] = { "xer", "lr", "ctr" };
+  GpVar* spr_locals[] = { &locals_.xer, &locals_.lr, &locals_.ctr };
 
-  uint64_t cr_t = access_bits_.cr;
-  for (int n = 0; n < 8; n++) {
-    if (cr_t & 3) {
-      xesnprintfa(name, XECOUNT(name), "cr%d", n);
-      locals_.cr[n] = c.newGpVar(kX86VarTypeGpd, name);
+  char name[8];
+  uint32_t gp_count = 0;
+  uint32_t xmm_count = 0;
+  for (std::vector<RegisterCandidate>::iterator it = candidates.begin();
+       it != candidates.end(); ++it) {
+    if (it->weight < kMinCachedAccesses) {
+      break;
     }
-    cr_t >>= 2;
-  }
-
-  uint64_t gpr_t = access_bits_.gpr;
-  for (int n = 0; n < 32; n++) {
-    if (gpr_t & 3) {
-      xesnprintfa(name, XECOUNT(name), "r%d", n);
-      locals_.gpr[n] = c.newGpVar(kX86VarTypeGpq, name);
+    if (it->set == kRegisterSetFpr) {
+      if (xmm_count < kMaxCachedXmmRegisters) {
+        xesnprintfa(name, XECOUNT(name), "f%d", it->index);
+        locals_.fpr[it->index] = c.newXmmVar(kX86VarTypeXmmSD, name);
+        xmm_count++;
+      }
+      continue;
     }
-    gpr_t >>= 2;
-  }
-
-  uint64_t fpr_t = access_bits_.fpr;
-  for (int n = 0; n < 32; n++) {
-    if (fpr_t & 3) {
-      xesnprintfa(name, XECOUNT(name), "f%d", n);
-      locals_.fpr[n] = c.newXmmVar(kX86VarTypeXmmSD, name);
+    if (gp_count >= kMaxCachedGpRegisters) {
+      continue;
+    }
+    switch (it->set) {
+    case kRegisterSetSpr:
+      *spr_locals[it->index] = c.newGpVar(kX86VarTypeGpq,
+                                          spr_names[it->index]);
+      break;
+    case kRegisterSetCr:
+      xesnprintfa(name, XECOUNT(name), "cr%d", it->index);
+      locals_.cr[it->index] = c.newGpVar(kX86VarTypeGpd, name);
+      break;
+    case kRegisterSetGpr:
+      xesnprintfa(name, XECOUNT(name), "r%d", it->index);
+      locals_.gpr[it->index] = c.newGpVar(kX86VarTypeGpq, name);
+      break;
+    default:
+      XEASSERTALWAYS();
+      break;
     }
-    fpr_t >>= 2;
+    gp_count++;
   }
 }
 
-void X64Emitter::FillRegisters() {
+bool X64Emitter::is_leaf_function() {
+  return !is_spr_written(1);
+}
+
+bool X64Emitter::is_spr_written(uint32_t n) {
+  return ((access_bits_.spr >> (2 * n)) & 0x2) != 0;
+}
+
+bool X64Emitter::is_cr_written(uint32_t n) {
+  return ((access_bits_.cr >> (2 * n)) & 0x2) != 0;
+}
+
+bool X64Emitter::is_gpr_written(uint32_t n) {
+  return ((access_bits_.gpr >> (2 * n)) & 0x2) != 0;
+}
+
+bool X64Emitter::is_fpr_written(uint32_t n) {
+  return ((access_bits_.fpr >> (2 * n)) & 0x2) != 0;
+}
+
+void X64Emitter::FillRegisters(const InstrAccessBits* callee_access) {
   X86Compiler& c = compiler_;
 
   if (!FLAGS_cache_registers) {
@@ -1108,10 +1988,16 @@ void X64Emitter::FillRegisters() {
   // This updates all of the local register values from the state memory.
   // It should be called on function entry for initial setup and after any
   // calls that may modify the registers.
-
-  // TODO(benvanik): use access flags to see if we need to do reads/writes.
-
-  if (locals_.xer.getId() != kInvalidValue) {
+  // Registers that are only written still need filling, as a path that
+  // doesn't write them would otherwise spill garbage.
+  // After a call to a function with a known register summary only the
+  // registers it may write need refilling - the rest are still current.
+  const uint64_t spr_access = callee_access ? callee_access->spr : ~0ull;
+  const uint64_t cr_access = callee_access ? callee_access->cr : ~0ull;
+  const uint64_t gpr_access = callee_access ? callee_access->gpr : ~0ull;
+  const uint64_t fpr_access = callee_access ? callee_access->fpr : ~0ull;
+
+  if (locals_.xer.getId() != kInvalidValue && (spr_access & (0x2 << 0))) {
     if (FLAGS_annotate_disassembly) {
       c.comment("Filling XER");
     }
@@ -1119,7 +2005,7 @@ void X64Emitter::FillRegisters() {
           qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, xer)));
   }
 
-  if (locals_.lr.getId() != kInvalidValue) {
+  if (locals_.lr.getId() != kInvalidValue && (spr_access & (0x2 << 2))) {
     if (FLAGS_annotate_disassembly) {
       c.comment("Filling LR");
     }
@@ -1127,7 +2013,7 @@ void X64Emitter::FillRegisters() {
           qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, lr)));
   }
 
-  if (locals_.ctr.getId() != kInvalidValue) {
+  if (locals_.ctr.getId() != kInvalidValue && (spr_access & (0x2 << 4))) {
     if (FLAGS_annotate_disassembly) {
       c.comment("Filling CTR");
     }
@@ -1142,7 +2028,7 @@ void X64Emitter::FillRegisters() {
   GpVar cr_tmp;
   for (size_t n = 0; n < XECOUNT(locals_.cr); n++) {
     GpVar& cr_n = locals_.cr[n];
-    if (cr_n.getId() == kInvalidValue) {
+    if (cr_n.getId() == kInvalidValue || !((cr_access >> (2 * n)) & 0x2)) {
       continue;
     }
     if (cr.getId() == kInvalidValue) {
@@ -1165,7 +2051,8 @@ void X64Emitter::FillRegisters() {
   }
 
   for (size_t n = 0; n < XECOUNT(locals_.gpr); n++) {
-    if (locals_.gpr[n].getId() != kInvalidValue) {
+    if (locals_.gpr[n].getId() != kInvalidValue &&
+        ((gpr_access >> (2 * n)) & 0x2)) {
       if (FLAGS_annotate_disassembly) {
         c.comment("Filling r%d", n);
       }
@@ -1175,7 +2062,8 @@ void X64Emitter::FillRegisters() {
   }
 
   for (size_t n = 0; n < XECOUNT(locals_.fpr); n++) {
-    if (locals_.fpr[n].getId() != kInvalidValue) {
+    if (locals_.fpr[n].getId() != kInvalidValue &&
+        ((fpr_access >> (2 * n)) & 0x2)) {
       if (FLAGS_annotate_disassembly) {
         c.comment("Filling f%d", n);
       }
@@ -1185,19 +2073,32 @@ void X64Emitter::FillRegisters() {
   }
 }
 
-void X64Emitter::SpillRegisters() {
+void X64Emitter::SpillRegisters(const InstrAccessBits* callee_access) {
   X86Compiler& c = compiler_;
 
+  // Pending CR fields/XER bits live in neither the locals nor the state.
+  FlushPendingCr();
+  FlushPendingXer();
+
   if (!FLAGS_cache_registers) {
     return;
   }
 
-  // This flushes all local registers (if written) to the register bank and
-  // resets their values.
-
-  // TODO(benvanik): only flush if actually required, or selective flushes.
-
-  if (locals_.xer.getId() != kInvalidValue) {
+  // This flushes local registers the function may have modified back to the
+  // register bank. Ones it only reads are still in sync with memory.
+  // Locals remain valid afterwards, so this can be used before exits and
+  // calls alike.
+  // Before a call to a function with a known register summary only the
+  // registers it may read or write need to be in memory. Ones it writes are
+  // refilled after the call (it may not write them on every path), and the
+  // rest stay in the locals until a later spill.
+  const uint64_t spr_access = callee_access ? callee_access->spr : ~0ull;
+  const uint64_t cr_access = callee_access ? callee_access->cr : ~0ull;
+  const uint64_t gpr_access = callee_access ? callee_access->gpr : ~0ull;
+  const uint64_t fpr_access = callee_access ? callee_access->fpr : ~0ull;
+
+  if (locals_.xer.getId() != kInvalidValue && is_spr_written(0) &&
+      (spr_access & (0x3 << 0))) {
     if (FLAGS_annotate_disassembly) {
       c.comment("Spilling XER");
     }
@@ -1205,7 +2106,8 @@ void X64Emitter::SpillRegisters() {
           locals_.xer);
   }
 
-  if (locals_.lr.getId() != kInvalidValue) {
+  if (locals_.lr.getId() != kInvalidValue && is_spr_written(1) &&
+      (spr_access & (0x3 << 2))) {
     if (FLAGS_annotate_disassembly) {
       c.comment("Spilling LR");
     }
@@ -1213,7 +2115,8 @@ void X64Emitter::SpillRegisters() {
           locals_.lr);
   }
 
-  if (locals_.ctr.getId() != kInvalidValue) {
+  if (locals_.ctr.getId() != kInvalidValue && is_spr_written(2) &&
+      (spr_access & (0x3 << 4))) {
     if (FLAGS_annotate_disassembly) {
       c.comment("Spilling CTR");
     }
@@ -1221,41 +2124,41 @@ void X64Emitter::SpillRegisters() {
           locals_.ctr);
   }
 
-  // Stitch together all split CR values.
-  // TODO(benvanik): don't flush across calls?
+  // Merge the written CR fields into the CR. Fields that aren't cached may
+  // have been updated in memory directly, so this must be a
+  // read-modify-write.
   GpVar cr;
   GpVar cr_tmp;
-  for (size_t n = 0; n < XECOUNT(locals_.cr); n++) {
+  for (uint32_t n = 0; n < XECOUNT(locals_.cr); n++) {
     GpVar& cr_n = locals_.cr[n];
-    if (cr_n.getId() == kInvalidValue) {
+    if (cr_n.getId() == kInvalidValue || !is_cr_written(n) ||
+        !((cr_access >> (2 * n)) & 0x3)) {
       continue;
     }
-    if (cr_tmp.getId() == kInvalidValue) {
-      cr_tmp = c.newGpVar();
+    if (cr.getId() == kInvalidValue) {
       if (FLAGS_annotate_disassembly) {
         c.comment("Spilling CR");
       }
-    }
-    // cr |= (cr_n << n * 4)
-    c.mov(cr_tmp, cr_n);
-    if (n) {
-      c.shl(cr_tmp, imm(n * 4));
-    }
-    if (cr.getId() == kInvalidValue) {
       cr = c.newGpVar();
-      c.mov(cr, cr_tmp);
-    } else {
-      c.or_(cr, cr_tmp);
+      cr_tmp = c.newGpVar();
+      c.mov(cr, qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)));
+    }
+    // cr = (cr & ~(0xF << 28 - n * 4)) | (cr_n << 28 - n * 4)
+    c.and_(cr, imm(~(0xF << (28 - n * 4))));
+    c.mov(cr_tmp.r32(), cr_n);
+    if (n < 7) {
+      c.shl(cr_tmp, imm(28 - n * 4));
     }
+    c.or_(cr, cr_tmp);
   }
   if (cr.getId() != kInvalidValue) {
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)),
-          cr);
+    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)), cr);
   }
 
   for (uint32_t n = 0; n < XECOUNT(locals_.gpr); n++) {
     GpVar& v = locals_.gpr[n];
-    if (v.getId() != kInvalidValue) {
+    if (v.getId() != kInvalidValue && is_gpr_written(n) &&
+        ((gpr_access >> (2 * n)) & 0x3)) {
       if (FLAGS_annotate_disassembly) {
         c.comment("Spilling r%d", n);
       }
@@ -1266,7 +2169,8 @@ void X64Emitter::SpillRegisters() {
 
   for (uint32_t n = 0; n < XECOUNT(locals_.fpr); n++) {
     XmmVar& v = locals_.fpr[n];
-    if (v.getId() != kInvalidValue) {
+    if (v.getId() != kInvalidValue && is_fpr_written(n) &&
+        ((fpr_access >> (2 * n)) & 0x3)) {
       if (FLAGS_annotate_disassembly) {
         c.comment("Spilling f%d", n);
       }
@@ -1288,11 +2192,13 @@ bool X64Emitter::get_constant_gpr_value(uint32_t n, uint64_t* value) {
 void X64Emitter::set_constant_gpr_value(uint32_t n, uint64_t value) {
   gpr_values_[n].is_constant = true;
   gpr_values_[n].value = value;
+  gpr_values_set_ |= 1u << n;
 }
 
 void X64Emitter::clear_constant_gpr_value(uint32_t n) {
   gpr_values_[n].is_constant = false;
   gpr_values_[n].value = 0;
+  gpr_values_set_ &= ~(1u << n);
 }
 
 void X64Emitter::clear_all_constant_gpr_values() {
@@ -1300,54 +2206,115 @@ void X64Emitter::clear_all_constant_gpr_values() {
     gpr_values_[n].is_constant = false;
     gpr_values_[n].value = 0;
   }
+  gpr_values_set_ = 0;
 }
 
 GpVar X64Emitter::xer_value() {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.xer.getId() != kInvalidValue);
-    return locals_.xer;
+
+  FlushPendingXer();
+
+  GpVar value(c.newGpVar());
+  if (locals_.xer.getId() != kInvalidValue) {
+    // Hand out a copy so callers are free to modify it.
+    c.mov(value, locals_.xer);
   } else {
-    GpVar value(c.newGpVar());
     c.mov(value,
           qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, xer)));
-    return value;
   }
+  return value;
 }
 
 void X64Emitter::update_xer_value(GpVar& value) {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.xer.getId() != kInvalidValue);
-    c.mov(locals_.xer, zero_extend(value, 0, 8));
-  } else {
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, xer)),
-          zero_extend(value, 0, 8));
+
+  // Replaces any pending bits.
+  pending_xer_.has_ca = false;
+  pending_xer_.has_ov = false;
+
+  GpVar v(zero_extend(value, 0, 8));
+  if (locals_.xer.getId() != kInvalidValue) {
+    c.mov(locals_.xer, v);
+    if (is_spr_written(0)) {
+      return;
+    }
+    // Not expected to be written, so it won't be spilled. Write through.
   }
+  c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, xer)), v);
 }
 
+// Set with a byte value indicating overflow.
 void X64Emitter::update_xer_with_overflow(GpVar& value) {
   X86Compiler& c = compiler_;
-  GpVar xer(c.newGpVar());
-  c.mov(xer, xer_value());
-  c.and_(xer, imm(0xBFFFFFFF)); // clear bit 30
-  c.and_(value, imm(1));
-  c.shl(value, imm(30));
-  c.or_(xer, value);
-  c.shl(value, imm(31)); // also stick value
-  c.or_(xer, value);
-  update_xer_value(xer);
+  // Held in a register like CA below. SO is set when it is merged.
+  pending_xer_.ov = c.newGpVar();
+  c.movzx(pending_xer_.ov, value.r8());
+  pending_xer_.has_ov = true;
 }
 
 // Set with a byte value indicating carry.
 void X64Emitter::update_xer_with_carry(GpVar& value) {
   X86Compiler& c = compiler_;
-  GpVar xer(c.newGpVar());
-  c.mov(xer, xer_value());
-  c.and_(xer, imm(0xDFFFFFFF)); // clear bit 29
-  c.and_(value, imm(1));
-  c.shl(value, imm(29));
-  c.or_(xer, value);
+  // CA is kept in a register instead of being inserted into XER. Carry chains
+  // (addc/adde/...) then pass it from one instruction to the next without
+  // touching the XER and it is only merged back when XER is read or escapes
+  // the block. See FlushPendingXer.
+  pending_xer_.ca = c.newGpVar();
+  c.movzx(pending_xer_.ca, value.r8());
+  pending_xer_.has_ca = true;
+}
+
+// Gets CA as 0 or 1.
+GpVar X64Emitter::ca_value() {
+  X86Compiler& c = compiler_;
+  GpVar value(c.newGpVar());
+  if (pending_xer_.has_ca) {
+    c.mov(value, pending_xer_.ca);
+  } else {
+    c.mov(value, xer_value());
+    c.shr(value, imm(29));
+    c.and_(value, imm(1));
+  }
+  return value;
+}
+
+void X64Emitter::FlushPendingXer(bool block_exit) {
+  X86Compiler& c = compiler_;
+
+  if (!pending_xer_.has_ca && !pending_xer_.has_ov) {
+    return;
+  }
+  const bool has_ca = pending_xer_.has_ca;
+  const bool has_ov = pending_xer_.has_ov;
+  pending_xer_.has_ca = false;
+  pending_xer_.has_ov = false;
+
+  if (block_exit) {
+    // Only needed if some later block may read XER.
+    std::map<uint32_t, uint16_t>::iterator it =
+        block_flags_live_out_.find(fn_block_->start_address);
+    if (it != block_flags_live_out_.end() && !(it->second & kLiveXer)) {
+      return;
+    }
+  }
+
+  GpVar xer(xer_value());
+  if (has_ca) {
+    GpVar ca(c.newGpVar());
+    c.mov(ca, pending_xer_.ca);
+    c.and_(xer, imm(0xDFFFFFFF)); // clear bit 29
+    c.shl(ca, imm(29));
+    c.or_(xer, ca);
+  }
+  if (has_ov) {
+    GpVar ov(c.newGpVar());
+    c.mov(ov, pending_xer_.ov);
+    c.and_(xer, imm(0xBFFFFFFF)); // clear bit 30
+    c.shl(ov, imm(30));
+    c.or_(xer, ov);
+    c.shl(ov, imm(1)); // also stick value
+    c.or_(xer, ov);
+  }
   update_xer_value(xer);
 }
 
@@ -1374,69 +2341,77 @@ void X64Emitter::update_xer_with_overflow_and_carry(GpVar& value) {
 
 GpVar X64Emitter::lr_value() {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.lr.getId() != kInvalidValue);
-    return locals_.lr;
+  GpVar value(c.newGpVar());
+  if (locals_.lr.getId() != kInvalidValue) {
+    // Hand out a copy so callers are free to modify it.
+    c.mov(value, locals_.lr);
   } else {
-    GpVar value(c.newGpVar());
     c.mov(value,
           qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, lr)));
-    return value;
   }
+  return value;
 }
 
 void X64Emitter::update_lr_value(GpVar& value) {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.lr.getId() != kInvalidValue);
-    c.mov(locals_.lr, zero_extend(value, 0, 8));
-  } else {
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, lr)),
-          zero_extend(value, 0, 8));
+  GpVar v(zero_extend(value, 0, 8));
+  if (locals_.lr.getId() != kInvalidValue) {
+    c.mov(locals_.lr, v);
+    if (is_spr_written(1)) {
+      return;
+    }
+    // Not expected to be written, so it won't be spilled. Write through.
   }
+  c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, lr)), v);
 }
 
 void X64Emitter::update_lr_value(AsmJit::Imm& imm) {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.lr.getId() != kInvalidValue);
+  if (locals_.lr.getId() != kInvalidValue) {
     c.mov(locals_.lr, imm);
-  } else {
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, lr)),
-          imm);
+    if (is_spr_written(1)) {
+      return;
+    }
   }
+  c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, lr)), imm);
 }
 
 GpVar X64Emitter::ctr_value() {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.ctr.getId() != kInvalidValue);
-    return locals_.ctr;
+  GpVar value(c.newGpVar());
+  if (locals_.ctr.getId() != kInvalidValue) {
+    // Hand out a copy so callers are free to modify it.
+    c.mov(value, locals_.ctr);
   } else {
-    GpVar value(c.newGpVar());
     c.mov(value,
           qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, ctr)));
-    return value;
   }
+  return value;
 }
 
 void X64Emitter::update_ctr_value(GpVar& value) {
   X86Compiler& c = compiler_;
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.ctr.getId() != kInvalidValue);
-    c.mov(locals_.ctr, zero_extend(value, 0, 8));
-  } else {
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, ctr)),
-          zero_extend(value, 0, 8));
+  GpVar v(zero_extend(value, 0, 8));
+  if (locals_.ctr.getId() != kInvalidValue) {
+    c.mov(locals_.ctr, v);
+    if (is_spr_written(2)) {
+      return;
+    }
+    // Not expected to be written, so it won't be spilled. Write through.
   }
+  c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, ctr)), v);
 }
 
 GpVar X64Emitter::cr_value(uint32_t n) {
   X86Compiler& c = compiler_;
   XEASSERT(n >= 0 && n < 8);
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.cr[n].getId() != kInvalidValue);
-    return locals_.cr[n];
+
+  FlushPendingCr();
+
+  if (locals_.cr[n].getId() != kInvalidValue) {
+    GpVar value(c.newGpVar());
+    c.mov(value.r32(), locals_.cr[n]);
+    return value;
   } else {
     // TODO(benvanik): this can most definitely be made more efficient.
     GpVar value(c.newGpVar());
@@ -1453,73 +2428,107 @@ GpVar X64Emitter::cr_value(uint32_t n) {
 void X64Emitter::update_cr_value(uint32_t n, GpVar& value) {
   X86Compiler& c = compiler_;
   XEASSERT(n >= 0 && n < 8);
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.cr[n].getId() != kInvalidValue);
-    c.mov(locals_.cr[n], trunc(value, 1));
+
+  if (pending_cr_.is_pending && pending_cr_.n == n) {
+    // Overwritten before anyone looked at it.
+    pending_cr_.is_pending = false;
   } else {
-    // TODO(benvanik): this can most definitely be made more efficient.
-    GpVar cr_tmp(c.newGpVar());
-    c.mov(cr_tmp, qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)));
-    GpVar cr_n(c.newGpVar());
-    c.mov(cr_n, value);
-    c.and_(cr_n, imm(0xF));
-    if (n < 7) {
-      c.shl(cr_n, imm(28 - n * 4));
+    FlushPendingCr();
+  }
+
+  if (locals_.cr[n].getId() != kInvalidValue) {
+    c.mov(locals_.cr[n], value.r32());
+    c.and_(locals_.cr[n], imm(0xF));
+    if (is_cr_written(n)) {
+      return;
     }
-    c.and_(cr_tmp, imm(~(0xF << (28 - n * 4))));
-    c.or_(cr_tmp, cr_n);
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)), cr_tmp);
+    // Not expected to be written, so it won't be spilled. Write through.
+  }
+
+  // TODO(benvanik): this can most definitely be made more efficient.
+  GpVar cr_tmp(c.newGpVar());
+  c.mov(cr_tmp, qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)));
+  GpVar cr_n(c.newGpVar());
+  c.mov(cr_n, value);
+  c.and_(cr_n, imm(0xF));
+  if (n < 7) {
+    c.shl(cr_n, imm(28 - n * 4));
   }
+  c.and_(cr_tmp, imm(~(0xF << (28 - n * 4))));
+  c.or_(cr_tmp, cr_n);
+  c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, cr)), cr_tmp);
 }
 
 void X64Emitter::update_cr_with_cond(uint32_t n, GpVar& lhs, bool is_signed) {
   X86Compiler& c = compiler_;
-  // bit0 = RA < 0
-  // bit1 = RA > 0
-  // bit2 = RA = 0
-  // bit3 = XER[SO]
-
-  // Compare and set bits.
-  GpVar v_l(c.newGpVar());
-  GpVar v_g(c.newGpVar());
-  GpVar v_e(c.newGpVar());
-  c.cmp(lhs, imm(0));
-  if (is_signed) {
-    c.setl(v_l.r8());
-    c.setg(v_g.r8());
-  } else {
-    c.setb(v_l.r8());
-    c.seta(v_g.r8());
-  }
-  c.sete(v_e.r8());
-  GpVar v(c.newGpVar());
-  c.shl(v_g, imm(1));
-  c.shl(v_e, imm(2));
-  c.mov(v, v_l.r8());
-  c.or_(v, v_g.r8());
-  c.or_(v, v_e.r8());
-
-  // TODO(benvanik): set bit 4 to XER[SO]
-  // c.seto?
+  XEASSERT(n >= 0 && n < 8);
 
-  // Insert the 4 bits into their location in the CR.
-  update_cr_value(n, v);
+  // The field is not built here. Most are consumed by the branch that follows
+  // or never read at all, so only the compare operands are kept and the field
+  // is written when something observes it or it leaves the block.
+  // See FlushPendingCr/JumpOnCrBit.
+  if (pending_cr_.is_pending && pending_cr_.n != n) {
+    FlushPendingCr();
+  }
+  pending_cr_.is_pending = true;
+  pending_cr_.n = n;
+  pending_cr_.is_signed = is_signed;
+  pending_cr_.lhs = c.newGpVar();
+  c.mov(pending_cr_.lhs, lhs);
+  pending_cr_.rhs = GpVar();
 }
 
 void X64Emitter::update_cr_with_cond(uint32_t n, GpVar& lhs, GpVar& rhs,
                                      bool is_signed) {
   X86Compiler& c = compiler_;
-  // bit0 = RA < RB
-  // bit1 = RA > RB
-  // bit2 = RA = RB
+  XEASSERT(n >= 0 && n < 8);
+
+  // See above.
+  if (pending_cr_.is_pending && pending_cr_.n != n) {
+    FlushPendingCr();
+  }
+  pending_cr_.is_pending = true;
+  pending_cr_.n = n;
+  pending_cr_.is_signed = is_signed;
+  pending_cr_.lhs = c.newGpVar();
+  c.mov(pending_cr_.lhs, lhs);
+  pending_cr_.rhs = c.newGpVar();
+  c.mov(pending_cr_.rhs, rhs);
+}
+
+void X64Emitter::FlushPendingCr(bool block_exit) {
+  X86Compiler& c = compiler_;
+
+  if (!pending_cr_.is_pending) {
+    return;
+  }
+  pending_cr_.is_pending = false;
+
+  if (block_exit) {
+    // Only needed if some later block may read the field before writing it.
+    std::map<uint32_t, uint16_t>::iterator it =
+        block_flags_live_out_.find(fn_block_->start_address);
+    if (it != block_flags_live_out_.end() &&
+        !(it->second & (1 << pending_cr_.n))) {
+      return;
+    }
+  }
+
+  // bit0 = lhs < rhs
+  // bit1 = lhs > rhs
+  // bit2 = lhs = rhs
   // bit3 = XER[SO]
 
   // Compare and set bits.
   GpVar v_l(c.newGpVar());
   GpVar v_g(c.newGpVar());
   GpVar v_e(c.newGpVar());
-  c.cmp(lhs, rhs);
-  if (is_signed) {
+  if (pending_cr_.rhs.getId() != kInvalidValue) {
+    c.cmp(pending_cr_.lhs, pending_cr_.rhs);
+  } else {
+    c.cmp(pending_cr_.lhs, imm(0));
+  }
+  if (pending_cr_.is_signed) {
     c.setl(v_l.r8());
     c.setg(v_g.r8());
   } else {
@@ -1538,7 +2547,91 @@ void X64Emitter::update_cr_with_cond(uint32_t n, GpVar& lhs, GpVar& rhs,
   // c.seto?
 
   // Insert the 4 bits into their location in the CR.
-  update_cr_value(n, v);
+  update_cr_value(pending_cr_.n, v);
+}
+
+void X64Emitter::JumpOnCrBit(uint32_t bi, bool is_set, Label& label,
+                             uint32_t hint) {
+  X86Compiler& c = compiler_;
+  const uint32_t n = bi >> 2;
+  const uint32_t bit = bi & 3;
+
+  if (!pending_cr_.is_pending || pending_cr_.n != n) {
+    // Already built (or from elsewhere), so test the bit.
+    // This is only used by branches, which end the block.
+    FlushPendingCr(true);
+    GpVar cr(cr_value(n));
+    c.test(cr, imm(1 << bit));
+    if (is_set) {
+      c.jnz(label, hint);
+    } else {
+      c.jz(label, hint);
+    }
+    return;
+  }
+
+  // Fuse the compare with the branch. The field is still written back if a
+  // later block needs it.
+  GpVar lhs = pending_cr_.lhs;
+  GpVar rhs = pending_cr_.rhs;
+  bool is_signed = pending_cr_.is_signed;
+  FlushPendingCr(true);
+
+  if (bit == 3) {
+    // SO is never set (see FlushPendingCr).
+    if (!is_set) {
+      c.jmp(label);
+    }
+    return;
+  }
+
+  if (rhs.getId() != kInvalidValue) {
+    c.cmp(lhs, rhs);
+  } else {
+    c.cmp(lhs, imm(0));
+  }
+  switch (bit) {
+  case 0:
+    // lt
+    if (is_signed) {
+      if (is_set) {
+        c.jl(label, hint);
+      } else {
+        c.jge(label, hint);
+      }
+    } else {
+      if (is_set) {
+        c.jb(label, hint);
+      } else {
+        c.jae(label, hint);
+      }
+    }
+    break;
+  case 1:
+    // gt
+    if (is_signed) {
+      if (is_set) {
+        c.jg(label, hint);
+      } else {
+        c.jle(label, hint);
+      }
+    } else {
+      if (is_set) {
+        c.ja(label, hint);
+      } else {
+        c.jbe(label, hint);
+      }
+    }
+    break;
+  case 2:
+    // eq
+    if (is_set) {
+      c.je(label, hint);
+    } else {
+      c.jne(label, hint);
+    }
+    break;
+  }
 }
 
 GpVar X64Emitter::gpr_value(uint32_t n) {
@@ -1551,15 +2644,20 @@ GpVar X64Emitter::gpr_value(uint32_t n) {
   //   return get_uint64(0);
   // }
 
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.gpr[n].getId() != kInvalidValue);
-    return locals_.gpr[n];
+  // Known constants are materialized as immediates instead of being read.
+  if (gpr_values_[n].is_constant) {
+    return get_uint64(gpr_values_[n].value);
+  }
+
+  GpVar value(c.newGpVar());
+  if (locals_.gpr[n].getId() != kInvalidValue) {
+    // Hand out a copy so callers are free to modify it.
+    c.mov(value, locals_.gpr[n]);
   } else {
-    GpVar value(c.newGpVar());
     c.mov(value,
           qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, r) + 8 * n));
-    return value;
   }
+  return value;
 }
 
 void X64Emitter::update_gpr_value(uint32_t n, GpVar& value) {
@@ -1571,72 +2669,109 @@ void X64Emitter::update_gpr_value(uint32_t n, GpVar& value) {
   //   return;
   // }
 
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.gpr[n].getId() != kInvalidValue);
-    c.mov(locals_.gpr[n], zero_extend(value, 0, 8));
-  } else {
-    c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, r) + 8 * n),
-          zero_extend(value, 0, 8));
+  GpVar v(zero_extend(value, 0, 8));
+  if (locals_.gpr[n].getId() != kInvalidValue) {
+    c.mov(locals_.gpr[n], v);
+    if (is_gpr_written(n)) {
+      return;
+    }
+    // Not expected to be written, so it won't be spilled. Write through.
   }
+  c.mov(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, r) + 8 * n), v);
 }
 
 XmmVar X64Emitter::fpr_value(uint32_t n) {
   X86Compiler& c = compiler_;
   XEASSERT(n >= 0 && n < 32);
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.fpr[n].getId() != kInvalidValue);
-    return locals_.fpr[n];
+  XmmVar value(c.newXmmVar());
+  if (locals_.fpr[n].getId() != kInvalidValue) {
+    // Hand out a copy so callers are free to modify it.
+    c.movq(value, locals_.fpr[n]);
   } else {
-    XmmVar value(c.newXmmVar());
     c.movq(value,
            qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, f) + 8 * n));
-    return value;
   }
+  return value;
 }
 
 void X64Emitter::update_fpr_value(uint32_t n, XmmVar& value) {
   X86Compiler& c = compiler_;
   XEASSERT(n >= 0 && n < 32);
-  if (FLAGS_cache_registers) {
-    XEASSERT(locals_.fpr[n].getId() != kInvalidValue);
+  if (locals_.fpr[n].getId() != kInvalidValue) {
     c.movq(locals_.fpr[n], value);
-  } else {
-    c.movq(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, f) + 8 * n),
-           value);
+    if (is_fpr_written(n)) {
+      return;
+    }
+    // Not expected to be written, so it won't be spilled. Write through.
   }
+  c.movq(qword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, f) + 8 * n),
+         value);
 }
 
-GpVar X64Emitter::TouchMemoryAddress(uint32_t cia, GpVar& addr) {
+XmmVar X64Emitter::vr_value(uint32_t n) {
   X86Compiler& c = compiler_;
+  XEASSERT(n >= 0 && n < 128);
+  // Vector registers are kept in the context as four host-endian words.
+  // The context is only 8b aligned so the access must be unaligned.
+  XmmVar value(c.newXmmVar());
+  c.movdqu(value,
+           dqword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, v) + 16 * n));
+  return value;
+}
 
-  // Input address is always in 32-bit space.
-  GpVar real_address(c.newGpVar());
-  c.mov(real_address.r32(), addr.r32());
+void X64Emitter::update_vr_value(uint32_t n, XmmVar& value) {
+  X86Compiler& c = compiler_;
+  XEASSERT(n >= 0 && n < 128);
+  c.movdqu(dqword_ptr(c.getGpArg(0), offsetof(xe_ppc_state_t, v) + 16 * n),
+           value);
+}
+
+GpVar X64Emitter::vector_constants() {
+  return get_uint64((uint64_t)X64GetVectorConstants());
+}
 
-  // Add runtime memory address checks, if needed.
-  if (FLAGS_memory_address_verification) {
-  //   BasicBlock* invalid_bb = BasicBlock::Create(*context_, "", fn_);
-  //   BasicBlock* valid_bb = BasicBlock::Create(*context_, "", fn_);
+GpVar X64Emitter::membase_value() {
+  X86Compiler& c = compiler_;
+  if (locals_.membase.getId() != kInvalidValue) {
+    return locals_.membase;
+  }
+  // Outside of user functions. Materialize it on demand.
+  GpVar value(c.newGpVar());
+  c.mov(value, imm((uint64_t)xe_memory_addr(memory_, 0)));
+  return value;
+}
 
-  //   // The heap starts at 0x1000 - if we write below that we're boned.
-  //   jit_value_t gt = b.CreateICmpUGE(addr, b.getInt64(0x00001000));
-  //   b.CreateCondBr(gt, valid_bb, invalid_bb);
+GpVar X64Emitter::GuestMemoryIndex(uint32_t cia, GpVar& addr) {
+  X86Compiler& c = compiler_;
 
-  //   b.SetInsertPoint(invalid_bb);
-  //   jit_value_t access_violation = gen_module_->getFunction("XeAccessViolation");
-  //   SpillRegisters();
-  //   b.CreateCall3(access_violation,
-  //                 fn_->arg_begin(),
-  //                 b.getInt32(cia),
-  //                 addr);
-  //   b.CreateBr(valid_bb);
+  // Input address is always in 32-bit space. Writing the 32-bit half zero
+  // extends, giving the offset from membase.
+  GpVar index(c.newGpVar());
+  c.mov(index.r32(), addr.r32());
 
-  //   b.SetInsertPoint(valid_bb);
+  // There are no inline checks. Invalid addresses land on pages that aren't
+  // accessible and fault in the host, so just note where this instruction's
+  // access starts for X64JIT::LookupAccessFault to find it.
+  if (FLAGS_memory_address_verification &&
+      (!access_labels_.size() || access_labels_.back().cia != cia)) {
+    AccessLabel access_label;
+    access_label.label = c.newLabel();
+    access_label.cia = cia;
+    c.bind(access_label.label);
+    access_labels_.push_back(access_label);
   }
 
-  // Rebase off of memory pointer.
-  uint64_t membase = (uint64_t)xe_memory_addr(memory_, 0);
-  c.add(real_address, get_uint64(membase));
+  return index;
+}
+
+GpVar X64Emitter::TouchMemoryAddress(uint32_t cia, GpVar& addr) {
+  X86Compiler& c = compiler_;
+
+  // Host pointer for callers that need one (vector accesses/etc).
+  // Plain loads/stores use the index directly in their operands instead.
+  GpVar index(GuestMemoryIndex(cia, addr));
+  GpVar real_address(c.newGpVar());
+  c.lea(real_address, ptr(membase_value(), index, kScale1Times, 0));
   return real_address;
 }
 
@@ -1644,8 +2779,9 @@ GpVar X64Emitter::ReadMemory(
     uint32_t cia, GpVar& addr, uint32_t size, bool acquire) {
   X86Compiler& c = compiler_;
 
-  // Rebase off of memory base pointer.
-  GpVar real_address = TouchMemoryAddress(cia, addr);
+  // Accesses are a single [membase + index] operand.
+  GpVar membase(membase_value());
+  GpVar index(GuestMemoryIndex(cia, addr));
 
   if (acquire) {
     // TODO(benvanik): acquire semantics.
@@ -1655,26 +2791,41 @@ GpVar X64Emitter::ReadMemory(
     XELOGE("Ignoring acquire semantics on read -- TODO");
   }
 
+  // movbe loads and swaps in one instruction. Without it the value is loaded
+  // and then swapped in the register.
+  const bool use_movbe = (cpu_features_ & kX64CpuFeatureMovbe) != 0;
+
   GpVar value(c.newGpVar());
-  bool needs_swap = false;
   switch (size) {
     case 1:
-      c.mov(value.r8(), byte_ptr(real_address));
-      c.and_(value, imm(0xFF));
+      c.movzx(value, byte_ptr(membase, index, kScale1Times, 0));
       break;
     case 2:
-      c.mov(value.r16(), word_ptr(real_address));
-      c.and_(value, imm(0xFFFF));
-      c.xchg(value.r8Lo(), value.r8Hi());
+      if (use_movbe) {
+        // movbe r16 leaves the upper bits alone.
+        c.movbe(value.r16(), word_ptr(membase, index, kScale1Times, 0));
+        c.movzx(value, value.r16());
+      } else {
+        c.movzx(value, word_ptr(membase, index, kScale1Times, 0));
+        c.ror(value.r16(), imm(8));
+      }
       break;
     case 4:
-      c.mov(value.r32(), dword_ptr(real_address));
       // No need to and -- the mov to e*x will extend for us.
-      c.bswap(value.r32());
+      if (use_movbe) {
+        c.movbe(value.r32(), dword_ptr(membase, index, kScale1Times, 0));
+      } else {
+        c.mov(value.r32(), dword_ptr(membase, index, kScale1Times, 0));
+        c.bswap(value.r32());
+      }
       break;
     case 8:
-      c.mov(value, qword_ptr(real_address));
-      c.bswap(value.r64());
+      if (use_movbe) {
+        c.movbe(value, qword_ptr(membase, index, kScale1Times, 0));
+      } else {
+        c.mov(value, qword_ptr(membase, index, kScale1Times, 0));
+        c.bswap(value.r64());
+      }
       break;
     default:
       XEASSERTALWAYS();
@@ -1690,31 +2841,48 @@ void X64Emitter::WriteMemory(
     bool release) {
   X86Compiler& c = compiler_;
 
-  // Rebase off of memory base pointer.
-  GpVar real_address = TouchMemoryAddress(cia, addr);
+  // Accesses are a single [membase + index] operand.
+  GpVar membase(membase_value());
+  GpVar index(GuestMemoryIndex(cia, addr));
+
+  // movbe stores straight from the value register. Without it the value is
+  // swapped in a temporary first so that the source is left untouched.
+  const bool use_movbe = (cpu_features_ & kX64CpuFeatureMovbe) != 0;
 
   GpVar tmp;
   switch (size) {
     case 1:
-      c.mov(byte_ptr(real_address), value.r8());
+      c.mov(byte_ptr(membase, index, kScale1Times, 0), value.r8());
       break;
     case 2:
+      if (use_movbe) {
+        c.movbe(word_ptr(membase, index, kScale1Times, 0), value.r16());
+        break;
+      }
       tmp = c.newGpVar();
       c.mov(tmp, value);
-      c.xchg(tmp.r8Lo(), tmp.r8Hi());
-      c.mov(word_ptr(real_address), tmp.r16());
+      c.ror(tmp.r16(), imm(8));
+      c.mov(word_ptr(membase, index, kScale1Times, 0), tmp.r16());
       break;
     case 4:
+      if (use_movbe) {
+        c.movbe(dword_ptr(membase, index, kScale1Times, 0), value.r32());
+        break;
+      }
       tmp = c.newGpVar();
       c.mov(tmp, value);
       c.bswap(tmp.r32());
-      c.mov(dword_ptr(real_address), tmp.r32());
+      c.mov(dword_ptr(membase, index, kScale1Times, 0), tmp.r32());
       break;
     case 8:
+      if (use_movbe) {
+        c.movbe(qword_ptr(membase, index, kScale1Times, 0), value.r64());
+        break;
+      }
       tmp = c.newGpVar();
       c.mov(tmp, value);
       c.bswap(tmp.r64());
-      c.mov(qword_ptr(real_address), tmp.r64());
+      c.mov(qword_ptr(membase, index, kScale1Times, 0), tmp.r64());
       break;
     default:
       XEASSERTALWAYS();
@@ -13,6 +13,8 @@
 #include <xenia/cpu/global_exports.h>
 #include <xenia/cpu/sdb.h>
 #include <xenia/cpu/ppc/instr.h>
+#include <xenia/cpu/x64/x64_code_cache.h>
+#include <xenia/cpu/x64/x64_hle.h>
 
 #include <asmjit/asmjit.h>
 
@@ -22,22 +24,37 @@ namespace cpu {
 namespace x64 {
 
 
+class X64JIT;
+
+
 // Typedef for all generated functions.
 typedef void (*x64_function_t)(xe_ppc_state_t* ppc_state, uint64_t lr);
 
+// Start of the host code for a guest instruction that accesses memory.
+// Used to map host faults back to the guest instruction.
+typedef struct {
+  uint32_t  host_offset;
+  uint32_t  cia;
+} X64AccessSite;
+
 
 class X64Emitter {
 public:
-  X64Emitter(xe_memory_ref memory);
+  X64Emitter(X64JIT* jit, xe_memory_ref memory);
   ~X64Emitter();
 
   void SetupGpuPointers(void* gpu_this, void* gpu_read, void* gpu_write);
 
   void Lock();
+  bool TryLock();
   void Unlock();
 
   int PrepareFunction(sdb::FunctionSymbol* symbol);
   int MakeFunction(sdb::FunctionSymbol* symbol);
+  void* OnDemandCompile(sdb::FunctionSymbol* symbol);
+
+  static uint32_t GetConfigHash(uint32_t cpu_features);
+  int ResolveFixupValue(uint32_t type, uint32_t key, uint64_t* out_value);
 
   AsmJit::X86Compiler& compiler();
   sdb::FunctionSymbol* symbol();
@@ -47,6 +64,10 @@ public:
   AsmJit::Label& GetBlockLabel(uint32_t address);
   int CallFunction(sdb::FunctionSymbol* target_symbol, AsmJit::GpVar& lr,
                    bool tail);
+  // Calls to the __savegprlr_*/__restgprlr_*/etc helpers are emitted as the
+  // helper body up to its blr instead.
+  bool IsInlinedFunction(sdb::FunctionSymbol* target_symbol);
+  void InlineFunction(sdb::FunctionSymbol* target_symbol);
 
   void TraceKernelCall();
   void TraceUserCall();
@@ -56,12 +77,19 @@ public:
 
   int GenerateIndirectionBranch(uint32_t cia, AsmJit::GpVar& target,
                                 bool lk, bool likely_local);
+  AsmJit::GpVar LookupFunctionPointer(uint32_t site_cia, AsmJit::GpVar& target,
+                                      AsmJit::GpVar& cia);
 
   AsmJit::GpVar read_gpu_register(uint32_t r);
   void write_gpu_register(uint32_t r, AsmJit::GpVar& v);
 
-  void FillRegisters();
-  void SpillRegisters();
+  // Both take the register summary of a function being called, if known, to
+  // only touch the registers the callee can observe or change.
+  void FillRegisters(const ppc::InstrAccessBits* callee_access = NULL);
+  void SpillRegisters(const ppc::InstrAccessBits* callee_access = NULL);
+  // Whether the function never changes LR, so blr can only return to the
+  // caller. This includes every function that makes no calls.
+  bool is_leaf_function();
 
   bool get_constant_gpr_value(uint32_t n, uint64_t* value);
   void set_constant_gpr_value(uint32_t n, uint64_t value);
@@ -73,6 +101,8 @@ public:
   void update_xer_with_overflow(AsmJit::GpVar& value);
   void update_xer_with_carry(AsmJit::GpVar& value);
   void update_xer_with_overflow_and_carry(AsmJit::GpVar& value);
+  AsmJit::GpVar ca_value();
+  void FlushPendingXer(bool block_exit = false);
 
   AsmJit::GpVar lr_value();
   void update_lr_value(AsmJit::GpVar& value);
@@ -87,12 +117,19 @@ public:
                            bool is_signed = true);
   void update_cr_with_cond(uint32_t n, AsmJit::GpVar& lhs, AsmJit::GpVar& rhs,
                            bool is_signed = true);
+  void FlushPendingCr(bool block_exit = false);
+  void JumpOnCrBit(uint32_t bi, bool is_set, AsmJit::Label& label,
+                   uint32_t hint = AsmJit::kCondHintNone);
 
   AsmJit::GpVar gpr_value(uint32_t n);
   void update_gpr_value(uint32_t n, AsmJit::GpVar& value);
   AsmJit::XmmVar fpr_value(uint32_t n);
   void update_fpr_value(uint32_t n, AsmJit::XmmVar& value);
+  AsmJit::XmmVar vr_value(uint32_t n);
+  void update_vr_value(uint32_t n, AsmJit::XmmVar& value);
+  AsmJit::GpVar vector_constants();
 
+  AsmJit::GpVar membase_value();
   AsmJit::GpVar TouchMemoryAddress(uint32_t cia, AsmJit::GpVar& addr);
   AsmJit::GpVar ReadMemory(
       uint32_t cia, AsmJit::GpVar& addr, uint32_t size, bool acquire = false);
@@ -106,19 +143,45 @@ public:
   AsmJit::GpVar trunc(AsmJit::GpVar& value, int size);
 
 private:
-  static void* OnDemandCompileTrampoline(
-      X64Emitter* emitter, sdb::FunctionSymbol* symbol);
-  void* OnDemandCompile(sdb::FunctionSymbol* symbol);
+  typedef struct {
+    bool      is_constant;
+    uint64_t  value;
+  } ConstantValue;
+  typedef struct {
+    ConstantValue gpr[32];
+  } ConstantState;
+
   int MakeUserFunction();
   int MakePresentImportFunction();
   int MakeMissingImportFunction();
+  int MakeHleFunction(x64_hle_function_t hle_function);
 
   void GenerateSharedBlocks();
+  void GenerateJumpTableSearch(std::vector<uint32_t>& targets,
+                               size_t begin, size_t end);
+  uint32_t GetBlockWeight(sdb::FunctionBlock* block);
   int PrepareBasicBlock(sdb::FunctionBlock* block);
+  int PrepareInstructions(uint32_t start_address, uint32_t end_address,
+                          uint32_t weight, ppc::InstrAccessBits& access_bits);
+  void PropagateConstants();
+  void UpdateConstantState(ppc::InstrData& i, ppc::InstrDisasm& d,
+                           ConstantState& state);
+  bool MergeConstantState(uint32_t address, ConstantState& state);
+  void ComputeFlagLiveness();
   void GenerateBasicBlock(sdb::FunctionBlock* block);
+  void GenerateInstruction(ppc::InstrData& i);
+  uint32_t GetInlineEndAddress(sdb::FunctionSymbol* target_symbol);
   void SetupLocals();
-
+  bool is_spr_written(uint32_t n);
+  bool is_cr_written(uint32_t n);
+  bool is_gpr_written(uint32_t n);
+  bool is_fpr_written(uint32_t n);
+  void RecordFixupValue(const void* value, X64FixupType type, uint32_t key);
+  AsmJit::GpVar GuestMemoryIndex(uint32_t cia, AsmJit::GpVar& addr);
+
+  X64JIT*               jit_;
   xe_memory_ref         memory_;
+  uint32_t              cpu_features_;  // X64CpuFeature bits
   GlobalExports         global_exports_;
   xe_mutex_t*           lock_;
 
@@ -138,15 +201,58 @@ private:
 
   std::map<uint32_t, AsmJit::Label> bbs_;
 
+  std::vector<X64FixupValue> fixup_values_;
+
+  // Labels bound before each guest memory access, resolved to host offsets
+  // once the function is assembled. See GuestMemoryIndex.
+  typedef struct {
+    AsmJit::Label   label;
+    uint32_t        cia;
+  } AccessLabel;
+  std::vector<AccessLabel> access_labels_;
+
   ppc::InstrAccessBits  access_bits_;
+  // Access counts for each guest register, weighted by loop nesting.
+  // SetupLocals gives host registers to the hottest ones.
   struct {
-    bool      is_constant;
-    uint64_t  value;
-  } gpr_values_[32];
+    uint32_t  spr[3];   // xer/lr/ctr
+    uint32_t  cr[8];
+    uint32_t  gpr[32];
+    uint32_t  fpr[32];
+  } access_counts_;
+  ConstantValue         gpr_values_[32];
+  // GPRs given a constant value by the instruction being emitted.
+  uint32_t              gpr_values_set_;
+  // Constant GPR values known on entry to each block, as computed by
+  // PropagateConstants. Blocks not present have nothing known.
+  std::map<uint32_t, ConstantState> block_constants_;
+  // CR fields (bit n = field n) and XER (bit 8) that may be read after each
+  // block exits.
+  std::map<uint32_t, uint16_t> block_flags_live_out_;
+  // A CR field that has not been built yet and is only known as the operands
+  // of the compare that produces it. See update_cr_with_cond.
+  struct {
+    bool            is_pending;
+    uint32_t        n;
+    bool            is_signed;
+    AsmJit::GpVar   lhs;
+    AsmJit::GpVar   rhs;    // invalid when comparing against 0
+  } pending_cr_;
+  // XER bits that are held in registers and not yet merged into XER.
+  // See update_xer_with_carry.
+  struct {
+    bool            has_ca;
+    bool            has_ov;
+    AsmJit::GpVar   ca;     // 0 or 1
+    AsmJit::GpVar   ov;     // 0 or 1
+  } pending_xer_;
   struct {
     AsmJit::GpVar   indirection_target;
     AsmJit::GpVar   indirection_cia;
 
+    // Guest memory base, loaded once on entry.
+    AsmJit::GpVar   membase;
+
     AsmJit::GpVar   xer;
     AsmJit::GpVar   lr;
     AsmJit::GpVar   ctr;
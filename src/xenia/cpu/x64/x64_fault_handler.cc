@@ -0,0 +1,230 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/x64/x64_fault_handler.h>
+
+#include <xenia/cpu/x64/x64_jit.h>
+
+#if !XE_LIKE(WIN32)
+#include <signal.h>
+#include <ucontext.h>
+#endif  // !WIN32
+
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::x64;
+
+
+namespace {
+
+XETHREADLOCAL xe_ppc_state_t* thread_ppc_state_ = NULL;
+
+// The fault being reported on this thread, filled in by the handler.
+XETHREADLOCAL X64AccessFault thread_fault_;
+
+// Guards installation. Allocated by the first install, never freed as the
+// handler may still run while the process shuts down.
+xe_mutex_t* volatile lock_ = NULL;
+
+// Registered JITs. Only changed under lock_, but read by the handler without
+// it, so slots are updated with single pointer stores.
+const size_t kMaxJits = 16;
+X64JIT* volatile jits_[kMaxJits] = { NULL };
+size_t jit_count_ = 0;
+
+// Called in the handler, so this must stay async-signal-safe.
+bool ClaimFault(void* host_pc, void* host_address) {
+  for (size_t n = 0; n < kMaxJits; n++) {
+    X64JIT* jit = jits_[n];
+    if (jit && jit->LookupAccessFault(host_pc, host_address, &thread_fault_)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Where a claimed fault resumes, on the faulting thread and stack but outside
+// of the handler. The access can't be completed and the frame we were entered
+// with isn't real, so this never returns.
+void AccessFaultThunk() {
+  X64JIT::ReportAccessFault(thread_fault_);
+  XEASSERTALWAYS();
+  abort();
+}
+
+// Makes the interrupted context call AccessFaultThunk. The new frame goes below
+// the red zone, aligned as if it had been called, with a null return address.
+uint64_t RedirectToThunk(uint64_t rsp) {
+  rsp = ((rsp - 128) & ~15ull) - 8;
+  *(uint64_t*)rsp = 0;
+  return rsp;
+}
+
+#if XE_LIKE(WIN32)
+
+PVOID vectored_handler_ = NULL;
+
+LONG CALLBACK FaultExceptionHandler(PEXCEPTION_POINTERS ex_info) {
+  if (ex_info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION) {
+    return EXCEPTION_CONTINUE_SEARCH;
+  }
+  PCONTEXT context = ex_info->ContextRecord;
+  void* host_pc = (void*)context->Rip;
+  void* host_address =
+      (void*)ex_info->ExceptionRecord->ExceptionInformation[1];
+  if (!ClaimFault(host_pc, host_address)) {
+    return EXCEPTION_CONTINUE_SEARCH;
+  }
+  context->Rsp = RedirectToThunk(context->Rsp);
+  context->Rip = (DWORD64)AccessFaultThunk;
+  return EXCEPTION_CONTINUE_EXECUTION;
+}
+
+int InstallPlatformHandler() {
+  vectored_handler_ = AddVectoredExceptionHandler(1, FaultExceptionHandler);
+  return vectored_handler_ ? 0 : 1;
+}
+
+void UninstallPlatformHandler() {
+  if (vectored_handler_) {
+    RemoveVectoredExceptionHandler(vectored_handler_);
+    vectored_handler_ = NULL;
+  }
+}
+
+#else
+
+struct sigaction previous_segv_action_;
+struct sigaction previous_bus_action_;
+
+void FaultSignalHandler(int sig, siginfo_t* info, void* context) {
+  ucontext_t* uc = (ucontext_t*)context;
+#if XE_LIKE(OSX)
+  void* host_pc = (void*)uc->uc_mcontext->__ss.__rip;
+#else
+  void* host_pc = (void*)uc->uc_mcontext.gregs[REG_RIP];
+#endif  // OSX
+  if (ClaimFault(host_pc, info->si_addr)) {
+#if XE_LIKE(OSX)
+    uc->uc_mcontext->__ss.__rsp = RedirectToThunk(uc->uc_mcontext->__ss.__rsp);
+    uc->uc_mcontext->__ss.__rip = (uint64_t)AccessFaultThunk;
+#else
+    uc->uc_mcontext.gregs[REG_RSP] =
+        (greg_t)RedirectToThunk(uc->uc_mcontext.gregs[REG_RSP]);
+    uc->uc_mcontext.gregs[REG_RIP] = (greg_t)AccessFaultThunk;
+#endif  // OSX
+    return;
+  }
+
+  // Not ours, so hand it to the previous handler. Returning with the default
+  // action restored faults again and takes the process down as usual.
+  struct sigaction* previous =
+      sig == SIGSEGV ? &previous_segv_action_ : &previous_bus_action_;
+  if (previous->sa_flags & SA_SIGINFO) {
+    previous->sa_sigaction(sig, info, context);
+  } else if (previous->sa_handler != SIG_DFL &&
+             previous->sa_handler != SIG_IGN) {
+    previous->sa_handler(sig);
+  } else {
+    struct sigaction action;
+    xe_zero_struct(&action, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(sig, &action, NULL);
+  }
+}
+
+int InstallPlatformHandler() {
+  struct sigaction action;
+  xe_zero_struct(&action, sizeof(action));
+  action.sa_sigaction = FaultSignalHandler;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGSEGV, &action, &previous_segv_action_)) {
+    return 1;
+  }
+  if (sigaction(SIGBUS, &action, &previous_bus_action_)) {
+    sigaction(SIGSEGV, &previous_segv_action_, NULL);
+    return 1;
+  }
+  return 0;
+}
+
+void UninstallPlatformHandler() {
+  sigaction(SIGSEGV, &previous_segv_action_, NULL);
+  sigaction(SIGBUS, &previous_bus_action_, NULL);
+}
+
+#endif  // WIN32
+
+}  // namespace
+
+
+namespace xe {
+namespace cpu {
+namespace x64 {
+
+
+int X64InstallFaultHandler(X64JIT* jit) {
+  if (!lock_) {
+    xe_mutex_t* lock = xe_mutex_alloc(10000);
+    XEASSERTNOTNULL(lock);
+    if (!xe_atomic_cas_ptr(NULL, lock, &lock_)) {
+      xe_mutex_free(lock);
+    }
+  }
+
+  int result_code = 1;
+  xe_mutex_lock(lock_);
+  for (size_t n = 0; n < kMaxJits; n++) {
+    if (!jits_[n]) {
+      result_code = jit_count_ ? 0 : InstallPlatformHandler();
+      if (!result_code) {
+        jits_[n] = jit;
+        jit_count_++;
+      }
+      break;
+    }
+  }
+  xe_mutex_unlock(lock_);
+  return result_code;
+}
+
+void X64UninstallFaultHandler(X64JIT* jit) {
+  if (!lock_) {
+    return;
+  }
+  xe_mutex_lock(lock_);
+  for (size_t n = 0; n < kMaxJits; n++) {
+    if (jits_[n] == jit) {
+      jits_[n] = NULL;
+      if (!--jit_count_) {
+        UninstallPlatformHandler();
+      }
+      break;
+    }
+  }
+  xe_mutex_unlock(lock_);
+}
+
+xe_ppc_state_t* X64GetThreadPpcState() {
+  return thread_ppc_state_;
+}
+
+xe_ppc_state_t* X64SetThreadPpcState(xe_ppc_state_t* ppc_state) {
+  xe_ppc_state_t* previous = thread_ppc_state_;
+  thread_ppc_state_ = ppc_state;
+  return previous;
+}
+
+
+}  // namespace x64
+}  // namespace cpu
+}  // namespace xe
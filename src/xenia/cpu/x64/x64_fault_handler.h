@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_X64_X64_FAULT_HANDLER_H_
+#define XENIA_CPU_X64_X64_FAULT_HANDLER_H_
+
+#include <xenia/common.h>
+
+#include <xenia/cpu/ppc/state.h>
+
+
+namespace xe {
+namespace cpu {
+namespace x64 {
+
+
+class X64JIT;
+
+
+// Process-wide host fault handler for guest memory accesses.
+// Generated code does not bounds check guest addresses. Accesses that land on
+// uncommitted pages or past the usable guest range fault in the host and are
+// offered to each registered JIT until one recognizes the faulting code (see
+// X64JIT::LookupAccessFault). Nothing that isn't async-signal-safe runs in the
+// handler itself: a claimed fault is recorded for the thread and the context
+// redirected to a thunk that reports it (X64JIT::ReportAccessFault) once the
+// handler has returned. Faults nobody claims go to the handler that was
+// installed before ours.
+int X64InstallFaultHandler(X64JIT* jit);
+void X64UninstallFaultHandler(X64JIT* jit);
+
+// Guest state of the code running on the calling thread, if any.
+// Set by X64JIT::Execute so that faults can be reported against it.
+xe_ppc_state_t* X64GetThreadPpcState();
+xe_ppc_state_t* X64SetThreadPpcState(xe_ppc_state_t* ppc_state);
+
+
+}  // namespace x64
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_X64_X64_FAULT_HANDLER_H_
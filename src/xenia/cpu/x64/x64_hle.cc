@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/cpu/x64/x64_hle.h>
+
+
+using namespace xe;
+using namespace xe::cpu;
+using namespace xe::cpu::x64;
+
+
+namespace {
+
+// All guest addresses are 32-bit. Bytes are stored in the same order on both
+// sides, so the host routines can work on guest memory in place.
+#define GUEST_PTR(n) (ppc_state->membase + (uint32_t)ppc_state->r[n])
+
+// void* memcpy(void* dest, const void* src, size_t n)
+// Done as a memmove so that overlapping ranges are well defined on the host.
+void HleMemcpy(xe_ppc_state_t* ppc_state, void* data) {
+  memmove(GUEST_PTR(3), GUEST_PTR(4), (uint32_t)ppc_state->r[5]);
+  // r3 (dest) is returned unchanged.
+}
+
+// void* memset(void* dest, int c, size_t n)
+void HleMemset(xe_ppc_state_t* ppc_state, void* data) {
+  memset(GUEST_PTR(3), (uint8_t)ppc_state->r[4], (uint32_t)ppc_state->r[5]);
+  // r3 (dest) is returned unchanged.
+}
+
+// size_t strlen(const char* s)
+void HleStrlen(xe_ppc_state_t* ppc_state, void* data) {
+  ppc_state->r[3] = (uint64_t)strlen((const char*)GUEST_PTR(3));
+}
+
+#undef GUEST_PTR
+
+typedef struct {
+  const char*         name;
+  x64_hle_function_t  fn;
+} HleFunction;
+
+const HleFunction hle_functions_[] = {
+  { "memcpy",   HleMemcpy },
+  { "memmove",  HleMemcpy },
+  { "memset",   HleMemset },
+  { "strlen",   HleStrlen },
+  // XDK versions with the same signatures.
+  { "XMemCpy",  HleMemcpy },
+  { "XMemSet",  HleMemset },
+};
+
+}  // namespace
+
+
+namespace xe {
+namespace cpu {
+namespace x64 {
+
+
+x64_hle_function_t X64LookupHleFunction(const char* name) {
+  if (!name) {
+    return NULL;
+  }
+  for (size_t n = 0; n < XECOUNT(hle_functions_); n++) {
+    if (!xestrcmpa(name, hle_functions_[n].name)) {
+      return hle_functions_[n].fn;
+    }
+  }
+  return NULL;
+}
+
+
+}  // namespace x64
+}  // namespace cpu
+}  // namespace xe
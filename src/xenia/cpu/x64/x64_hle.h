@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_X64_X64_HLE_H_
+#define XENIA_CPU_X64_X64_HLE_H_
+
+#include <xenia/common.h>
+
+#include <xenia/cpu/ppc/state.h>
+
+
+namespace xe {
+namespace cpu {
+namespace x64 {
+
+
+// Native replacement for a guest function.
+// Arguments are taken from and results returned in the guest registers, the
+// same as the kernel export shims.
+typedef void (*x64_hle_function_t)(xe_ppc_state_t* ppc_state, void* data);
+
+// Finds the native replacement for the guest function with the given name.
+// Titles statically link their own CRT, and the guest versions of the
+// memory/string routines are slow byte loops once translated.
+// Only strlen and memset (byte loop forms) are named by signature (see
+// XexSymbolDatabase::FindCrtRoutines); the rest need a module map.
+// Returns NULL if there is no replacement.
+x64_hle_function_t X64LookupHleFunction(const char* name);
+
+
+}  // namespace x64
+}  // namespace cpu
+}  // namespace xe
+
+
+#endif  // XENIA_CPU_X64_X64_HLE_H_
@@ -9,9 +9,12 @@
 
 #include <xenia/cpu/x64/x64_jit.h>
 
+#include <algorithm>
+
 #include <xenia/cpu/cpu-private.h>
 #include <xenia/cpu/exec_module.h>
 #include <xenia/cpu/sdb.h>
+#include <xenia/cpu/x64/x64_fault_handler.h>
 
 #include <asmjit/asmjit.h>
 
@@ -24,13 +27,78 @@ using namespace xe::cpu::x64;
 using namespace AsmJit;
 
 
+DECLARE_bool(log_codegen);
+DECLARE_bool(memory_address_verification);
+
+DEFINE_int32(jit_emitter_count, 0,
+    "Maximum number of concurrent JIT emitters (0 = one per host core).");
+DEFINE_bool(log_indirect_branch_stats, false,
+    "Log inline cache hits/misses of indirect branch sites on shutdown.");
+DEFINE_string(jit_cache_path, "",
+    "Directory to persist generated code in (empty = no code cache).");
+DEFINE_bool(jit_movbe, true,
+    "Use MOVBE for guest memory accesses if the processor supports it.");
+
+
 X64JIT::X64JIT(xe_memory_ref memory, SymbolTable* sym_table) :
     JIT(memory, sym_table),
-    emitter_(NULL) {
+    lock_(NULL), cpu_features_(0), max_emitter_count_(1), next_emitter_(0),
+    code_range_count_(0),
+    gpu_this_(NULL), gpu_read_(NULL), gpu_write_(NULL) {
+  xe_zero_struct(code_range_chunks_, sizeof(code_range_chunks_));
 }
 
 X64JIT::~X64JIT() {
-  delete emitter_;
+  X64UninstallFaultHandler(this);
+
+  for (std::vector<X64CodeCache*>::iterator it = code_caches_.begin();
+       it != code_caches_.end(); ++it) {
+    (*it)->Flush();
+    delete *it;
+  }
+  code_caches_.clear();
+
+  if (FLAGS_log_indirect_branch_stats) {
+    DumpIndirectBranchStats();
+  }
+  for (std::vector<IndirectBranchCache*>::iterator it =
+       indirect_branch_caches_.begin(); it != indirect_branch_caches_.end();
+       ++it) {
+    xe_free(*it);
+  }
+  indirect_branch_caches_.clear();
+
+  for (std::vector<X64Emitter*>::iterator it = emitters_.begin();
+       it != emitters_.end(); ++it) {
+    delete *it;
+  }
+  emitters_.clear();
+
+  for (CompileRequestMap::iterator it = compile_requests_.begin();
+       it != compile_requests_.end(); ++it) {
+    xe_mutex_free(it->second->lock);
+    xe_free(it->second);
+  }
+  compile_requests_.clear();
+
+  for (int32_t n = 0; n < code_range_count_; n++) {
+    CodeRange& range =
+        code_range_chunks_[n / kCodeRangeChunkSize][n % kCodeRangeChunkSize];
+    if (range.access_sites) {
+      xe_free(range.access_sites);
+    }
+  }
+  for (size_t n = 0; n < XECOUNT(code_range_chunks_); n++) {
+    if (code_range_chunks_[n]) {
+      xe_free(code_range_chunks_[n]);
+    }
+  }
+  code_range_count_ = 0;
+
+  if (lock_) {
+    xe_mutex_free(lock_);
+    lock_ = NULL;
+  }
 }
 
 int X64JIT::Setup() {
@@ -43,8 +111,27 @@ int X64JIT::Setup() {
   }
   XEEXPECTZERO(result_code);
 
-  // Create the emitter used to generate functions.
-  emitter_ = new X64Emitter(memory_);
+  lock_ = xe_mutex_alloc(10000);
+  XEEXPECTNOTNULL(lock_);
+
+  if (FLAGS_memory_address_verification) {
+    XEEXPECTZERO(X64InstallFaultHandler(this));
+  }
+
+  // Size the emitter pool. Emitters are created on demand up to this count so
+  // that titles that never compile concurrently only pay for one.
+  // Codegen logging goes to stdout and would interleave, so force a single
+  // emitter when it's enabled.
+  if (FLAGS_log_codegen) {
+    max_emitter_count_ = 1;
+  } else if (FLAGS_jit_emitter_count > 0) {
+    max_emitter_count_ = FLAGS_jit_emitter_count;
+  } else {
+    max_emitter_count_ = MAX(1u, CpuInfo::getGlobal()->getNumberOfProcessors());
+  }
+
+  // Create the first emitter used to generate functions.
+  emitters_.push_back(new X64Emitter(this, memory_));
 
   result_code = 0;
 XECLEANUP:
@@ -53,7 +140,295 @@ XECLEANUP:
 
 void X64JIT::SetupGpuPointers(void* gpu_this,
                               void* gpu_read, void* gpu_write) {
-  emitter_->SetupGpuPointers(gpu_this, gpu_read, gpu_write);
+  xe_mutex_lock(lock_);
+  gpu_this_ = gpu_this;
+  gpu_read_ = gpu_read;
+  gpu_write_ = gpu_write;
+  for (std::vector<X64Emitter*>::iterator it = emitters_.begin();
+       it != emitters_.end(); ++it) {
+    (*it)->SetupGpuPointers(gpu_this, gpu_read, gpu_write);
+  }
+  xe_mutex_unlock(lock_);
+}
+
+SymbolTable* X64JIT::sym_table() {
+  return sym_table_;
+}
+
+uint32_t X64JIT::cpu_features() {
+  return cpu_features_;
+}
+
+X64CodeCache* X64JIT::GetCodeCache(uint32_t address) {
+  X64CodeCache* result = NULL;
+  xe_mutex_lock(lock_);
+  for (std::vector<X64CodeCache*>::iterator it = code_caches_.begin();
+       it != code_caches_.end(); ++it) {
+    if (address >= (*it)->code_addr_low() &&
+        address < (*it)->code_addr_high()) {
+      result = *it;
+      break;
+    }
+  }
+  xe_mutex_unlock(lock_);
+  return result;
+}
+
+IndirectBranchCache* X64JIT::AllocIndirectBranchCache(uint32_t cia) {
+  IndirectBranchCache* cache =
+      (IndirectBranchCache*)xe_calloc(sizeof(IndirectBranchCache));
+  XEASSERTNOTNULL(cache);
+  cache->cia = cia;
+  for (size_t n = 0; n < XECOUNT(cache->entries); n++) {
+    cache->entries[n].target = ~0ull;
+  }
+
+  // Caches live as long as the JIT as generated code is never freed.
+  xe_mutex_lock(lock_);
+  indirect_branch_caches_.push_back(cache);
+  xe_mutex_unlock(lock_);
+
+  return cache;
+}
+
+namespace {
+bool CompareIndirectBranchCacheMisses(const IndirectBranchCache* a,
+                                      const IndirectBranchCache* b) {
+  return a->misses > b->misses;
+}
+bool CompareAccessSites(const X64AccessSite& a, const X64AccessSite& b) {
+  return a.host_offset < b.host_offset;
+}
+}
+
+void X64JIT::DumpIndirectBranchStats() {
+  std::vector<IndirectBranchCache*> caches(indirect_branch_caches_);
+  std::sort(caches.begin(), caches.end(), CompareIndirectBranchCacheMisses);
+
+  uint64_t total_hits = 0;
+  uint64_t total_misses = 0;
+  for (std::vector<IndirectBranchCache*>::iterator it = caches.begin();
+       it != caches.end(); ++it) {
+    total_hits += (*it)->hits;
+    total_misses += (*it)->misses;
+  }
+  XELOGCPU("Indirect branch caches: %d sites, %lld hits, %lld misses",
+           (int)caches.size(), total_hits, total_misses);
+  for (std::vector<IndirectBranchCache*>::iterator it = caches.begin();
+       it != caches.end(); ++it) {
+    const IndirectBranchCache* cache = *it;
+    if (!cache->hits && !cache->misses) {
+      continue;
+    }
+    XELOGCPU("  %.8X: %12lld hits %12lld misses %d targets%s",
+             cache->cia, cache->hits, cache->misses, cache->entry_count,
+             cache->megamorphic ? " (megamorphic)" : "");
+  }
+}
+
+X64Emitter* X64JIT::AcquireEmitter() {
+  xe_mutex_lock(lock_);
+
+  // Try to grab any idle emitter, starting after the last one handed out so
+  // that we spread the load.
+  size_t count = emitters_.size();
+  for (size_t n = 0; n < count; n++) {
+    size_t index = (next_emitter_ + n) % count;
+    X64Emitter* emitter = emitters_[index];
+    if (emitter->TryLock()) {
+      next_emitter_ = index + 1;
+      xe_mutex_unlock(lock_);
+      return emitter;
+    }
+  }
+
+  // All busy - grow the pool if we are allowed to.
+  if (count < max_emitter_count_) {
+    X64Emitter* emitter = new X64Emitter(this, memory_);
+    emitter->SetupGpuPointers(gpu_this_, gpu_read_, gpu_write_);
+    emitter->Lock();
+    emitters_.push_back(emitter);
+    xe_mutex_unlock(lock_);
+    return emitter;
+  }
+
+  // Pool exhausted - queue up behind one of the busy emitters.
+  X64Emitter* emitter = emitters_[next_emitter_++ % count];
+  xe_mutex_unlock(lock_);
+  emitter->Lock();
+  return emitter;
+}
+
+void X64JIT::ReleaseEmitter(X64Emitter* emitter) {
+  emitter->Unlock();
+}
+
+void X64JIT::AddCodeRange(FunctionSymbol* symbol, void* code,
+                          size_t code_size,
+                          std::vector<X64AccessSite>& access_sites) {
+  std::sort(access_sites.begin(), access_sites.end(), CompareAccessSites);
+  X64AccessSite* sites = NULL;
+  if (access_sites.size()) {
+    sites = (X64AccessSite*)xe_malloc(
+        access_sites.size() * sizeof(X64AccessSite));
+    XEASSERTNOTNULL(sites);
+    xe_copy_struct(sites, &access_sites[0],
+                   access_sites.size() * sizeof(X64AccessSite));
+  }
+
+  xe_mutex_lock(lock_);
+  const int32_t n = code_range_count_;
+  const size_t chunk = n / kCodeRangeChunkSize;
+  if (chunk >= XECOUNT(code_range_chunks_)) {
+    // Out of room. Faults in this function will only show up as host faults.
+    xe_mutex_unlock(lock_);
+    XELOGE("Too many functions to track guest access faults in");
+    if (sites) {
+      xe_free(sites);
+    }
+    return;
+  }
+  if (!code_range_chunks_[chunk]) {
+    code_range_chunks_[chunk] = (CodeRange*)xe_calloc(
+        kCodeRangeChunkSize * sizeof(CodeRange));
+    XEASSERTNOTNULL(code_range_chunks_[chunk]);
+  }
+  CodeRange& range = code_range_chunks_[chunk][n % kCodeRangeChunkSize];
+  range.code_start = (uintptr_t)code;
+  range.code_size = code_size;
+  range.symbol = symbol;
+  range.access_sites = sites;
+  range.access_site_count = access_sites.size();
+  // Publish only once the entry is complete. The increment is a full barrier.
+  xe_atomic_inc_32(&code_range_count_);
+  xe_mutex_unlock(lock_);
+}
+
+bool X64JIT::LookupAccessFault(void* host_pc, void* host_address,
+                               X64AccessFault* out_fault) {
+  // Guest accesses are always [membase + 32-bit address], so anything outside
+  // of the reservation is not one of ours.
+  const uint8_t* membase = xe_memory_addr(memory_, 0);
+  if ((const uint8_t*)host_address < membase ||
+      (uint64_t)((const uint8_t*)host_address - membase) > 0xFFFFFFFFull) {
+    return false;
+  }
+
+  // Newest first, so that code regenerated at the same address wins.
+  const CodeRange* range = NULL;
+  for (int32_t n = code_range_count_ - 1; n >= 0; n--) {
+    const CodeRange& candidate =
+        code_range_chunks_[n / kCodeRangeChunkSize][n % kCodeRangeChunkSize];
+    if ((uintptr_t)host_pc >= candidate.code_start &&
+        (uintptr_t)host_pc - candidate.code_start < candidate.code_size) {
+      range = &candidate;
+      break;
+    }
+  }
+  if (!range) {
+    return false;
+  }
+  const uint32_t host_offset =
+      (uint32_t)((uintptr_t)host_pc - range->code_start);
+
+  // The faulting instruction is the last access that starts at or before the
+  // host PC. Without one (cached code/etc) only the function is known.
+  uint32_t cia = range->symbol->start_address;
+  X64AccessSite key;
+  key.host_offset = host_offset;
+  key.cia = 0;
+  const X64AccessSite* sites_end =
+      range->access_sites + range->access_site_count;
+  const X64AccessSite* site = std::upper_bound(
+      (const X64AccessSite*)range->access_sites, sites_end, key,
+      CompareAccessSites);
+  if (site != range->access_sites) {
+    cia = (site - 1)->cia;
+  }
+
+  out_fault->symbol = range->symbol;
+  out_fault->ppc_state = X64GetThreadPpcState();
+  out_fault->host_pc = host_pc;
+  out_fault->host_offset = host_offset;
+  out_fault->cia = cia;
+  out_fault->ea = (uint32_t)((const uint8_t*)host_address - membase);
+  return true;
+}
+
+void X64JIT::ReportAccessFault(const X64AccessFault& fault) {
+  XELOGE("Guest access violation in %s at host %p (+%X)",
+         fault.symbol->name(), fault.host_pc, fault.host_offset);
+  GlobalExports global_exports;
+  cpu::GetGlobalExports(&global_exports);
+  global_exports.XeAccessViolation(fault.ppc_state, fault.cia, fault.ea);
+}
+
+void* X64JIT::OnDemandCompileTrampoline(
+    X64JIT* jit, FunctionSymbol* symbol) {
+  // This function is called by the redirector code from
+  // X64Emitter::PrepareFunction. We jump into the member OnDemandCompile and
+  // pass back the result.
+  return jit->OnDemandCompile(symbol);
+}
+
+void* X64JIT::OnDemandCompile(FunctionSymbol* symbol) {
+  // Multiple threads may hit the same redirector before it is patched. Only
+  // the first one compiles; the rest wait on its request and share the result.
+  xe_mutex_lock(lock_);
+  if (symbol->flags & FunctionSymbol::kFlagCompiled) {
+    // Read the redirector slot before it was patched and got here after the
+    // compile finished.
+    void* result = symbol->impl_value;
+    xe_mutex_unlock(lock_);
+    return result;
+  }
+  CompileRequestMap::iterator it = compile_requests_.find(symbol);
+  if (it != compile_requests_.end()) {
+    CompileRequest* request = it->second;
+    request->ref_count++;
+    xe_mutex_unlock(lock_);
+    xe_mutex_lock(request->lock);
+    void* result = request->result;
+    xe_mutex_unlock(request->lock);
+    ReleaseCompileRequest(request);
+    return result;
+  }
+  CompileRequest* request =
+      (CompileRequest*)xe_calloc(sizeof(CompileRequest));
+  request->lock = xe_mutex_alloc(10000);
+  request->ref_count = 1;
+  xe_mutex_lock(request->lock);
+  compile_requests_.insert(CompileRequestMap::value_type(symbol, request));
+  xe_mutex_unlock(lock_);
+
+  // Compile on whichever emitter is free. Compiles of other symbols proceed
+  // in parallel on the other emitters in the pool.
+  X64Emitter* emitter = AcquireEmitter();
+  void* result = emitter->OnDemandCompile(symbol);
+  ReleaseEmitter(emitter);
+
+  // Threads already waiting share the result, failed or not. Later ones
+  // either see the compiled flag or, after a failure, try again.
+  request->result = result;
+  xe_mutex_lock(lock_);
+  if (result) {
+    symbol->flags |= FunctionSymbol::kFlagCompiled;
+  }
+  compile_requests_.erase(symbol);
+  xe_mutex_unlock(lock_);
+  xe_mutex_unlock(request->lock);
+  ReleaseCompileRequest(request);
+  return result;
+}
+
+void X64JIT::ReleaseCompileRequest(CompileRequest* request) {
+  xe_mutex_lock(lock_);
+  bool is_last = !--request->ref_count;
+  xe_mutex_unlock(lock_);
+  if (is_last) {
+    xe_mutex_free(request->lock);
+    xe_free(request);
+  }
 }
 
 namespace {
@@ -125,7 +500,30 @@ int X64JIT::CheckProcessor() {
   }
 #endif
 
-  // TODO(benvanik): ensure features we want are supported.
+  // Translate the CPUID feature bits into the set the emitter uses. Features
+  // disabled by flags are dropped here so that codegen only has to check one
+  // place.
+  const uint32_t x86_features = cpu->getFeatures();
+  cpu_features_ = 0;
+  if (x86_features & kX86FeatureSsse3) {
+    cpu_features_ |= kX64CpuFeatureSsse3;
+  }
+  if (x86_features & kX86FeatureSse41) {
+    cpu_features_ |= kX64CpuFeatureSse41;
+  }
+  if ((x86_features & kX86FeatureMovBE) && FLAGS_jit_movbe) {
+    cpu_features_ |= kX64CpuFeatureMovbe;
+  }
+  XELOGCPU("Processor features: SSSE3=%d SSE4.1=%d MOVBE=%d",
+           (cpu_features_ & kX64CpuFeatureSsse3) ? 1 : 0,
+           (cpu_features_ & kX64CpuFeatureSse41) ? 1 : 0,
+           (cpu_features_ & kX64CpuFeatureMovbe) ? 1 : 0);
+
+  // The vector emitters rely on pshufb.
+  if (!(cpu_features_ & kX64CpuFeatureSsse3)) {
+    XELOGE("Processor does not support SSSE3");
+    return 1;
+  }
 
   return 0;
 }
@@ -135,11 +533,55 @@ int X64JIT::InitModule(ExecModule* module) {
   // TODO(benvanik): warn on unimplemented instructions.
   // TODO(benvanik): dump instruction use report.
   // TODO(benvanik): dump kernel use report.
-  // TODO(benvanik): check for cached code/patches/etc.
+  // TODO(benvanik): check for patches/etc.
+
+  if (!FLAGS_jit_cache_path.size()) {
+    return 0;
+  }
+  uint32_t code_addr_low = module->code_addr_low();
+  uint32_t code_addr_high = module->code_addr_high();
+  if (code_addr_low >= code_addr_high) {
+    return 0;
+  }
+
+  // The cache is keyed on the loaded guest code, so any change to the image
+  // (title update, patches/etc) invalidates it. FNV-1a.
+  const uint8_t* p = xe_memory_addr(memory_, code_addr_low);
+  uint64_t image_hash = 14695981039346656037ull;
+  for (uint32_t n = 0; n < code_addr_high - code_addr_low; n++) {
+    image_hash = (image_hash ^ p[n]) * 1099511628211ull;
+  }
+
+  // The flag names a directory; add the separator if it was left off.
+  const std::string& cache_dir = FLAGS_jit_cache_path;
+  char last_char = cache_dir[cache_dir.size() - 1];
+  char separator[2] = { (char)XE_PATH_SEPARATOR, 0 };
+  if (last_char == '/' || last_char == separator[0]) {
+    separator[0] = 0;
+  }
+  char path[XE_MAX_PATH];
+  xesnprintfa(path, XECOUNT(path), "%s%s%s.xcc",
+              cache_dir.c_str(), separator, module->name());
+  X64CodeCache* code_cache = new X64CodeCache(
+      path, image_hash, X64Emitter::GetConfigHash(cpu_features_),
+      code_addr_low, code_addr_high);
+  if (code_cache->Load()) {
+    // Corrupt/unreadable - it'll be overwritten on flush.
+    XELOGE("Unable to load code cache %s", path);
+  }
+
+  xe_mutex_lock(lock_);
+  code_caches_.push_back(code_cache);
+  xe_mutex_unlock(lock_);
+
   return 0;
 }
 
 int X64JIT::UninitModule(ExecModule* module) {
+  X64CodeCache* code_cache = GetCodeCache(module->code_addr_low());
+  if (code_cache) {
+    code_cache->Flush();
+  }
   return 0;
 }
 
@@ -148,8 +590,10 @@ void* X64JIT::GetFunctionPointer(sdb::FunctionSymbol* fn_symbol) {
   x64_function_t fn_ptr = (x64_function_t)fn_symbol->impl_value;
   if (!fn_ptr) {
     // Function hasn't been prepped yet - make it now inline.
-    // The emitter will lock and do other fancy things, if required.
-    if (emitter_->PrepareFunction(fn_symbol)) {
+    X64Emitter* emitter = AcquireEmitter();
+    int result_code = emitter->PrepareFunction(fn_symbol);
+    ReleaseEmitter(emitter);
+    if (result_code) {
       return NULL;
     }
     fn_ptr = (x64_function_t)fn_symbol->impl_value;
@@ -170,7 +614,11 @@ int X64JIT::Execute(xe_ppc_state_t* ppc_state, FunctionSymbol* fn_symbol) {
   }
 
   // Call into the function. This will compile it if needed.
+  // Kernel calls may re-enter here on the same thread, so restore whatever
+  // state was current before.
+  xe_ppc_state_t* previous_ppc_state = X64SetThreadPpcState(ppc_state);
   fn_ptr(ppc_state, ppc_state->lr);
+  X64SetThreadPpcState(previous_ppc_state);
 
   return 0;
 }
@@ -12,9 +12,12 @@
 
 #include <xenia/core.h>
 
+#include <vector>
+
 #include <xenia/cpu/jit.h>
 #include <xenia/cpu/ppc.h>
 #include <xenia/cpu/sdb.h>
+#include <xenia/cpu/x64/x64_code_cache.h>
 #include <xenia/cpu/x64/x64_emitter.h>
 
 
@@ -23,6 +26,27 @@ namespace cpu {
 namespace x64 {
 
 
+// Host processor features the emitter can take advantage of.
+// Detected by X64JIT::CheckProcessor.
+enum X64CpuFeature {
+  kX64CpuFeatureSsse3     = (1 << 0),
+  kX64CpuFeatureSse41     = (1 << 1),
+  kX64CpuFeatureMovbe     = (1 << 2),
+};
+
+
+// A guest memory access that faulted in generated code.
+// Filled in by X64JIT::LookupAccessFault from inside the fault handler.
+typedef struct {
+  sdb::FunctionSymbol*  symbol;
+  xe_ppc_state_t*       ppc_state;
+  void*                 host_pc;
+  uint32_t              host_offset;
+  uint32_t              cia;
+  uint32_t              ea;
+} X64AccessFault;
+
+
 class X64JIT : public JIT {
 public:
   X64JIT(xe_memory_ref memory, sdb::SymbolTable* sym_table);
@@ -39,10 +63,72 @@ public:
   virtual int Execute(xe_ppc_state_t* ppc_state,
                       sdb::FunctionSymbol* fn_symbol);
 
+  sdb::SymbolTable* sym_table();
+  uint32_t cpu_features();
+  X64CodeCache* GetCodeCache(uint32_t address);
+  IndirectBranchCache* AllocIndirectBranchCache(uint32_t cia);
+
+  X64Emitter* AcquireEmitter();
+  void ReleaseEmitter(X64Emitter* emitter);
+
+  void AddCodeRange(sdb::FunctionSymbol* symbol, void* code, size_t code_size,
+                    std::vector<X64AccessSite>& access_sites);
+  // Safe to call from a signal handler: takes no locks and doesn't allocate.
+  bool LookupAccessFault(void* host_pc, void* host_address,
+                         X64AccessFault* out_fault);
+  static void ReportAccessFault(const X64AccessFault& fault);
+
+  static void* OnDemandCompileTrampoline(
+      X64JIT* jit, sdb::FunctionSymbol* symbol);
+  void* OnDemandCompile(sdb::FunctionSymbol* symbol);
+
 protected:
   int CheckProcessor();
-
-  X64Emitter*     emitter_;
+  void DumpIndirectBranchStats();
+
+  // Tracks a compile of a single function so that concurrent requests for the
+  // same symbol wait on the first instead of compiling it again.
+  // The lock is held by the compiling thread until result is set. The request
+  // leaves compile_requests_ once it has a result and is freed when the last
+  // thread referencing it (ref_count, guarded by lock_) is done with it.
+  typedef struct {
+    xe_mutex_t* lock;
+    void*       result;
+    uint32_t    ref_count;
+  } CompileRequest;
+  typedef std::tr1::unordered_map<sdb::FunctionSymbol*, CompileRequest*>
+      CompileRequestMap;
+  void ReleaseCompileRequest(CompileRequest* request);
+
+  // Generated code for one function. Access sites are sorted by host offset.
+  // Ranges are only ever appended and never change once code_range_count_
+  // covers them, so the fault handler can scan them without locking.
+  typedef struct {
+    uintptr_t             code_start;
+    size_t                code_size;
+    sdb::FunctionSymbol*  symbol;
+    X64AccessSite*        access_sites;
+    size_t                access_site_count;
+  } CodeRange;
+  enum {
+    kCodeRangeChunkSize   = 4096,
+    kMaxCodeRangeChunks   = 1024,
+  };
+
+  xe_mutex_t*     lock_;
+  uint32_t        cpu_features_;    // X64CpuFeature bits
+  size_t          max_emitter_count_;
+  size_t          next_emitter_;
+  std::vector<X64Emitter*> emitters_;
+  CompileRequestMap compile_requests_;
+  std::vector<X64CodeCache*> code_caches_;
+  std::vector<IndirectBranchCache*> indirect_branch_caches_;
+  CodeRange*      code_range_chunks_[kMaxCodeRangeChunks];
+  volatile int32_t code_range_count_;
+
+  void*           gpu_this_;
+  void*           gpu_read_;
+  void*           gpu_write_;
 };
 
 
@@ -21,8 +21,15 @@ using namespace xe::gpu::xenos;
 RingBufferWorker::RingBufferWorker(xe_memory_ref memory) :
     memory_(memory) {
   running_ = true;
-  write_ptr_index_event_ = CreateEvent(
-      NULL, FALSE, FALSE, NULL);
+  primary_buffer_ptr_ = 0;
+  primary_buffer_size_ = 0;
+  read_ptr_index_ = 0;
+  read_ptr_update_freq_ = 0;
+  read_ptr_writeback_ptr_ = 0;
+  write_ptr_index_ = 0;
+  // Submits tend to come in bursts, so spin a bit before sleeping to keep
+  // guest-to-GPU latency low.
+  write_ptr_index_event_ = xe_event_alloc(4000);
 
   thread_ = xe_thread_create(
       "RingBufferWorker",
@@ -32,9 +39,9 @@ RingBufferWorker::RingBufferWorker(xe_memory_ref memory) :
 RingBufferWorker::~RingBufferWorker() {
   // TODO(benvanik): thread join.
   running_ = false;
-  SetEvent(write_ptr_index_event_);
+  xe_event_set(write_ptr_index_event_);
   xe_thread_release(thread_);
-  CloseHandle(write_ptr_index_event_);
+  xe_event_free(write_ptr_index_event_);
 }
 
 void RingBufferWorker::Initialize(uint32_t ptr, uint32_t page_count) {
@@ -57,38 +64,33 @@ void RingBufferWorker::EnableReadPointerWriteBack(uint32_t ptr,
 }
 
 void RingBufferWorker::UpdateWritePointer(uint32_t value) {
+  // Only enters the kernel if the worker is asleep. The worker isn't started
+  // until Initialize, so earlier writes are just held until then.
   write_ptr_index_ = value;
-  SetEvent(write_ptr_index_event_);
+  xe_event_set(write_ptr_index_event_);
 }
 
 void RingBufferWorker::ThreadStart() {
   uint8_t* p = xe_memory_addr(memory_);
 
   while (running_) {
-    if (write_ptr_index_ == 0xBAADF00D ||
-        read_ptr_index_ == write_ptr_index_) {
+    uint32_t write_ptr_index = write_ptr_index_;
+    if (read_ptr_index_ == write_ptr_index) {
       // Wait for the command buffer pointer to move.
-      // TODO(benvanik): only wait for a bit and check running_.
-      WaitForSingleObject(write_ptr_index_event_, INFINITE);
-      if (!running_) {
-        break;
-      }
+      xe_event_wait(write_ptr_index_event_, XE_EVENT_INFINITE);
+      continue;
     }
-    if (read_ptr_index_ == write_ptr_index_) {
+    if (write_ptr_index >= primary_buffer_size_ / 4) {
+      // Outside of the buffer (or, with a zero sized buffer, written before
+      // it was set up). Ignore it until the guest moves it again.
+      XELOGE("Ring buffer write pointer %.8X out of range", write_ptr_index);
+      xe_event_wait(write_ptr_index_event_, XE_EVENT_INFINITE);
       continue;
     }
 
     // Process the new commands.
     XELOGGPU("Ring buffer thread work");
-
-    // TODO(benvanik): handle wrapping around
-    // read_ptr_index_ = (read_ptr_index_ + 1) % (primary_buffer_size_ / 4);
-    XEASSERT(write_ptr_index_ >= read_ptr_index_);
-    uint32_t length = write_ptr_index_ - read_ptr_index_;
-    if (length) {
-      ExecuteSegment(primary_buffer_ptr_ + read_ptr_index_ * 4, length);
-      read_ptr_index_ = write_ptr_index_;
-    }
+    ExecutePendingSegments(write_ptr_index);
 
     // TODO(benvanik): use read_ptr_update_freq_ and only issue after moving
     //     that many indices.
@@ -98,23 +100,40 @@ void RingBufferWorker::ThreadStart() {
   }
 }
 
-void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t length) {
+void RingBufferWorker::ExecutePendingSegments(uint32_t write_ptr_index) {
+  // The write pointer may have wrapped (possibly more than once since the
+  // worker last ran, in which case the intermediate data is already
+  // overwritten). Packets can straddle the end of the buffer, so everything
+  // up to the write pointer is run as one segment that wraps.
+  const uint32_t buffer_length = primary_buffer_size_ / 4;
+  XEASSERT(write_ptr_index < buffer_length);
+  uint32_t length =
+      (write_ptr_index + buffer_length - read_ptr_index_) % buffer_length;
+  ExecuteSegment(primary_buffer_ptr_, read_ptr_index_, length, buffer_length);
+  read_ptr_index_ = write_ptr_index;
+}
+
+void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t start_index,
+                                      uint32_t length, uint32_t buffer_length) {
   uint8_t* p = xe_memory_addr(memory_);
 
   // Adjust pointer base.
   ptr = (primary_buffer_ptr_ & ~0x1FFFFFFF) | (ptr & 0x1FFFFFFF);
 
+  // Words are read modulo the buffer length, as packets can wrap around the
+  // end of the ring buffer.
+#define PACKET_WORD(m) \
+  XEGETUINT32BE(p + ptr + ((start_index + n + (m)) % buffer_length) * 4)
 #define LOG_DATA(count) \
   for (uint32_t __m = 0; __m < count; __m++) { \
-    XELOGGPU("  %.8X", XEGETUINT32BE(packet_base + 1 * 4 + __m * 4)); \
+    XELOGGPU("  %.8X", PACKET_WORD(1 + __m)); \
   }
 
-  XELOGGPU("CommandList(%.8X): executing %dw", ptr, length);
+  XELOGGPU("CommandList(%.8X): executing %dw", ptr + start_index * 4, length);
 
   // Execute commands!
   for (uint32_t n = 0; n < length;) {
-    const uint8_t* packet_base = p + ptr + n * 4;
-    const uint32_t packet = XEGETUINT32BE(packet_base);
+    const uint32_t packet = PACKET_WORD(0);
     const uint32_t packet_type = packet >> 30;
     switch (packet_type) {
     case 0x00:
@@ -126,7 +145,7 @@ void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t length) {
         uint32_t count = ((packet >> 16) & 0x3FFF) + 1;
         uint32_t base_index = (packet & 0xFFFF);
         for (uint32_t m = 0; m < count; m++) {
-          uint32_t reg_data = XEGETUINT32BE(packet_base + 1 * 4 + m * 4);
+          uint32_t reg_data = PACKET_WORD(1 + m);
           const char* reg_name = xenos::GetRegisterName(base_index + m);
           XELOGGPU("  %.8X -> %.4X %s", reg_data, base_index + m,
                                         reg_name ? reg_name : "");
@@ -142,8 +161,8 @@ void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t length) {
         XELOGGPU("Packet(%.8X): set registers:", packet);
         uint32_t reg_index_1 = packet & 0x7FF;
         uint32_t reg_index_2 = (packet >> 11) & 0x7FF;
-        uint32_t reg_data_1 = XEGETUINT32BE(packet_base + 1 * 4);
-        uint32_t reg_data_2 = XEGETUINT32BE(packet_base + 2 * 4);
+        uint32_t reg_data_1 = PACKET_WORD(1);
+        uint32_t reg_data_2 = PACKET_WORD(2);
         const char* reg_name_1 = xenos::GetRegisterName(reg_index_1);
         const char* reg_name_2 = xenos::GetRegisterName(reg_index_2);
         XELOGGPU("  %.8X -> %.4X %s", reg_data_1, reg_index_1,
@@ -157,6 +176,7 @@ void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t length) {
     case 0x02:
       // Type-2 packet.
       // No-op. Do nothing.
+      n += 1;
       break;
     case 0x03:
       {
@@ -182,11 +202,11 @@ void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t length) {
         case PM4_INDIRECT_BUFFER:
           // indirect buffer dispatch
           {
-            uint32_t list_ptr = XEGETUINT32BE(packet_base + 1 * 4);
-            uint32_t list_length = XEGETUINT32BE(packet_base + 2 * 4);
+            uint32_t list_ptr = PACKET_WORD(1);
+            uint32_t list_length = PACKET_WORD(2);
             XELOGGPU("Packet(%.8X): PM4_INDIRECT_BUFFER %.8X (%dw)",
                      packet, list_ptr, list_length);
-            ExecuteSegment(list_ptr, list_length);
+            ExecuteSegment(list_ptr, 0, list_length, list_length);
           }
           break;
 
@@ -209,11 +229,11 @@ void RingBufferWorker::ExecuteSegment(uint32_t ptr, uint32_t length) {
             XELOGGPU("Packet(%.8X): PM4_EVENT_WRITE_SHD", packet);
             LOG_DATA(count);
             // 3?
-            uint32_t d0 = XEGETUINT32BE(packet_base + 1 * 4);
+            uint32_t d0 = PACKET_WORD(1);
             // ptr
-            uint32_t d1 = XEGETUINT32BE(packet_base + 2 * 4);
+            uint32_t d1 = PACKET_WORD(2);
             // value?
-            uint32_t d2 = XEGETUINT32BE(packet_base + 3 * 4);
+            uint32_t d2 = PACKET_WORD(3);
             XESETUINT32BE(
                 p + d1 + (primary_buffer_ptr_ & ~0x1FFFFFFF), d2);
           }
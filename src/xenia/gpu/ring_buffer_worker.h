@@ -34,7 +34,9 @@ protected:
     this_ptr->ThreadStart();
   }
   void ThreadStart();
-  void ExecuteSegment(uint32_t ptr, uint32_t length);
+  void ExecutePendingSegments(uint32_t write_ptr_index);
+  void ExecuteSegment(uint32_t ptr, uint32_t start_index, uint32_t length,
+                      uint32_t buffer_length);
 
 protected:
   xe_memory_ref   memory_;
@@ -48,8 +50,8 @@ protected:
   uint32_t        read_ptr_update_freq_;
   uint32_t        read_ptr_writeback_ptr_;
 
-  HANDLE          write_ptr_index_event_;
-  uint32_t        write_ptr_index_;
+  xe_event_t*     write_ptr_index_event_;
+  volatile uint32_t write_ptr_index_;
 };
 
 
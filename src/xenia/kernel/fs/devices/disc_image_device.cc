@@ -79,9 +79,11 @@ DiscImageDevice::DiscImageDevice(const char* path, const xechar_t* local_path) :
   local_path_ = xestrdup(local_path);
   mmap_ = NULL;
   gdfx_ = NULL;
+  path_cache_lock_ = xe_mutex_alloc(10000);
 }
 
 DiscImageDevice::~DiscImageDevice() {
+  xe_mutex_free(path_cache_lock_);
   delete gdfx_;
   xe_mmap_release(mmap_);
   xe_free(local_path_);
@@ -113,6 +115,42 @@ Entry* DiscImageDevice::ResolvePath(const char* path) {
 
   XELOGFS("DiscImageDevice::ResolvePath(%s)", path);
 
+  const char* relative_path = path;
+  while (*relative_path == '\\') {
+    relative_path++;
+  }
+
+  std::string key;
+  GDFXEntry::MakeKey(relative_path, key);
+  GDFXEntry* gdfx_entry = NULL;
+  xe_mutex_lock(path_cache_lock_);
+  PathCache::iterator it = path_cache_.find(key);
+  if (it != path_cache_.end()) {
+    gdfx_entry = it->second;
+  }
+  xe_mutex_unlock(path_cache_lock_);
+
+  if (!gdfx_entry) {
+    gdfx_entry = LookupEntry(relative_path);
+    if (!gdfx_entry) {
+      // Not found.
+      return NULL;
+    }
+    xe_mutex_lock(path_cache_lock_);
+    path_cache_.insert(PathCache::value_type(key, gdfx_entry));
+    xe_mutex_unlock(path_cache_lock_);
+  }
+
+  if (gdfx_entry->attributes & GDFXEntry::kAttrFolder) {
+    //return new DiscImageDirectoryEntry(mmap_, gdfx_entry);
+    XEASSERTALWAYS();
+    return NULL;
+  } else {
+    return new DiscImageFileEntry(this, path, mmap_, gdfx_entry);
+  }
+}
+
+GDFXEntry* DiscImageDevice::LookupEntry(const char* path) {
   GDFXEntry* gdfx_entry = gdfx_->root_entry();
 
   // Walk the path, one separator at a time.
@@ -146,11 +184,5 @@ Entry* DiscImageDevice::ResolvePath(const char* path) {
     XEIGNORE(xestrcpya(remaining, XECOUNT(remaining), next_slash + 1));
   }
 
-  if (gdfx_entry->attributes & GDFXEntry::kAttrFolder) {
-    //return new DiscImageDirectoryEntry(mmap_, gdfx_entry);
-    XEASSERTALWAYS();
-    return NULL;
-  } else {
-    return new DiscImageFileEntry(this, path, mmap_, gdfx_entry);
-  }
+  return gdfx_entry;
 }
@@ -22,6 +22,7 @@ namespace fs {
 
 
 class GDFX;
+class GDFXEntry;
 
 
 class DiscImageDevice : public Device {
@@ -34,9 +35,17 @@ public:
   virtual Entry* ResolvePath(const char* path);
 
 private:
+  GDFXEntry* LookupEntry(const char* path);
+
   xechar_t*   local_path_;
   xe_mmap_ref mmap_;
   GDFX*       gdfx_;
+
+  // Resolved entries keyed by lowercased path (without leading slashes).
+  // The GDFX tree is immutable once loaded so entries never go stale.
+  typedef std::tr1::unordered_map<std::string, GDFXEntry*> PathCache;
+  xe_mutex_t* path_cache_lock_;
+  PathCache   path_cache_;
 };
 
 
@@ -35,16 +35,27 @@ GDFXEntry::~GDFXEntry() {
   }
 }
 
-GDFXEntry* GDFXEntry::GetChild(const char* name) {
-  // TODO(benvanik): a faster search
-  for (std::vector<GDFXEntry*>::iterator it = children.begin();
-       it != children.end(); ++it) {
-    GDFXEntry* entry = *it;
-    if (xestrcasecmpa(entry->name.c_str(), name) == 0) {
-      return entry;
-    }
+void GDFXEntry::MakeKey(const char* name, std::string& key) {
+  key.clear();
+  for (const char* p = name; *p; p++) {
+    key.push_back((char)tolower((unsigned char)*p));
   }
-  return NULL;
+}
+
+void GDFXEntry::AddChild(GDFXEntry* entry) {
+  children.push_back(entry);
+
+  // name has a trailing NUL appended, so key off the C string.
+  std::string key;
+  MakeKey(entry->name.c_str(), key);
+  child_map_.insert(ChildMap::value_type(key, entry));
+}
+
+GDFXEntry* GDFXEntry::GetChild(const char* name) {
+  std::string key;
+  MakeKey(name, key);
+  ChildMap::iterator it = child_map_.find(key);
+  return it != child_map_.end() ? it->second : NULL;
 }
 
 void GDFXEntry::Dump(int indent) {
@@ -175,7 +186,7 @@ bool GDFX::ReadEntry(ParseState& state, const uint8_t* buffer,
   entry->attributes = attributes;
 
   // Add to parent.
-  parent->children.push_back(entry);
+  parent->AddChild(entry);
 
   if (attributes & GDFXEntry::kAttrFolder) {
     // Folder.
@@ -41,6 +41,10 @@ public:
   GDFXEntry();
   ~GDFXEntry();
 
+  // Lowercases name into key; all child lookups are case-insensitive.
+  static void MakeKey(const char* name, std::string& key);
+
+  void AddChild(GDFXEntry* entry);
   GDFXEntry* GetChild(const char* name);
 
   void Dump(int indent);
@@ -51,6 +55,10 @@ public:
   size_t        size;
 
   std::vector<GDFXEntry*> children;
+
+private:
+  typedef std::tr1::unordered_map<std::string, GDFXEntry*> ChildMap;
+  ChildMap      child_map_;
 };
 
 
@@ -26,8 +26,7 @@ namespace {
 
 KernelState::KernelState(Runtime* runtime) :
     runtime_(runtime),
-    executable_module_(NULL),
-    next_handle_(0) {
+    executable_module_(NULL) {
   memory_     = runtime->memory();
   processor_  = runtime->processor();
   filesystem_ = runtime->filesystem();
@@ -46,12 +45,8 @@ KernelState::~KernelState() {
   // We first copy the list to another list so that the deletion of the objects
   // doesn't mess up iteration.
   std::vector<XObject*> all_objects;
+  object_table_.GetAllObjects(all_objects);
   xe_mutex_lock(objects_mutex_);
-  for (std::tr1::unordered_map<X_HANDLE, XObject*>::iterator it =
-       objects_.begin(); it != objects_.end(); ++it) {
-    all_objects.push_back(it->second);
-  }
-  objects_.clear();
   modules_.clear();
   threads_.clear();
   xe_mutex_unlock(objects_mutex_);
@@ -86,49 +81,46 @@ fs::FileSystem* KernelState::filesystem() {
   return filesystem_.get();
 }
 
-// TODO(benvanik): invesitgate better handle storage/structure.
-// A much better way of doing handles, if performance becomes an issue, would
-// be to try to make the pointers 32bit. Then we could round-trip them through
-// PPC code without needing to keep a map.
-// To achieve this we could try doing allocs in the 32-bit address space via
-// the OS alloc calls, or maybe create a section with a reserved size at load
-// time (65k handles * 4 is more than enough?).
-// We could then use a free list of handle IDs and allocate/release lock-free.
-
 XObject* KernelState::GetObject(X_HANDLE handle) {
-  xe_mutex_lock(objects_mutex_);
-  std::tr1::unordered_map<X_HANDLE, XObject*>::iterator it =
-      objects_.find(handle);
-  XObject* value = it != objects_.end() ? it->second : NULL;
-  if (value) {
-    value->Retain();
-  }
-  xe_mutex_unlock(objects_mutex_);
-  return value;
+  return object_table_.LookupObject(handle);
 }
 
 X_HANDLE KernelState::InsertObject(XObject* obj) {
-  xe_mutex_lock(objects_mutex_);
-  X_HANDLE handle = 0x00001000 + (++next_handle_);
-  objects_.insert(std::pair<X_HANDLE, XObject*>(handle, obj));
+  X_HANDLE handle = object_table_.AddHandle(obj);
+  if (handle == X_INVALID_HANDLE_VALUE) {
+    return handle;
+  }
   switch (obj->type()) {
     case XObject::kTypeModule:
+      xe_mutex_lock(objects_mutex_);
       modules_.insert(std::pair<X_HANDLE, XModule*>(
           handle, static_cast<XModule*>(obj)));
+      xe_mutex_unlock(objects_mutex_);
       break;
     case XObject::kTypeThread:
+      xe_mutex_lock(objects_mutex_);
       threads_.insert(std::pair<X_HANDLE, XThread*>(
           handle, static_cast<XThread*>(obj)));
+      xe_mutex_unlock(objects_mutex_);
       break;
   }
-  xe_mutex_unlock(objects_mutex_);
   return handle;
 }
 
 void KernelState::RemoveObject(XObject* obj) {
-  xe_mutex_lock(objects_mutex_);
-  objects_.erase(obj->handle());
-  xe_mutex_unlock(objects_mutex_);
+  switch (obj->type()) {
+    case XObject::kTypeModule:
+      xe_mutex_lock(objects_mutex_);
+      modules_.erase(obj->handle());
+      xe_mutex_unlock(objects_mutex_);
+      break;
+    case XObject::kTypeThread:
+      xe_mutex_lock(objects_mutex_);
+      threads_.erase(obj->handle());
+      xe_mutex_unlock(objects_mutex_);
+      break;
+  }
+  object_table_.RemoveHandle(obj->handle());
 }
 
 XModule* KernelState::GetModule(const char* name) {
@@ -17,6 +17,7 @@
 #include <xenia/kernel/kernel_module.h>
 #include <xenia/kernel/xbox.h>
 #include <xenia/kernel/fs/filesystem.h>
+#include <xenia/kernel/modules/xboxkrnl/object_table.h>
 
 
 namespace xe {
@@ -56,9 +57,10 @@ private:
 
   XModule*      executable_module_;
 
+  ObjectTable   object_table_;
+
+  // Guards the by-type maps below. Handle lookups don't need it.
   xe_mutex_t* objects_mutex_;
-  X_HANDLE next_handle_;
-  std::tr1::unordered_map<X_HANDLE, XObject*> objects_;
   std::tr1::unordered_map<X_HANDLE, XModule*> modules_;
   std::tr1::unordered_map<X_HANDLE, XThread*> threads_;
 
@@ -0,0 +1,180 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/kernel/modules/xboxkrnl/object_table.h>
+
+#include <xenia/atomic.h>
+#include <xenia/kernel/modules/xboxkrnl/xobject.h>
+
+
+using namespace xe;
+using namespace xe::kernel;
+using namespace xe::kernel::xboxkrnl;
+
+
+namespace {
+
+// Handles are (generation << 18) | (index << 2). The low bits are always
+// clear like real kernel handles, so the handle can never be 0 (index 0 is
+// reserved) or X_INVALID_HANDLE_VALUE.
+const uint32_t kHandleIndexShift      = 2;
+const uint32_t kHandleIndexMask       = 0xFFFF;
+const uint32_t kHandleGenerationShift = 18;
+const int32_t  kGenerationMask        = 0x3FFF;
+
+}
+
+
+ObjectTable::ObjectTable() :
+    next_index_(0), free_list_(0) {
+  xe_zero_struct((void*)segments_, sizeof(segments_));
+}
+
+ObjectTable::~ObjectTable() {
+  for (uint32_t n = 0; n < kSegmentCount; n++) {
+    if (segments_[n]) {
+      xe_free(segments_[n]);
+    }
+  }
+}
+
+ObjectTable::Entry* ObjectTable::GetEntry(uint32_t index) {
+  Entry* segment = segments_[index >> kSegmentShift];
+  return segment ? &segment[index & (kSegmentSize - 1)] : NULL;
+}
+
+ObjectTable::Entry* ObjectTable::EnsureEntry(uint32_t index) {
+  Entry* volatile* segment_ptr = &segments_[index >> kSegmentShift];
+  if (!*segment_ptr) {
+    Entry* segment = (Entry*)xe_calloc(sizeof(Entry) * kSegmentSize);
+    if (!xe_atomic_cas_ptr(NULL, segment, segment_ptr)) {
+      // Another thread got there first.
+      xe_free(segment);
+    }
+  }
+  return GetEntry(index);
+}
+
+uint32_t ObjectTable::AllocateIndex() {
+  while (true) {
+    uint64_t head = free_list_;
+    uint32_t index = (uint32_t)head;
+    if (!index) {
+      break;
+    }
+    // next_free may be stale if the slot was popped concurrently, in which
+    // case the tag won't match and the cas fails.
+    uint64_t next = (((head >> 32) + 1) << 32) | GetEntry(index)->next_free;
+    if (xe_atomic_cas_64(head, next, &free_list_)) {
+      return index;
+    }
+  }
+
+  // Free list is empty - take a fresh slot.
+  uint32_t index = (uint32_t)xe_atomic_inc_32(&next_index_);
+  if (index >= kMaxIndex) {
+    xe_atomic_dec_32(&next_index_);
+    return 0;
+  }
+  EnsureEntry(index);
+  return index;
+}
+
+X_HANDLE ObjectTable::AddHandle(XObject* object) {
+  uint32_t index = AllocateIndex();
+  if (!index) {
+    XELOGE("Object table full");
+    return X_INVALID_HANDLE_VALUE;
+  }
+  Entry* entry = GetEntry(index);
+  // Publishes the object (and its construction) to other threads.
+  xe_atomic_cas_ptr(NULL, object, &entry->object);
+  return (entry->generation << kHandleGenerationShift) |
+         (index << kHandleIndexShift);
+}
+
+void ObjectTable::RemoveHandle(X_HANDLE handle) {
+  // Objects that failed to get a handle (table full) still end up here.
+  if (handle == X_INVALID_HANDLE_VALUE) {
+    return;
+  }
+  uint32_t index = (handle >> kHandleIndexShift) & kHandleIndexMask;
+  Entry* entry = index ? GetEntry(index) : NULL;
+  XEASSERTNOTNULL(entry);
+  if (!entry) {
+    return;
+  }
+  // A stale handle would put the slot on the free list twice.
+  XEASSERT(entry->generation == (int32_t)(handle >> kHandleGenerationShift));
+  if (entry->generation != (int32_t)(handle >> kHandleGenerationShift)) {
+    return;
+  }
+
+  // Clear the slot and invalidate outstanding handles, then wait for any
+  // lookup that may have read the old pointer to finish with it. The caller
+  // is usually the object destructor, so the memory is still valid until
+  // this returns.
+  XObject* object = entry->object;
+  xe_atomic_cas_ptr(object, NULL, &entry->object);
+  int32_t generation = entry->generation;
+  xe_atomic_cas_32(generation, (generation + 1) & kGenerationMask,
+                   &entry->generation);
+  while (entry->pins) {
+    xe_thread_yield();
+  }
+
+  while (true) {
+    uint64_t head = free_list_;
+    entry->next_free = (uint32_t)head;
+    uint64_t next = (head & 0xFFFFFFFF00000000ull) | index;
+    if (xe_atomic_cas_64(head, next, &free_list_)) {
+      break;
+    }
+  }
+}
+
+XObject* ObjectTable::LookupObject(X_HANDLE handle) {
+  if (handle & ((1 << kHandleIndexShift) - 1)) {
+    return NULL;
+  }
+  uint32_t index = (handle >> kHandleIndexShift) & kHandleIndexMask;
+  Entry* entry = GetEntry(index);
+  if (!entry) {
+    return NULL;
+  }
+
+  // The pin is a full barrier: either RemoveHandle sees it and waits, or
+  // this sees the cleared slot/new generation.
+  XObject* object = NULL;
+  xe_atomic_inc_32(&entry->pins);
+  if (entry->generation == (int32_t)(handle >> kHandleGenerationShift)) {
+    object = entry->object;
+    if (object && !object->TryRetain()) {
+      // Last reference already dropped; it's on its way out.
+      object = NULL;
+    }
+  }
+  xe_atomic_dec_32(&entry->pins);
+  return object;
+}
+
+void ObjectTable::GetAllObjects(std::vector<XObject*>& objects) {
+  for (uint32_t n = 0; n < kSegmentCount; n++) {
+    Entry* segment = segments_[n];
+    if (!segment) {
+      continue;
+    }
+    for (uint32_t m = 0; m < kSegmentSize; m++) {
+      XObject* object = segment[m].object;
+      if (object) {
+        objects.push_back(object);
+      }
+    }
+  }
+}
@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_MODULES_XBOXKRNL_OBJECT_TABLE_H_
+#define XENIA_KERNEL_MODULES_XBOXKRNL_OBJECT_TABLE_H_
+
+#include <xenia/common.h>
+#include <xenia/core.h>
+
+#include <xenia/kernel/xbox.h>
+
+#include <vector>
+
+
+namespace xe {
+namespace kernel {
+namespace xboxkrnl {
+
+
+class XObject;
+
+
+// Maps guest handles to objects without taking a lock on lookup.
+// A handle encodes a slot index and the slot's generation, which is bumped
+// every time the slot is freed so stale handles fail to resolve instead of
+// aliasing a newer object. Slots live in lazily allocated segments that are
+// never moved or freed until the table is destroyed, and freed slots are
+// recycled through a lock-free free list.
+class ObjectTable {
+public:
+  ObjectTable();
+  ~ObjectTable();
+
+  // Returns X_INVALID_HANDLE_VALUE if the table is full.
+  X_HANDLE AddHandle(XObject* object);
+  void RemoveHandle(X_HANDLE handle);
+
+  // Returns the object with a reference held, or NULL if the handle is stale
+  // or the object is being destroyed.
+  XObject* LookupObject(X_HANDLE handle);
+
+  // Only safe when no other thread is using the table.
+  void GetAllObjects(std::vector<XObject*>& objects);
+
+private:
+  typedef struct {
+    XObject* volatile   object;
+    volatile int32_t    generation;
+    // Number of lookups currently reading object.
+    volatile int32_t    pins;
+    uint32_t            next_free;
+  } Entry;
+
+  Entry* GetEntry(uint32_t index);
+  Entry* EnsureEntry(uint32_t index);
+  uint32_t AllocateIndex();
+
+  static const uint32_t kSegmentShift   = 10;
+  static const uint32_t kSegmentSize    = 1 << kSegmentShift;
+  static const uint32_t kSegmentCount   = 64;
+  static const uint32_t kMaxIndex       = kSegmentSize * kSegmentCount;
+
+  Entry* volatile       segments_[kSegmentCount];
+  volatile int32_t      next_index_;
+  // (tag << 32) | index of the first free slot (0 = empty). The tag changes
+  // on every pop to avoid ABA.
+  volatile uint64_t     free_list_;
+};
+
+
+}  // namespace xboxkrnl
+}  // namespace kernel
+}  // namespace xe
+
+
+#endif  // XENIA_KERNEL_MODULES_XBOXKRNL_OBJECT_TABLE_H_
@@ -55,6 +55,18 @@ void XObject::Retain() {
   xe_atomic_inc_32(&ref_count_);
 }
 
+bool XObject::TryRetain() {
+  while (true) {
+    int32_t ref_count = ref_count_;
+    if (!ref_count) {
+      return false;
+    }
+    if (xe_atomic_cas_32(ref_count, ref_count + 1, &ref_count_)) {
+      return true;
+    }
+  }
+}
+
 void XObject::Release() {
   if (!xe_atomic_dec_32(&ref_count_)) {
     delete this;
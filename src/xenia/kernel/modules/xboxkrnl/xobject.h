@@ -43,6 +43,9 @@ public:
   X_HANDLE handle();
 
   void Retain();
+  // Retains only if the object is still live (reference count above zero).
+  // Used by lock-free lookups that may race with the final Release.
+  bool TryRetain();
   void Release();
 
 protected:
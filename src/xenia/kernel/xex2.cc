@@ -8,11 +8,10 @@
  */
 
 #include <xenia/kernel/xex2.h>
+#include <xenia/kernel/xex2_aes.h>
 
 #include <vector>
 
-#include <third_party/crypto/rijndael-alg-fst.h>
-#include <third_party/crypto/rijndael-alg-fst.c>
 #include <third_party/mspack/lzx.h>
 #include <third_party/mspack/lzxd.c>
 #include <third_party/mspack/mspack.h>
@@ -422,10 +421,10 @@ int xe_xex2_decrypt_key(xe_xex2_header_t *header) {
   }
 
   // Decrypt the header key.
-  uint32_t rk[4 * (MAXNR + 1)];
-  int32_t Nr = rijndaelKeySetupDec(rk, xexkey, 128);
-  rijndaelDecrypt(rk, Nr,
-                  header->loader_info.file_key, header->session_key);
+  xe_xex2_aes_t aes;
+  xe_xex2_aes_init(&aes, xexkey);
+  xe_xex2_aes_decrypt_block(&aes,
+                            header->loader_info.file_key, header->session_key);
 
   return 0;
 }
@@ -505,25 +504,36 @@ void mspack_memory_sys_destroy(struct mspack_system *sys) {
   xe_free(sys);
 }
 
+// Decrypts length bytes of a CBC stream, which need not be a multiple of 16.
+// A trailing partial block is decrypted as a full one using the ciphertext
+// that follows it (zeros past input_available) and only its first bytes are
+// kept, like the block-at-a-time loop this replaced but without touching
+// memory past either buffer.
+void xe_xex2_decrypt_cbc_partial(const xe_xex2_aes_t *aes, uint8_t ivec[16],
+                                 const uint8_t *input,
+                                 const size_t input_available,
+                                 uint8_t *output, const size_t length) {
+  const size_t full_length = length & ~0xF;
+  xe_xex2_aes_decrypt_cbc(aes, ivec, input, output, full_length);
+  if (full_length == length) {
+    return;
+  }
+  uint8_t block[16] = {0};
+  xe_copy_struct(block, input + full_length,
+                 MIN(input_available - full_length, sizeof(block)));
+  xe_xex2_aes_decrypt_cbc(aes, ivec, block, block, sizeof(block));
+  xe_copy_struct(output + full_length, block, length - full_length);
+}
+
 void xe_xex2_decrypt_buffer(const uint8_t *session_key,
                             const uint8_t *input_buffer,
                             const size_t input_size, uint8_t* output_buffer,
                             const size_t output_size) {
-  uint32_t rk[4 * (MAXNR + 1)];
+  xe_xex2_aes_t aes;
   uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, session_key, 128);
-  const uint8_t *ct = input_buffer;
-  uint8_t* pt = output_buffer;
-  for (size_t n = 0; n < input_size; n += 16, ct += 16, pt += 16) {
-    // Decrypt 16 uint8_ts from input -> output.
-    rijndaelDecrypt(rk, Nr, ct, pt);
-    for (size_t i = 0; i < 16; i++) {
-      // XOR with previous.
-      pt[i] ^= ivec[i];
-      // Set previous.
-      ivec[i] = ct[i];
-    }
-  }
+  xe_xex2_aes_init(&aes, session_key);
+  xe_xex2_decrypt_cbc_partial(&aes, ivec, input_buffer, input_size,
+                              output_buffer, MIN(input_size, output_size));
 }
 
 int xe_xex2_read_image_uncompressed(const xe_xex2_header_t *header,
@@ -569,8 +579,14 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t *header,
   const uint8_t* source_buffer = (const uint8_t*)xex_addr + header->exe_offset;
   const uint8_t *p = source_buffer;
 
-  // Calculate uncompressed length.
   size_t uncompressed_size = 0;
+  uint32_t alloc_result = 0;
+  uint8_t *buffer = NULL;
+  uint8_t *d = NULL;
+  xe_xex2_aes_t aes;
+  uint8_t ivec[16] = {0};
+
+  // Calculate uncompressed length.
   const xe_xex2_file_basic_compression_info_t* comp_info =
       &header->file_format_info.compression_info.basic;
   for (size_t n = 0; n < comp_info->block_count; n++) {
@@ -580,7 +596,7 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t *header,
   }
 
   // Allocate in-place the XEX memory.
-  uint32_t alloc_result =
+  alloc_result =
       xe_memory_heap_alloc(memory,
                            header->exe_address, (uint32_t)uncompressed_size,
                            0);
@@ -589,12 +605,10 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t *header,
            header->exe_address, uncompressed_size);
     XEFAIL();
   }
-  uint8_t *buffer = (uint8_t*)xe_memory_addr(memory, header->exe_address);
-  uint8_t *d = buffer;
+  buffer = (uint8_t*)xe_memory_addr(memory, header->exe_address);
+  d = buffer;
 
-  uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, header->session_key, 128);
+  xe_xex2_aes_init(&aes, header->session_key);
 
   for (size_t n = 0; n < comp_info->block_count; n++) {
     const size_t data_size = comp_info->blocks[n].data_size;
@@ -606,20 +620,10 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t *header,
                                   exe_length - (p - source_buffer)));
       break;
     case XEX_ENCRYPTION_NORMAL:
-      {
-        const uint8_t *ct = p;
-        uint8_t* pt = d;
-        for (size_t n = 0; n < data_size; n += 16, ct += 16, pt += 16) {
-          // Decrypt 16 uint8_ts from input -> output.
-          rijndaelDecrypt(rk, Nr, ct, pt);
-          for (size_t i = 0; i < 16; i++) {
-            // XOR with previous.
-            pt[i] ^= ivec[i];
-            // Set previous.
-            ivec[i] = ct[i];
-          }
-        }
-      }
+      // CBC continues across blocks.
+      xe_xex2_decrypt_cbc_partial(&aes, ivec, p,
+                                  exe_length - (p - source_buffer), d,
+                                  data_size);
       break;
     default:
       XEASSERTALWAYS();
@@ -636,6 +640,111 @@ XECLEANUP:
   return 1;
 }
 
+// Presents the compressed data of an XEX as a plain stream to mspack.
+// The file data is a chain of blocks:
+//    4b total size of next block in uint8_ts
+//   20b hash of entire next block (including size/hash)
+//    Nb chunks of compressed data, each prefixed by a 2b size, terminated by
+//       a zero size
+// Blocks are decrypted (if needed) one at a time into a scratch buffer as
+// mspack reads, so memory use is bounded by the largest block rather than
+// the size of the image.
+typedef struct {
+  const uint8_t *source;
+  size_t        source_length;
+  size_t        source_offset;
+
+  bool          encrypted;
+  xe_xex2_aes_t aes;
+  uint8_t       ivec[16];
+
+  uint8_t       *block;
+  size_t        block_capacity;
+  size_t        block_size;
+  size_t        next_block_size;
+  size_t        cursor;
+  size_t        chunk_remaining;
+} xe_xex2_block_reader_t;
+
+int xe_xex2_block_reader_load(xe_xex2_block_reader_t *reader) {
+  const size_t block_size = reader->next_block_size;
+  if (block_size < 24 ||
+      reader->source_offset + block_size > reader->source_length ||
+      (reader->encrypted && (block_size & 0xF))) {
+    XELOGE("XEX compressed block out of range at %.8X (%db)",
+           (uint32_t)reader->source_offset, (uint32_t)block_size);
+    return 1;
+  }
+  if (block_size > reader->block_capacity) {
+    reader->block = (uint8_t*)xe_realloc(
+        reader->block, reader->block_capacity, block_size);
+    if (!reader->block) {
+      return 1;
+    }
+    reader->block_capacity = block_size;
+  }
+
+  const uint8_t *ct = reader->source + reader->source_offset;
+  if (reader->encrypted) {
+    // CBC continues across blocks.
+    xe_xex2_aes_decrypt_cbc(&reader->aes, reader->ivec,
+                            ct, reader->block, block_size);
+  } else {
+    xe_copy_memory(reader->block, reader->block_capacity, ct, block_size);
+  }
+
+  reader->source_offset += block_size;
+  reader->block_size = block_size;
+  reader->next_block_size = XEGETUINT32BE(reader->block);
+  reader->cursor = 4 + 20; // skip size and 20b hash
+  reader->chunk_remaining = 0;
+  return 0;
+}
+
+int xe_xex2_block_reader_read(struct mspack_file *file, void *buffer,
+                              int chars) {
+  xe_xex2_block_reader_t *reader = (xe_xex2_block_reader_t*)file;
+  uint8_t *d = (uint8_t*)buffer;
+  int total = 0;
+  while (total < chars) {
+    if (reader->chunk_remaining) {
+      const size_t count = MIN(reader->chunk_remaining,
+                               (size_t)(chars - total));
+      xe_copy_memory(d + total, chars - total,
+                     reader->block + reader->cursor, count);
+      reader->cursor += count;
+      reader->chunk_remaining -= count;
+      total += (int)count;
+      continue;
+    }
+
+    // Next chunk, moving on to the next block if this one is done.
+    if (!reader->block_size || reader->cursor + 2 > reader->block_size) {
+      if (!reader->next_block_size) {
+        // End of data.
+        break;
+      }
+      if (xe_xex2_block_reader_load(reader)) {
+        return -1;
+      }
+    }
+    const uint8_t *p = reader->block + reader->cursor;
+    const size_t chunk_size = (p[0] << 8) | p[1];
+    reader->cursor += 2;
+    if (!chunk_size) {
+      // Terminator - force the next block to load.
+      reader->cursor = reader->block_size;
+      continue;
+    }
+    if (reader->cursor + chunk_size > reader->block_size) {
+      XELOGE("XEX compressed chunk overruns its block");
+      return -1;
+    }
+    reader->chunk_remaining = chunk_size;
+  }
+  return total;
+}
+
 int xe_xex2_read_image_compressed(const xe_xex2_header_t *header,
                                   const uint8_t *xex_addr,
                                   const size_t xex_length,
@@ -644,82 +753,39 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t *header,
   const uint8_t *exe_buffer = (const uint8_t*)xex_addr + header->exe_offset;
 
   // src -> dest:
-  // - decrypt (if encrypted)
-  // - de-block:
-  //    4b total size of next block in uint8_ts
-  //   20b hash of entire next block (including size/hash)
-  //    Nb block uint8_ts
-  // - decompress block contents
+  // - decrypt (if encrypted) and de-block incrementally
+  // - decompress straight into the guest image
 
   int result_code = 1;
 
-  uint8_t *compress_buffer = NULL;
-  const uint8_t *p = NULL;
-  uint8_t *d = NULL;
-  uint8_t *deblock_buffer = NULL;
-  size_t block_size = 0;
-  size_t uncompressed_size = 0;
+  const size_t uncompressed_size = header->loader_info.image_size;
+  uint32_t alloc_result = 0;
+  uint8_t *buffer = NULL;
   struct mspack_system *sys = NULL;
-  mspack_memory_file *lzxsrc = NULL;
+  xe_xex2_block_reader_t *lzxsrc = NULL;
   mspack_memory_file *lzxdst = NULL;
   struct lzxd_stream *lzxd = NULL;
 
-  // Decrypt (if needed).
-  bool free_input = false;
-  const uint8_t *input_buffer = exe_buffer;
-  const size_t input_size = exe_length;
+  lzxsrc = (xe_xex2_block_reader_t*)xe_calloc(sizeof(xe_xex2_block_reader_t));
+  XEEXPECTNOTNULL(lzxsrc);
+  lzxsrc->source          = exe_buffer;
+  lzxsrc->source_length   = exe_length;
+  lzxsrc->next_block_size =
+      header->file_format_info.compression_info.normal.block_size;
   switch (header->file_format_info.encryption_type) {
   case XEX_ENCRYPTION_NONE:
-    // No-op.
     break;
   case XEX_ENCRYPTION_NORMAL:
-    // TODO: a way to do without a copy/alloc?
-    free_input = true;
-    input_buffer = (const uint8_t*)xe_calloc(input_size);
-    XEEXPECTNOTNULL(input_buffer);
-    xe_xex2_decrypt_buffer(header->session_key, exe_buffer, exe_length,
-                           (uint8_t*)input_buffer, input_size);
+    lzxsrc->encrypted = true;
+    xe_xex2_aes_init(&lzxsrc->aes, header->session_key);
     break;
   default:
     XEASSERTALWAYS();
-    return false;
-  }
-
-  compress_buffer = (uint8_t*)xe_calloc(exe_length);
-  XEEXPECTNOTNULL(compress_buffer);
-
-  p = input_buffer;
-  d = compress_buffer;
-
-  // De-block.
-  deblock_buffer = (uint8_t*)xe_calloc(input_size);
-  XEEXPECTNOTNULL(deblock_buffer);
-  block_size = header->file_format_info.compression_info.normal.block_size;
-  while (block_size) {
-    const uint8_t *pnext = p + block_size;
-    const size_t next_size = XEGETINT32BE(p);
-    p += 4;
-    p += 20; // skip 20b hash
-
-    while(true) {
-      const size_t chunk_size = (p[0] << 8) | p[1];
-      p += 2;
-      if (!chunk_size) {
-        break;
-      }
-      xe_copy_memory(d, exe_length - (d - compress_buffer), p, chunk_size);
-      p += chunk_size;
-      d += chunk_size;
-
-      uncompressed_size += 0x8000;
-    }
-
-    p = pnext;
-    block_size = next_size;
+    XEFAIL();
   }
 
   // Allocate in-place the XEX memory.
-  uint32_t alloc_result =
+  alloc_result =
       xe_memory_heap_alloc(memory,
                            header->exe_address, (uint32_t)uncompressed_size,
                            0);
@@ -729,13 +795,12 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t *header,
     result_code = 2;
     XEFAIL();
   }
-  uint8_t *buffer = (uint8_t*)xe_memory_addr(memory, header->exe_address);
+  buffer = (uint8_t*)xe_memory_addr(memory, header->exe_address);
 
   // Setup decompressor and decompress.
   sys = mspack_memory_sys_create();
   XEEXPECTNOTNULL(sys);
-  lzxsrc = mspack_memory_open(sys, (void*)compress_buffer, d - compress_buffer);
-  XEEXPECTNOTNULL(lzxsrc);
+  sys->read = xe_xex2_block_reader_read;
   lzxdst = mspack_memory_open(sys, buffer, uncompressed_size);
   XEEXPECTNOTNULL(lzxdst);
   lzxd = lzxd_init(
@@ -757,7 +822,8 @@ XECLEANUP:
     lzxd = NULL;
   }
   if (lzxsrc) {
-    mspack_memory_close(lzxsrc);
+    xe_free(lzxsrc->block);
+    xe_free(lzxsrc);
     lzxsrc = NULL;
   }
   if (lzxdst) {
@@ -768,11 +834,6 @@ XECLEANUP:
     mspack_memory_sys_destroy(sys);
     sys = NULL;
   }
-  xe_free(compress_buffer);
-  xe_free(deblock_buffer);
-  if (free_input) {
-    xe_free((void*)input_buffer);
-  }
   return result_code;
 }
 
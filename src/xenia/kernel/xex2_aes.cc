@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/kernel/xex2_aes.h>
+
+#include <third_party/crypto/rijndael-alg-fst.h>
+#include <third_party/crypto/rijndael-alg-fst.c>
+
+#include <wmmintrin.h>
+#if XE_COMPILER(MSVC)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif  // MSVC
+
+
+// The AES-NI functions are compiled for the instruction set explicitly so
+// that the rest of the build doesn't require it; they're only called after
+// checking CPUID.
+#if XE_COMPILER(MSVC)
+#define XE_AESNI_TARGET
+#else
+#define XE_AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif  // MSVC
+
+
+namespace {
+
+XE_AESNI_TARGET
+__m128i xe_xex2_aesni_expand(__m128i key, __m128i assist) {
+  assist = _mm_shuffle_epi32(assist, 0xFF);
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+XE_AESNI_TARGET
+void xe_xex2_aesni_key_setup(xe_xex2_aes_t *aes, const uint8_t key[16]) {
+  __m128i ek[11];
+  ek[0] = _mm_loadu_si128((const __m128i*)key);
+  // aeskeygenassist needs the round constant as an immediate.
+#define EXPAND(n, rcon) \
+  ek[n] = xe_xex2_aesni_expand( \
+      ek[n - 1], _mm_aeskeygenassist_si128(ek[n - 1], rcon))
+  EXPAND(1, 0x01);
+  EXPAND(2, 0x02);
+  EXPAND(3, 0x04);
+  EXPAND(4, 0x08);
+  EXPAND(5, 0x10);
+  EXPAND(6, 0x20);
+  EXPAND(7, 0x40);
+  EXPAND(8, 0x80);
+  EXPAND(9, 0x1B);
+  EXPAND(10, 0x36);
+#undef EXPAND
+
+  // The equivalent inverse cipher runs the schedule backwards with
+  // InvMixColumns applied to the middle round keys.
+  _mm_storeu_si128((__m128i*)aes->dk[0], ek[10]);
+  for (int n = 1; n < 10; n++) {
+    _mm_storeu_si128((__m128i*)aes->dk[n], _mm_aesimc_si128(ek[10 - n]));
+  }
+  _mm_storeu_si128((__m128i*)aes->dk[10], ek[0]);
+}
+
+XE_AESNI_TARGET
+void xe_xex2_aesni_decrypt_cbc(const xe_xex2_aes_t *aes, uint8_t ivec[16],
+                               const uint8_t *input, uint8_t *output,
+                               size_t length) {
+  __m128i dk[11];
+  for (int n = 0; n < 11; n++) {
+    dk[n] = _mm_loadu_si128((const __m128i*)aes->dk[n]);
+  }
+  __m128i iv = _mm_loadu_si128((const __m128i*)ivec);
+
+  // Unlike encryption, CBC decryption has no dependency between blocks, so
+  // four are kept in flight to cover the aesdec latency.
+  size_t n = 0;
+  for (; n + 64 <= length; n += 64) {
+    const __m128i c0 = _mm_loadu_si128((const __m128i*)(input + n + 0));
+    const __m128i c1 = _mm_loadu_si128((const __m128i*)(input + n + 16));
+    const __m128i c2 = _mm_loadu_si128((const __m128i*)(input + n + 32));
+    const __m128i c3 = _mm_loadu_si128((const __m128i*)(input + n + 48));
+    __m128i b0 = _mm_xor_si128(c0, dk[0]);
+    __m128i b1 = _mm_xor_si128(c1, dk[0]);
+    __m128i b2 = _mm_xor_si128(c2, dk[0]);
+    __m128i b3 = _mm_xor_si128(c3, dk[0]);
+    for (int r = 1; r < 10; r++) {
+      b0 = _mm_aesdec_si128(b0, dk[r]);
+      b1 = _mm_aesdec_si128(b1, dk[r]);
+      b2 = _mm_aesdec_si128(b2, dk[r]);
+      b3 = _mm_aesdec_si128(b3, dk[r]);
+    }
+    b0 = _mm_aesdeclast_si128(b0, dk[10]);
+    b1 = _mm_aesdeclast_si128(b1, dk[10]);
+    b2 = _mm_aesdeclast_si128(b2, dk[10]);
+    b3 = _mm_aesdeclast_si128(b3, dk[10]);
+    _mm_storeu_si128((__m128i*)(output + n + 0), _mm_xor_si128(b0, iv));
+    _mm_storeu_si128((__m128i*)(output + n + 16), _mm_xor_si128(b1, c0));
+    _mm_storeu_si128((__m128i*)(output + n + 32), _mm_xor_si128(b2, c1));
+    _mm_storeu_si128((__m128i*)(output + n + 48), _mm_xor_si128(b3, c2));
+    iv = c3;
+  }
+  for (; n < length; n += 16) {
+    const __m128i c = _mm_loadu_si128((const __m128i*)(input + n));
+    __m128i b = _mm_xor_si128(c, dk[0]);
+    for (int r = 1; r < 10; r++) {
+      b = _mm_aesdec_si128(b, dk[r]);
+    }
+    b = _mm_aesdeclast_si128(b, dk[10]);
+    _mm_storeu_si128((__m128i*)(output + n), _mm_xor_si128(b, iv));
+    iv = c;
+  }
+
+  _mm_storeu_si128((__m128i*)ivec, iv);
+}
+
+}  // namespace
+
+
+bool xe_xex2_aes_has_aesni() {
+  static int has_aesni = -1;
+  if (has_aesni == -1) {
+#if XE_COMPILER(MSVC)
+    int info[4];
+    __cpuid(info, 1);
+    has_aesni = (info[2] >> 25) & 1;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    has_aesni = __get_cpuid(1, &eax, &ebx, &ecx, &edx) ?
+        (ecx >> 25) & 1 : 0;
+#endif  // MSVC
+  }
+  return has_aesni != 0;
+}
+
+void xe_xex2_aes_init(xe_xex2_aes_t *aes, const uint8_t key[16],
+                      bool allow_aesni) {
+  xe_zero_struct(aes, sizeof(xe_xex2_aes_t));
+  aes->use_aesni = allow_aesni && xe_xex2_aes_has_aesni();
+  if (aes->use_aesni) {
+    xe_xex2_aesni_key_setup(aes, key);
+  } else {
+    aes->Nr = rijndaelKeySetupDec(aes->rk, key, 128);
+  }
+}
+
+void xe_xex2_aes_decrypt_block(const xe_xex2_aes_t *aes,
+                               const uint8_t input[16], uint8_t output[16]) {
+  if (aes->use_aesni) {
+    uint8_t ivec[16] = {0};
+    xe_xex2_aesni_decrypt_cbc(aes, ivec, input, output, 16);
+  } else {
+    rijndaelDecrypt(aes->rk, aes->Nr, input, output);
+  }
+}
+
+void xe_xex2_aes_decrypt_cbc(const xe_xex2_aes_t *aes, uint8_t ivec[16],
+                             const uint8_t *input, uint8_t *output,
+                             size_t length) {
+  XEASSERTZERO(length & 0xF);
+  if (aes->use_aesni) {
+    xe_xex2_aesni_decrypt_cbc(aes, ivec, input, output, length);
+    return;
+  }
+
+  const uint8_t *ct = input;
+  uint8_t *pt = output;
+  uint8_t block[16];
+  for (size_t n = 0; n < length; n += 16, ct += 16, pt += 16) {
+    // Decrypt 16 uint8_ts from input -> output.
+    rijndaelDecrypt(aes->rk, aes->Nr, ct, block);
+    for (size_t i = 0; i < 16; i++) {
+      // XOR with previous and set previous. Done through a temporary so
+      // that in-place decryption works.
+      const uint8_t c = ct[i];
+      pt[i] = block[i] ^ ivec[i];
+      ivec[i] = c;
+    }
+  }
+}
@@ -0,0 +1,46 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_KERNEL_XEX2_AES_H_
+#define XENIA_KERNEL_XEX2_AES_H_
+
+#include <xenia/common.h>
+
+
+// AES-128 decryption as used by XEX files (ECB for the session key, CBC with
+// a zero IV for image data). Uses AES-NI when the host supports it and the
+// portable table-based implementation otherwise.
+typedef struct {
+  bool      use_aesni;
+  // Table-based schedule (rijndaelKeySetupDec).
+  int32_t   Nr;
+  uint32_t  rk[4 * (14 + 1)];
+  // AES-NI decryption schedule, already run through aesimc.
+  uint8_t   dk[11][16];
+} xe_xex2_aes_t;
+
+
+bool xe_xex2_aes_has_aesni();
+
+// allow_aesni = false forces the table-based implementation.
+void xe_xex2_aes_init(xe_xex2_aes_t *aes, const uint8_t key[16],
+                      bool allow_aesni = true);
+
+void xe_xex2_aes_decrypt_block(const xe_xex2_aes_t *aes,
+                               const uint8_t input[16], uint8_t output[16]);
+
+// Decrypts length bytes (a multiple of 16). ivec is updated to the last
+// ciphertext block so that calls can be chained over a stream.
+// input and output may be the same buffer.
+void xe_xex2_aes_decrypt_cbc(const xe_xex2_aes_t *aes, uint8_t ivec[16],
+                             const uint8_t *input, uint8_t *output,
+                             size_t length);
+
+
+#endif  // XENIA_KERNEL_XEX2_AES_H_
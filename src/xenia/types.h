@@ -77,6 +77,16 @@ using std::tr1::shared_ptr;
 #endif  // MSVC
 typedef XECACHEALIGN volatile void xe_aligned_void_t;
 
+#if XE_COMPILER(MSVC)
+// http://msdn.microsoft.com/en-us/library/9w1sdazb.aspx
+#define XETHREADLOCAL           __declspec(thread)
+#elif XE_COMPILER(GNUC)
+// http://gcc.gnu.org/onlinedocs/gcc/Thread-Local.html
+#define XETHREADLOCAL           __thread
+#else
+#define XETHREADLOCAL
+#endif  // MSVC
+
 #if XE_COMPILER(MSVC)
 // http://msdn.microsoft.com/en-us/library/ms175773.aspx
 #define XECOUNT(array)          _countof(array)
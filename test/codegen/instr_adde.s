@@ -0,0 +1,13 @@
+# REGISTER_IN r10 0xFFFFFFFFFFFFFFFF
+# REGISTER_IN r11 0xFFFFFFFFFFFFFFFF
+# REGISTER_IN r12 0x0000000000000000
+# REGISTER_IN r13 0x0000000000000001
+
+addc r4, r11, r13
+adde r3, r10, r12
+addze r5, r0
+
+blr
+# REGISTER_OUT r3 0x0000000000000000
+# REGISTER_OUT r4 0x0000000000000000
+# REGISTER_OUT r5 0x0000000000000001
@@ -0,0 +1,15 @@
+# REGISTER_IN r10 0x0000000000000000
+# REGISTER_IN r11 0x0000000000000005
+
+addme r3, r10
+addze r4, r0
+addic r6, r11, -1
+addme r7, r10
+addze r8, r0
+
+blr
+# REGISTER_OUT r3 0xFFFFFFFFFFFFFFFF
+# REGISTER_OUT r4 0x0000000000000000
+# REGISTER_OUT r6 0x0000000000000004
+# REGISTER_OUT r7 0x0000000000000000
+# REGISTER_OUT r8 0x0000000000000001
@@ -0,0 +1,45 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x00000000C0C1C2C3
+# REGISTER_IN r11 0x00000000C4C5C6C7
+# REGISTER_IN r12 0x00000000C8C9CACB
+# REGISTER_IN r13 0x00000000CCCDCECF
+# REGISTER_IN r14 0x00000000D0D1D2D3
+# REGISTER_IN r15 0x00000000D4D5D6D7
+# REGISTER_IN r16 0x00000000D8D9DADB
+# REGISTER_IN r17 0x00000000DCDDDEDF
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+stw r14, 16(r4)
+stw r15, 20(r4)
+stw r16, 24(r4)
+stw r17, 28(r4)
+
+li r30, 5
+lvrx v3, r4, r30
+li r31, 27
+lvrx v4, r4, r31
+
+stvx v3, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+stvx v4, 0, r9
+lwz r14, 0(r9)
+lwz r15, 4(r9)
+lwz r16, 8(r9)
+lwz r17, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x0000000000000000
+# REGISTER_OUT r11 0x0000000000000000
+# REGISTER_OUT r12 0x00000000000000C0
+# REGISTER_OUT r13 0x00000000C1C2C3C4
+# REGISTER_OUT r14 0x0000000000000000
+# REGISTER_OUT r15 0x0000000000D0D1D2
+# REGISTER_OUT r16 0x00000000D3D4D5D6
+# REGISTER_OUT r17 0x00000000D7D8D9DA
@@ -0,0 +1,14 @@
+# REGISTER_IN r3 0x0123456789ABCDEF
+# REGISTER_IN r4 0x0000000082010100
+
+std r3, 0(r4)
+ld r5, 0(r4)
+lbz r6, 0(r4)
+lbz r7, 7(r4)
+lwz r8, 4(r4)
+
+blr
+# REGISTER_OUT r5 0x0123456789ABCDEF
+# REGISTER_OUT r6 0x0000000000000001
+# REGISTER_OUT r7 0x00000000000000EF
+# REGISTER_OUT r8 0x0000000089ABCDEF
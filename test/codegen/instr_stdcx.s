@@ -0,0 +1,21 @@
+# REGISTER_IN r3 0x0000000082010100
+# REGISTER_IN r4 0x0123456789ABCDEF
+
+std r4, 0(r3)
+ldarx r5, 0, r3
+addi r5, r5, 1
+stdcx. r5, 0, r3
+bne 1f
+li r6, 1
+1:
+stdcx. r4, 0, r3
+bne 2f
+li r8, 1
+2:
+ld r7, 0(r3)
+
+blr
+# REGISTER_OUT r5 0x0123456789ABCDF0
+# REGISTER_OUT r6 0x0000000000000001
+# REGISTER_OUT r7 0x0123456789ABCDF0
+# REGISTER_OUT r8 0x0000000000000000
@@ -0,0 +1,12 @@
+# REGISTER_IN r3 0xFFFFFFFFFFFF89AB
+# REGISTER_IN r4 0x0000000082010100
+
+sth r3, 0(r4)
+lhz r5, 0(r4)
+lbz r6, 0(r4)
+lha r7, 0(r4)
+
+blr
+# REGISTER_OUT r5 0x00000000000089AB
+# REGISTER_OUT r6 0x0000000000000089
+# REGISTER_OUT r7 0xFFFFFFFFFFFF89AB
@@ -0,0 +1,12 @@
+# REGISTER_IN r3 0xFFFFFFFF89ABCDEF
+# REGISTER_IN r4 0x0000000082010100
+
+stw r3, 0(r4)
+lwz r5, 0(r4)
+lbz r6, 0(r4)
+lbz r7, 3(r4)
+
+blr
+# REGISTER_OUT r5 0x0000000089ABCDEF
+# REGISTER_OUT r6 0x0000000000000089
+# REGISTER_OUT r7 0x00000000000000EF
@@ -0,0 +1,13 @@
+# REGISTER_IN r10 0x0000000000000000
+# REGISTER_IN r11 0xFFFFFFFFFFFFFFFF
+
+subfme r3, r10
+addze r4, r0
+subfme r5, r11
+addze r6, r0
+
+blr
+# REGISTER_OUT r3 0xFFFFFFFFFFFFFFFE
+# REGISTER_OUT r4 0x0000000000000001
+# REGISTER_OUT r5 0xFFFFFFFFFFFFFFFF
+# REGISTER_OUT r6 0x0000000000000000
@@ -0,0 +1,15 @@
+# REGISTER_IN r10 0x0000000000000000
+# REGISTER_IN r11 0x0000000000000001
+
+subfze r3, r10
+addze r4, r0
+addic r5, r11, -1
+subfze r6, r10
+addze r7, r0
+
+blr
+# REGISTER_OUT r3 0xFFFFFFFFFFFFFFFF
+# REGISTER_OUT r4 0x0000000000000000
+# REGISTER_OUT r5 0x0000000000000000
+# REGISTER_OUT r6 0x0000000000000000
+# REGISTER_OUT r7 0x0000000000000001
@@ -0,0 +1,72 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r5 0x0000000082010810
+# REGISTER_IN r6 0x0000000082010820
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x000000003F800000
+# REGISTER_IN r11 0x0000000040000000
+# REGISTER_IN r12 0x0000000040400000
+# REGISTER_IN r13 0x0000000040800000
+# REGISTER_IN r14 0x000000003F800000
+# REGISTER_IN r15 0x0000000040000000
+# REGISTER_IN r16 0x0000000040400000
+# REGISTER_IN r17 0x0000000040800000
+# REGISTER_IN r18 0x000000003F800000
+# REGISTER_IN r19 0x0000000000000000
+# REGISTER_IN r20 0x0000000040400000
+# REGISTER_IN r21 0x00000000C0800000
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+stw r14, 16(r4)
+stw r15, 20(r4)
+stw r16, 24(r4)
+stw r17, 28(r4)
+stw r18, 32(r4)
+stw r19, 36(r4)
+stw r20, 40(r4)
+stw r21, 44(r4)
+lvx v1, 0, r4
+lvx v2, 0, r5
+lvx v3, 0, r6
+
+vcmpeqfp. v4, v1, v2
+bge cr6, 1f
+li r28, 1
+1:
+bne cr6, 2f
+li r29, 1
+2:
+vcmpeqfp. v5, v1, v3
+bge cr6, 3f
+li r30, 1
+3:
+bne cr6, 4f
+li r31, 1
+4:
+
+stvx v4, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+stvx v5, 0, r9
+lwz r14, 0(r9)
+lwz r15, 4(r9)
+lwz r16, 8(r9)
+lwz r17, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x00000000FFFFFFFF
+# REGISTER_OUT r11 0x00000000FFFFFFFF
+# REGISTER_OUT r12 0x00000000FFFFFFFF
+# REGISTER_OUT r13 0x00000000FFFFFFFF
+# REGISTER_OUT r14 0x00000000FFFFFFFF
+# REGISTER_OUT r15 0x0000000000000000
+# REGISTER_OUT r16 0x00000000FFFFFFFF
+# REGISTER_OUT r17 0x0000000000000000
+# REGISTER_OUT r28 0x0000000000000001
+# REGISTER_OUT r29 0x0000000000000000
+# REGISTER_OUT r30 0x0000000000000000
+# REGISTER_OUT r31 0x0000000000000000
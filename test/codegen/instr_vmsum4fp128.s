@@ -0,0 +1,36 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r5 0x0000000082010810
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x000000003F800000
+# REGISTER_IN r11 0x0000000040000000
+# REGISTER_IN r12 0x0000000040400000
+# REGISTER_IN r13 0x0000000040800000
+# REGISTER_IN r14 0x0000000040A00000
+# REGISTER_IN r15 0x00000000C0C00000
+# REGISTER_IN r16 0x000000003F000000
+# REGISTER_IN r17 0x0000000042C80000
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+stw r14, 16(r4)
+stw r15, 20(r4)
+stw r16, 24(r4)
+stw r17, 28(r4)
+lvx v1, 0, r4
+lvx v2, 0, r5
+
+vmsum4fp128 v3, v1, v2
+
+stvx v3, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x0000000043C54000
+# REGISTER_OUT r11 0x0000000043C54000
+# REGISTER_OUT r12 0x0000000043C54000
+# REGISTER_OUT r13 0x0000000043C54000
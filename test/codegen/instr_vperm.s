@@ -0,0 +1,46 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r5 0x0000000082010810
+# REGISTER_IN r6 0x0000000082010820
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x00000000A0A1A2A3
+# REGISTER_IN r11 0x00000000A4A5A6A7
+# REGISTER_IN r12 0x00000000A8A9AAAB
+# REGISTER_IN r13 0x00000000ACADAEAF
+# REGISTER_IN r14 0x00000000B0B1B2B3
+# REGISTER_IN r15 0x00000000B4B5B6B7
+# REGISTER_IN r16 0x00000000B8B9BABB
+# REGISTER_IN r17 0x00000000BCBDBEBF
+# REGISTER_IN r18 0x000000001F001103
+# REGISTER_IN r19 0x0000000007180A1C
+# REGISTER_IN r20 0x00000000E5300F14
+# REGISTER_IN r21 0x00000000021D0916
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+stw r14, 16(r4)
+stw r15, 20(r4)
+stw r16, 24(r4)
+stw r17, 28(r4)
+stw r18, 32(r4)
+stw r19, 36(r4)
+stw r20, 40(r4)
+stw r21, 44(r4)
+lvx v1, 0, r4
+lvx v2, 0, r5
+lvx v3, 0, r6
+
+vperm v4, v1, v2, v3
+
+stvx v4, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x00000000BFA0B1A3
+# REGISTER_OUT r11 0x00000000A7B8AABC
+# REGISTER_OUT r12 0x00000000A5B0AFB4
+# REGISTER_OUT r13 0x00000000A2BDA9B6
@@ -0,0 +1,79 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r5 0x0000000082010810
+# REGISTER_IN r6 0x0000000082010820
+# REGISTER_IN r7 0x0000000082010830
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x0000000011111111
+# REGISTER_IN r11 0x0000000022222222
+# REGISTER_IN r12 0x0000000033333333
+# REGISTER_IN r13 0x0000000044444444
+# REGISTER_IN r14 0x0000000040000000
+# REGISTER_IN r15 0x0000000040A00000
+# REGISTER_IN r16 0x0000000040400080
+# REGISTER_IN r17 0x0000000040400010
+# REGISTER_IN r18 0x0000000042C80000
+# REGISTER_IN r19 0x00000000C2C80000
+# REGISTER_IN r20 0x0000000000000000
+# REGISTER_IN r21 0x0000000000000000
+# REGISTER_IN r22 0x0000000040400005
+# REGISTER_IN r23 0x00000000403FFFFF
+# REGISTER_IN r24 0x0000000040401234
+# REGISTER_IN r25 0x0000000049742400
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+stw r14, 16(r4)
+stw r15, 20(r4)
+stw r16, 24(r4)
+stw r17, 28(r4)
+stw r18, 32(r4)
+stw r19, 36(r4)
+stw r20, 40(r4)
+stw r21, 44(r4)
+stw r22, 48(r4)
+stw r23, 52(r4)
+stw r24, 56(r4)
+stw r25, 60(r4)
+lvx v1, 0, r4
+lvx v2, 0, r5
+lvx v3, 0, r6
+lvx v4, 0, r7
+
+lvx v5, 0, r4
+lvx v6, 0, r4
+lvx v7, 0, r4
+vpkd3d128 v5, v2, 0, 1, 0
+vpkd3d128 v6, v3, 1, 1, 3
+vpkd3d128 v7, v4, 4, 2, 1
+
+stvx v5, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+stvx v6, 0, r9
+lwz r14, 0(r9)
+lwz r15, 4(r9)
+lwz r16, 8(r9)
+lwz r17, 12(r9)
+stvx v7, 0, r9
+lwz r18, 0(r9)
+lwz r19, 4(r9)
+lwz r20, 8(r9)
+lwz r21, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x0000000011111111
+# REGISTER_OUT r11 0x0000000022222222
+# REGISTER_OUT r12 0x0000000033333333
+# REGISTER_OUT r13 0x000000001000FF80
+# REGISTER_OUT r14 0x000000007FFF8001
+# REGISTER_OUT r15 0x0000000022222222
+# REGISTER_OUT r16 0x0000000033333333
+# REGISTER_OUT r17 0x0000000044444444
+# REGISTER_OUT r18 0x0000000011111111
+# REGISTER_OUT r19 0x000000000005FFFF
+# REGISTER_OUT r20 0x0000000012347FFF
+# REGISTER_OUT r21 0x0000000044444444
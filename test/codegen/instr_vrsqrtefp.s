@@ -0,0 +1,26 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x0000000040800000
+# REGISTER_IN r11 0x000000003E800000
+# REGISTER_IN r12 0x000000007F800000
+# REGISTER_IN r13 0x0000000000000000
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+lvx v1, 0, r4
+
+vrsqrtefp v3, v1
+
+stvx v3, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x000000003F000000
+# REGISTER_OUT r11 0x0000000040000000
+# REGISTER_OUT r12 0x0000000000000000
+# REGISTER_OUT r13 0x000000007F800000
@@ -0,0 +1,56 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r5 0x0000000082010810
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x00000000A0A1A2A3
+# REGISTER_IN r11 0x00000000A4A5A6A7
+# REGISTER_IN r12 0x00000000A8A9AAAB
+# REGISTER_IN r13 0x00000000ACADAEAF
+# REGISTER_IN r14 0x00000000B0B1B2B3
+# REGISTER_IN r15 0x00000000B4B5B6B7
+# REGISTER_IN r16 0x00000000B8B9BABB
+# REGISTER_IN r17 0x00000000BCBDBEBF
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+stw r14, 16(r4)
+stw r15, 20(r4)
+stw r16, 24(r4)
+stw r17, 28(r4)
+lvx v1, 0, r4
+lvx v2, 0, r5
+
+vsldoi v3, v1, v2, 3
+vsldoi v4, v1, v2, 8
+vsldoi v5, v1, v2, 13
+
+stvx v3, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+stvx v4, 0, r9
+lwz r14, 0(r9)
+lwz r15, 4(r9)
+lwz r16, 8(r9)
+lwz r17, 12(r9)
+stvx v5, 0, r9
+lwz r18, 0(r9)
+lwz r19, 4(r9)
+lwz r20, 8(r9)
+lwz r21, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x00000000A3A4A5A6
+# REGISTER_OUT r11 0x00000000A7A8A9AA
+# REGISTER_OUT r12 0x00000000ABACADAE
+# REGISTER_OUT r13 0x00000000AFB0B1B2
+# REGISTER_OUT r14 0x00000000A8A9AAAB
+# REGISTER_OUT r15 0x00000000ACADAEAF
+# REGISTER_OUT r16 0x00000000B0B1B2B3
+# REGISTER_OUT r17 0x00000000B4B5B6B7
+# REGISTER_OUT r18 0x00000000ADAEAFB0
+# REGISTER_OUT r19 0x00000000B1B2B3B4
+# REGISTER_OUT r20 0x00000000B5B6B7B8
+# REGISTER_OUT r21 0x00000000B9BABBBC
@@ -0,0 +1,46 @@
+# REGISTER_IN r4 0x0000000082010800
+# REGISTER_IN r9 0x0000000082010880
+# REGISTER_IN r10 0x0000000000000000
+# REGISTER_IN r11 0x0000000000000000
+# REGISTER_IN r12 0x0000000012345678
+# REGISTER_IN r13 0x00000000FF807F01
+
+stw r10, 0(r4)
+stw r11, 4(r4)
+stw r12, 8(r4)
+stw r13, 12(r4)
+lvx v1, 0, r4
+
+vupkd3d128 v3, v1, 0
+vupkd3d128 v4, v1, 4
+vupkd3d128 v5, v1, 16
+
+stvx v3, 0, r9
+lwz r10, 0(r9)
+lwz r11, 4(r9)
+lwz r12, 8(r9)
+lwz r13, 12(r9)
+stvx v4, 0, r9
+lwz r14, 0(r9)
+lwz r15, 4(r9)
+lwz r16, 8(r9)
+lwz r17, 12(r9)
+stvx v5, 0, r9
+lwz r18, 0(r9)
+lwz r19, 4(r9)
+lwz r20, 8(r9)
+lwz r21, 12(r9)
+
+blr
+# REGISTER_OUT r10 0x000000003F800080
+# REGISTER_OUT r11 0x000000003F80007F
+# REGISTER_OUT r12 0x000000003F800001
+# REGISTER_OUT r13 0x000000003F8000FF
+# REGISTER_OUT r14 0x00000000403FFF80
+# REGISTER_OUT r15 0x0000000040407F01
+# REGISTER_OUT r16 0x0000000000000000
+# REGISTER_OUT r17 0x000000003F800000
+# REGISTER_OUT r18 0x0000000040401234
+# REGISTER_OUT r19 0x0000000040405678
+# REGISTER_OUT r20 0x00000000403FFF80
+# REGISTER_OUT r21 0x0000000040407F01
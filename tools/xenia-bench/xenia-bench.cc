@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2013 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <xenia/xenia.h>
+#include <xenia/kernel/xex2_aes.h>
+
+#include <third_party/crypto/rijndael-alg-fst.h>
+
+#include <gflags/gflags.h>
+
+
+DEFINE_int32(xex_size_mb, 32,
+    "Size of the synthetic encrypted XEX image, in megabytes.");
+DEFINE_int32(iterations, 8,
+    "Number of times each implementation decrypts the image.");
+
+
+namespace {
+
+// Builds an image encrypted the same way XEX data is (AES-128 CBC with a
+// zero IV) so that both decryption paths see realistic input.
+void EncryptImage(const uint8_t key[16], const uint8_t* plaintext,
+                  uint8_t* ciphertext, size_t length) {
+  uint32_t rk[4 * (MAXNR + 1)];
+  int32_t Nr = rijndaelKeySetupEnc(rk, key, 128);
+  uint8_t ivec[16] = {0};
+  uint8_t block[16];
+  for (size_t n = 0; n < length; n += 16) {
+    for (size_t i = 0; i < 16; i++) {
+      block[i] = plaintext[n + i] ^ ivec[i];
+    }
+    rijndaelEncrypt(rk, Nr, block, ciphertext + n);
+    xe_copy_struct(ivec, ciphertext + n, 16);
+  }
+}
+
+// Decrypts the image the way the loader does (the session key followed by
+// the image in 64KB pieces, chaining the IV) and returns MB/s.
+double BenchmarkDecrypt(bool allow_aesni, const uint8_t xex_key[16],
+                        const uint8_t file_key[16],
+                        const uint8_t* ciphertext, uint8_t* output,
+                        size_t length) {
+  const size_t piece_size = 64 * 1024;
+  const double start = xe_pal_now();
+  for (int32_t n = 0; n < FLAGS_iterations; n++) {
+    uint8_t session_key[16];
+    xe_xex2_aes_t aes;
+    xe_xex2_aes_init(&aes, xex_key, allow_aesni);
+    xe_xex2_aes_decrypt_block(&aes, file_key, session_key);
+    xe_xex2_aes_init(&aes, session_key, allow_aesni);
+
+    uint8_t ivec[16] = {0};
+    for (size_t offset = 0; offset < length; offset += piece_size) {
+      xe_xex2_aes_decrypt_cbc(&aes, ivec, ciphertext + offset,
+                              output + offset,
+                              MIN(piece_size, length - offset));
+    }
+  }
+  const double elapsed = xe_pal_now() - start;
+  return (length * (double)FLAGS_iterations) / (1024.0 * 1024.0) / elapsed;
+}
+
+}  // namespace
+
+
+int xenia_bench(int argc, xechar_t** argv) {
+  int result_code = 1;
+
+  const size_t length = (size_t)FLAGS_xex_size_mb * 1024 * 1024;
+  uint8_t* plaintext = NULL;
+  uint8_t* ciphertext = NULL;
+  uint8_t* output = NULL;
+
+  xe_pal_options_t pal_options;
+  xe_zero_struct(&pal_options, sizeof(pal_options));
+  XEEXPECTZERO(xe_pal_init(pal_options));
+
+  XEEXPECTTRUE(FLAGS_xex_size_mb > 0 && FLAGS_iterations > 0);
+  plaintext = (uint8_t*)xe_malloc(length);
+  XEEXPECTNOTNULL(plaintext);
+  ciphertext = (uint8_t*)xe_malloc(length);
+  XEEXPECTNOTNULL(ciphertext);
+  output = (uint8_t*)xe_malloc(length);
+  XEEXPECTNOTNULL(output);
+
+  {
+    // Retail key, so the session key step matches the real loader.
+    const uint8_t xex_key[16] = {
+      0x20, 0xB1, 0x85, 0xA5, 0x9D, 0x28, 0xFD, 0xC3,
+      0x40, 0x58, 0x3F, 0xBB, 0x08, 0x96, 0xBF, 0x91
+    };
+    // Any file key will do. The image is encrypted with the session key the
+    // loader derives from it.
+    const uint8_t file_key[16] = {
+      0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+      0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+    };
+    uint8_t session_key[16];
+    xe_xex2_aes_t aes;
+    xe_xex2_aes_init(&aes, xex_key, false);
+    xe_xex2_aes_decrypt_block(&aes, file_key, session_key);
+
+    // Deterministic filler that doesn't compress to nothing.
+    uint32_t seed = 0x5EED1234;
+    for (size_t n = 0; n < length; n++) {
+      seed = seed * 1664525 + 1013904223;
+      plaintext[n] = (uint8_t)(seed >> 24);
+    }
+    EncryptImage(session_key, plaintext, ciphertext, length);
+
+    printf("Decrypting %dMB x %d...\n",
+           FLAGS_xex_size_mb, FLAGS_iterations);
+
+    xe_zero_struct(output, length);
+    const double table_rate = BenchmarkDecrypt(
+        false, xex_key, file_key, ciphertext, output, length);
+    XEEXPECTZERO(memcmp(output, plaintext, length));
+    printf("  table:  %8.1f MB/s\n", table_rate);
+
+    if (xe_xex2_aes_has_aesni()) {
+      xe_zero_struct(output, length);
+      const double aesni_rate = BenchmarkDecrypt(
+          true, xex_key, file_key, ciphertext, output, length);
+      XEEXPECTZERO(memcmp(output, plaintext, length));
+      printf("  AES-NI: %8.1f MB/s (%.1fx)\n",
+             aesni_rate, aesni_rate / table_rate);
+    } else {
+      printf("  AES-NI: not supported by this processor\n");
+    }
+  }
+
+  result_code = 0;
+XECLEANUP:
+  if (result_code) {
+    printf("BENCHMARK FAILED\n");
+  }
+  xe_free(output);
+  xe_free(ciphertext);
+  xe_free(plaintext);
+  return result_code;
+}
+XE_MAIN_THUNK(xenia_bench, "xenia-bench");
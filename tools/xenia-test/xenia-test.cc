@@ -28,10 +28,47 @@ DEFINE_string(test_path, "test\\codegen\\",
 DEFINE_string(test_path, "test/codegen/",
     "Directory scanned for test files.");
 #endif  // WIN32
+DEFINE_int32(test_jobs, 0,
+    "Number of tests run in parallel. 0 uses one per logical processor.");
+DEFINE_string(test_results_path, "",
+    "If set, per-test results and timings are written to this file as JSON.");
+DEFINE_bool(test_sse41_fallback, true,
+    "Run every test a second time with SSE4.1 disabled.");
+DEFINE_bool(test_movbe_fallback, true,
+    "Run every test a second time with MOVBE disabled.");
+
+DECLARE_bool(vmx_sse41);
+DECLARE_bool(jit_movbe);
 
 
 typedef vector<pair<string, string> > annotations_list_t;
 
+typedef struct {
+  string  path;
+  string  config;       // codegen configuration, empty for the default
+  bool    passed;
+  double  duration;     // seconds, including load and codegen
+  string  output;       // assertion failure details
+} test_result_t;
+
+// Each worker owns a memory/processor/runtime that is reset between tests
+// instead of being recreated, as the 3GB memory reservation and processor
+// setup dominate the cost of small tests.
+typedef struct {
+  xe_memory_ref           memory;
+  shared_ptr<Backend>     backend;
+  shared_ptr<Processor>   processor;
+  shared_ptr<Runtime>     runtime;
+} test_worker_t;
+
+// Shared by the workers of a pass. It must outlive them, so the pass joins
+// every worker before freeing it.
+typedef struct {
+  vector<test_result_t>*  results;
+  volatile int32_t        next_index;
+  xe_mutex_t*             output_lock;
+} test_queue_t;
+
 
 int read_annotations(string& src_file_path, annotations_list_t& annotations) {
   // TODO(benvanik): use PAL instead of this
@@ -79,10 +116,11 @@ int setup_test_state(xe_memory_ref memory, Processor* processor,
 
 int check_test_results(xe_memory_ref memory, Processor* processor,
                        ThreadState* thread_state,
-                       annotations_list_t& annotations) {
+                       annotations_list_t& annotations, string& output) {
   xe_ppc_state_t* ppc_state = thread_state->ppc_state();
 
   char actual_value[2048];
+  char line_buffer[4096];
 
   bool any_failed = false;
   for (annotations_list_t::iterator it = annotations.begin();
@@ -95,16 +133,54 @@ int check_test_results(xe_memory_ref memory, Processor* processor,
           reg_name.c_str(), reg_value.c_str(),
           actual_value, XECOUNT(actual_value))) {
         any_failed = true;
-        printf("Register %s assert failed:\n", reg_name.c_str());
-        printf("  Expected: %s == %s\n", reg_name.c_str(), reg_value.c_str());
-        printf("    Actual: %s == %s\n", reg_name.c_str(), actual_value);
+        xesnprintfa(line_buffer, XECOUNT(line_buffer),
+                    "Register %s assert failed:\n"
+                    "  Expected: %s == %s\n"
+                    "    Actual: %s == %s\n",
+                    reg_name.c_str(),
+                    reg_name.c_str(), reg_value.c_str(),
+                    reg_name.c_str(), actual_value);
+        output += line_buffer;
       }
     }
   }
   return any_failed;
 }
 
-int run_test(string& src_file_path) {
+int setup_worker(test_worker_t* worker) {
+  // Each worker reserves its own guest address space, which can fail when
+  // many run at once. The worker's tests are then reported as failed.
+  xe_memory_options_t memory_options;
+  xe_zero_struct(&memory_options, sizeof(memory_options));
+  worker->memory = xe_memory_create(memory_options);
+  if (!worker->memory) {
+    return 1;
+  }
+
+  worker->backend = shared_ptr<Backend>(new xe::cpu::x64::X64Backend());
+
+  worker->processor = shared_ptr<Processor>(
+      new Processor(worker->memory, worker->backend));
+  if (worker->processor->Setup()) {
+    return 1;
+  }
+
+  worker->runtime = shared_ptr<Runtime>(
+      new Runtime(worker->processor, XT("")));
+  return 0;
+}
+
+void shutdown_worker(test_worker_t* worker) {
+  worker->runtime.reset();
+  worker->processor.reset();
+  worker->backend.reset();
+  if (worker->memory) {
+    xe_memory_release(worker->memory);
+    worker->memory = NULL;
+  }
+}
+
+int run_test(test_worker_t* worker, string& src_file_path, string& output) {
   int result_code = 1;
 
   // test.s -> test.bin
@@ -113,63 +189,123 @@ int run_test(string& src_file_path) {
   bin_file_path = src_file_path;
   bin_file_path.replace(dot - 1, 2, ".bin");
 
-  xe_memory_ref memory = NULL;
-  shared_ptr<Backend> backend;
-  shared_ptr<Processor> processor;
-  shared_ptr<Runtime> runtime;
+  Processor* processor = worker->processor.get();
   annotations_list_t annotations;
   ThreadState* thread_state = NULL;
+#if XE_WCHAR
+  xechar_t bin_file_path_str[XE_MAX_PATH];
+#else
+  const xechar_t* bin_file_path_str = bin_file_path.c_str();
+#endif  // XE_CHAR
 
   XEEXPECTZERO(read_annotations(src_file_path, annotations));
 
-  while (!memory) {
-    xe_memory_options_t memory_options;
-    xe_zero_struct(&memory_options, sizeof(memory_options));
-    memory = xe_memory_create(memory_options);
-  }
-
-  backend = shared_ptr<Backend>(new xe::cpu::x64::X64Backend());
-
-  processor = shared_ptr<Processor>(new Processor(memory, backend));
-  XEEXPECTZERO(processor->Setup());
-
-  runtime = shared_ptr<Runtime>(new Runtime(processor, XT("")));
+  // Drop the previous test's module and code.
+  XEEXPECTZERO(processor->Reset());
 
   // Load the binary module.
 #if XE_WCHAR
-  xechar_t bin_file_path_str[XE_MAX_PATH];
   XEEXPECTTRUE(xestrwiden(bin_file_path_str, XECOUNT(bin_file_path_str),
                           bin_file_path.c_str()));
-#else
-  const xechar_t* bin_file_path_str = bin_file_path.c_str();
-#endif  // XE_CHAR
+#endif  // XE_WCHAR
   XEEXPECTZERO(processor->LoadRawBinary(bin_file_path_str, 0x82010000));
 
   // Simulate a thread.
   thread_state = processor->AllocThread(256 * 1024, 0);
 
   // Setup test state from annotations.
-  XEEXPECTZERO(setup_test_state(memory, processor.get(), thread_state,
+  XEEXPECTZERO(setup_test_state(worker->memory, processor, thread_state,
                                 annotations));
 
   // Execute test.
   XEEXPECTZERO(processor->Execute(thread_state, 0x82010000));
 
   // Assert test state expectations.
-  XEEXPECTZERO(check_test_results(memory, processor.get(), thread_state,
-                                  annotations));
+  XEEXPECTZERO(check_test_results(worker->memory, processor, thread_state,
+                                  annotations, output));
 
   result_code = 0;
 XECLEANUP:
-  if (processor && thread_state) {
+  if (thread_state) {
     processor->DeallocThread(thread_state);
   }
-  runtime.reset();
-  processor.reset();
-  xe_memory_release(memory);
   return result_code;
 }
 
+void test_worker_thread(void* param) {
+  test_queue_t* queue = (test_queue_t*)param;
+  vector<test_result_t>& results = *queue->results;
+
+  test_worker_t worker;
+  worker.memory = NULL;
+  bool worker_ok = setup_worker(&worker) == 0;
+
+  while (true) {
+    // xe_atomic_inc_32 returns the incremented value.
+    const int32_t index = xe_atomic_inc_32(&queue->next_index) - 1;
+    if (index >= (int32_t)results.size()) {
+      break;
+    }
+    test_result_t& result = results[index];
+
+    const double start = xe_pal_now();
+    if (worker_ok) {
+      result.passed = run_test(&worker, result.path, result.output) == 0;
+    } else {
+      result.passed = false;
+      result.output = "Unable to set up processor\n";
+    }
+    result.duration = xe_pal_now() - start;
+
+    xe_mutex_lock(queue->output_lock);
+    printf("%s %8.3fms %s%s%s\n",
+           result.passed ? "PASS" : "FAIL",
+           result.duration * 1000.0, result.path.c_str(),
+           result.config.size() ? " " : "", result.config.c_str());
+    if (result.output.size()) {
+      printf("%s", result.output.c_str());
+    }
+    xe_mutex_unlock(queue->output_lock);
+  }
+
+  shutdown_worker(&worker);
+}
+
+// Writes results as JSON so that other tools can track pass/fail and codegen
+// timings across runs.
+int write_test_results(const string& path, vector<test_result_t>& results,
+                       double total_duration) {
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    XELOGE("Unable to open results file %s", path.c_str());
+    return 1;
+  }
+  fprintf(f, "{\n");
+  fprintf(f, "  \"total_duration_ms\": %.3f,\n", total_duration * 1000.0);
+  fprintf(f, "  \"tests\": [\n");
+  for (size_t n = 0; n < results.size(); n++) {
+    test_result_t& result = results[n];
+    string escaped_path;
+    for (string::iterator it = result.path.begin();
+         it != result.path.end(); ++it) {
+      if (*it == '\\' || *it == '"') {
+        escaped_path += '\\';
+      }
+      escaped_path += *it;
+    }
+    fprintf(f, "    { \"path\": \"%s\", \"config\": \"%s\", "
+               "\"passed\": %s, \"duration_ms\": %.3f }%s\n",
+            escaped_path.c_str(), result.config.c_str(),
+            result.passed ? "true" : "false",
+            result.duration * 1000.0,
+            n + 1 < results.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n");
+  fprintf(f, "}\n");
+  fclose(f);
+  return 0;
+}
+
 int discover_tests(string& test_path,
                    vector<string>& test_files) {
   // TODO(benvanik): use PAL instead of this.
@@ -220,12 +356,87 @@ int discover_tests(string& test_path,
   return 0;
 }
 
+int run_test_pass(vector<test_result_t>& results, int32_t job_count) {
+  int result_code = 1;
+
+  test_queue_t queue;
+  xe_zero_struct(&queue, sizeof(queue));
+  vector<xe_thread_ref> threads;
+
+  queue.results         = &results;
+  queue.next_index      = 0;
+  queue.output_lock     = xe_mutex_alloc(10000);
+  XEEXPECTNOTNULL(queue.output_lock);
+
+  if (results.size()) {
+    for (int32_t n = 0; n < job_count; n++) {
+      xe_thread_ref thread = xe_thread_create(
+          "xenia-test worker", test_worker_thread, &queue);
+      if (xe_thread_start(thread)) {
+        // The started workers still drain the whole queue.
+        XELOGE("Unable to start test worker %d", n);
+        xe_thread_release(thread);
+        break;
+      }
+      threads.push_back(thread);
+    }
+    XEEXPECT(threads.size());
+  }
+
+  result_code = 0;
+XECLEANUP:
+  // Workers use the queue until they return, so wait for all of them before
+  // it goes away.
+  for (vector<xe_thread_ref>::iterator it = threads.begin();
+       it != threads.end(); ++it) {
+    xe_thread_join(*it);
+    xe_thread_release(*it);
+  }
+  if (queue.output_lock) {
+    xe_mutex_free(queue.output_lock);
+  }
+  return result_code;
+}
+
+// Runs the tests of the default configuration again with a codegen flag
+// turned off. The flag is read when each test resets its processor, which is
+// why this is a separate pass and not interleaved with the first.
+int run_fallback_pass(vector<test_result_t>& results, int32_t job_count,
+                      const char* config_name, bool* flag) {
+  vector<test_result_t> fallback_results;
+  for (vector<test_result_t>::iterator it = results.begin();
+       it != results.end(); ++it) {
+    if (it->config.size()) {
+      continue;
+    }
+    test_result_t result;
+    result.path = it->path;
+    result.config = config_name;
+    result.passed = false;
+    result.duration = 0;
+    fallback_results.push_back(result);
+  }
+
+  const bool old_value = *flag;
+  *flag = false;
+  int result_code = run_test_pass(fallback_results, job_count);
+  *flag = old_value;
+
+  results.insert(results.end(),
+                 fallback_results.begin(), fallback_results.end());
+  return result_code;
+}
+
 int run_tests(std::string& test_name) {
   int result_code = 1;
   int failed_count = 0;
   int passed_count = 0;
 
   vector<string> test_files;
+  vector<test_result_t> results;
+  int32_t job_count = FLAGS_test_jobs;
+  double start = 0;
+  double total_duration = 0;
 
   xe_pal_options_t pal_options;
   xe_zero_struct(&pal_options, sizeof(pal_options));
@@ -244,14 +455,42 @@ int run_tests(std::string& test_name) {
     if (test_name.length() && *it != test_name) {
       continue;
     }
+    test_result_t result;
+    result.path = *it;
+    result.passed = false;
+    result.duration = 0;
+    results.push_back(result);
+  }
 
-    printf("Running %s...\n", (*it).c_str());
-    if (run_test(*it)) {
-      printf("TEST FAILED\n");
-      failed_count++;
-    } else {
-      printf("Passed\n");
+  if (job_count <= 0) {
+    xe_system_info system_info;
+    XEEXPECTZERO(xe_pal_get_system_info(&system_info));
+    job_count = system_info.processors.logical_count;
+  }
+  job_count = MAX(1, MIN(job_count, (int32_t)results.size()));
+
+  start = xe_pal_now();
+  XEEXPECTZERO(run_test_pass(results, job_count));
+  if (FLAGS_test_sse41_fallback && FLAGS_vmx_sse41) {
+    // The VMX emitters use SSE4.1 when the host has it and SSSE3 otherwise,
+    // so run everything again to keep the SSSE3 paths covered.
+    XEEXPECTZERO(run_fallback_pass(results, job_count, "(nosse41)",
+                                   &FLAGS_vmx_sse41));
+  }
+  if (FLAGS_test_movbe_fallback && FLAGS_jit_movbe) {
+    // MOVBE changes every guest load and store, so run everything again with
+    // the mov+bswap sequences to keep both paths covered.
+    XEEXPECTZERO(run_fallback_pass(results, job_count, "(nomovbe)",
+                                   &FLAGS_jit_movbe));
+  }
+  total_duration = xe_pal_now() - start;
+
+  for (vector<test_result_t>::iterator it = results.begin();
+       it != results.end(); ++it) {
+    if (it->passed) {
       passed_count++;
+    } else {
+      failed_count++;
     }
   }
 
@@ -259,6 +498,12 @@ int run_tests(std::string& test_name) {
   printf("Total tests: %d\n", failed_count + passed_count);
   printf("Passed: %d\n", passed_count);
   printf("Failed: %d\n", failed_count);
+  printf("Time: %.3fms (%d jobs)\n", total_duration * 1000.0, job_count);
+
+  if (FLAGS_test_results_path.size()) {
+    XEEXPECTZERO(write_test_results(FLAGS_test_results_path, results,
+                                    total_duration));
+  }
 
   result_code = failed_count ? 1 : 0;
 XECLEANUP: